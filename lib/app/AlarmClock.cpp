@@ -0,0 +1,726 @@
+#include <stdio.h>
+
+#include "AlarmClock.h"
+
+const DimStage DIM_STAGES[] = {
+    {0, 0xff, 0, SCREEN_HEIGHT}, // Active
+    {8, 0x40, 0, SCREEN_HEIGHT}, // Dimmed
+    {14, 0x08, 24, 24},          // Time digits only
+};
+const size_t DIM_STAGE_COUNT = sizeof(DIM_STAGES) / sizeof(DIM_STAGES[0]);
+
+const uint8_t BURN_IN_SHIFT_ROWS[] = {0, 1, 2, 3, 4, 3, 2, 1};
+const BurnInSchedule DEFAULT_BURN_IN_SCHEDULE = {
+    BURN_IN_SHIFT_ROWS,
+    sizeof(BURN_IN_SHIFT_ROWS) / sizeof(BURN_IN_SHIFT_ROWS[0]),
+    BURN_IN_SHIFT_INTERVAL_S,
+};
+
+static const char *const DAY_NAMES[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char *const MONTH_NAMES[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                          "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+static const char *const MENU_ITEMS[MENU_COUNT] = {"Set Alarm", "Set Time", "Exit"};
+
+enum Button
+{
+    BUTTON_UP,
+    BUTTON_DOWN,
+    BUTTON_SELECT,
+};
+
+/**************************************************************************/
+/*!
+    @brief  Pick the dimming stage for the given idle time
+    @param  idle_us Time since the last activity
+    @return Index into DIM_STAGES
+*/
+/**************************************************************************/
+size_t dimStageFor(uint64_t idle_us)
+{
+    size_t stage = 0;
+    while (stage + 1 < DIM_STAGE_COUNT && idle_us >= DIM_STAGES[stage + 1].idle_s * 1000000ULL)
+    {
+        stage++;
+    }
+    return stage;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clock face shift for the given time according to a burn-in
+            schedule
+    @param  schedule Schedule to follow
+    @param  now_us Time since boot
+    @return Rows to shift by, 0 for an empty schedule
+*/
+/**************************************************************************/
+uint8_t burnInShiftAt(const BurnInSchedule &schedule, uint64_t now_us)
+{
+    if (schedule.count == 0)
+    {
+        return 0;
+    }
+    return schedule.rows[(now_us / (schedule.interval_s * 1000000ULL)) % schedule.count];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Constructor
+    @param  platform Hardware to run on, must outlive the clock
+*/
+/**************************************************************************/
+AlarmClock::AlarmClock(AlarmClockPlatform &platform) : platform(platform) {}
+
+/**************************************************************************/
+/*!
+    @brief  Lay out the screens and show the clock
+*/
+/**************************************************************************/
+void AlarmClock::begin()
+{
+    initScreens();
+    showClock();
+    last_activity_time = platform.timeUs();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Take over an alarm found armed in the RTC at boot
+    @param  hour Alarm hour
+    @param  minute Alarm minute
+*/
+/**************************************************************************/
+void AlarmClock::restoreAlarm(uint8_t hour, uint8_t minute)
+{
+    alarm_hour = hour;
+    alarm_minute = minute;
+    alarm_enabled = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handle every event in a set of pending events
+    @param  events Pending bits as returned by EventFlags::take(), handled
+            in the order of the Event enum
+*/
+/**************************************************************************/
+void AlarmClock::dispatch(uint32_t events)
+{
+    for (uint8_t event = 0; event < EVENT_COUNT; event++)
+    {
+        if (events & eventBit((Event)event))
+        {
+            dispatchEvent((Event)event);
+        }
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Handle one event
+    @param  event Event to handle
+*/
+/**************************************************************************/
+void AlarmClock::dispatchEvent(Event event)
+{
+    switch (event)
+    {
+    case EVENT_BUTTON_UP:
+        handleButtonUp();
+        break;
+    case EVENT_BUTTON_DOWN:
+        handleButtonDown();
+        break;
+    case EVENT_BUTTON_SELECT:
+        handleButtonSelect();
+        break;
+    case EVENT_TICK:
+        handleTick();
+        break;
+    case EVENT_ALARM:
+        handleAlarmFired();
+        break;
+    case EVENT_PLAYER_RX:
+        handlePlayerRx();
+        break;
+    case EVENT_COUNT:
+        break;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run timeouts and animations and request a render
+    @details Called once per main loop iteration, after the pending events
+    were dispatched.
+    @return Time since boot at which to call again, or 0 if only an event
+            needs it
+*/
+/**************************************************************************/
+uint64_t AlarmClock::poll()
+{
+    // Flashing alarm indicator
+    if (current_state == STATE_ALARM_RINGING &&
+        platform.timeUs() - last_flash >= ALARM_FLASH_MS * 1000)
+    {
+        last_flash = platform.timeUs();
+        updateAlarmIndicator();
+    }
+
+    // Screen transition
+    if (roll_offset != 0 && platform.timeUs() - last_roll_step >= ROLL_STEP_MS * 1000)
+    {
+        last_roll_step = platform.timeUs();
+        roll_offset += roll_offset < 0 ? ROLL_STEP_LINES : -ROLL_STEP_LINES;
+        platform.displayCommand(DISPLAY_START_LINE, roll_offset + SCREEN_HEIGHT);
+    }
+
+    // Volume bar timeout
+    if (volume_bar_visible &&
+        platform.timeUs() - volume_bar_start_time > VOLUME_BAR_TIMEOUT_S * 1000000ULL)
+    {
+        ui_set_visible(&volume_bar, false);
+        volume_bar_visible = false;
+    }
+
+    // Dim while idle, only on the clock screen and never while ringing
+    size_t stage = 0;
+    if (current_state == STATE_CLOCK && roll_offset == 0)
+    {
+        stage = dimStageFor(platform.timeUs() - last_activity_time);
+    }
+    if (display_on && stage != dim_stage)
+    {
+        applyDimStage(stage);
+    }
+
+    // Shift the clock face with the display offset, other screens stay put
+    uint8_t offset = 0;
+    if (current_screen == &clock_screen)
+    {
+        offset = burnInShiftAt(burn_in, platform.timeUs());
+    }
+    if (display_on && offset != burn_in_offset)
+    {
+        platform.displayCommand(DISPLAY_OFFSET, offset);
+        burn_in_offset = offset;
+    }
+
+    // Repaint widgets that changed and flush them
+    platform.displayCommand(DISPLAY_RENDER);
+
+    // Sleep
+    if (current_state != STATE_ALARM_RINGING &&
+        display_on &&
+        platform.timeUs() - last_activity_time > (DISPLAY_TIMEOUT_S * 1000000ULL))
+    {
+        if (current_screen != &clock_screen)
+        {
+            showClock();
+        }
+        current_state = STATE_CLOCK;
+        powerDownPeripherals();
+    }
+
+    // Wake early for running animations. Timeouts above are checked at
+    // least once per tick.
+    if (roll_offset != 0)
+    {
+        return last_roll_step + ROLL_STEP_MS * 1000;
+    }
+    if (current_state == STATE_ALARM_RINGING)
+    {
+        return last_flash + ALARM_FLASH_MS * 1000;
+    }
+    return 0;
+}
+
+void AlarmClock::initScreens()
+{
+    ui_digits_init(&clock_time, 20, 24, 3);
+    ui_label_init(&clock_date, 20, 50, 16, 1);
+    ui_label_init(&clock_alarm, 80, 0, 8, 1);
+    ui_bar_init(&volume_bar, 0, 0, 41, 6, MAX_VOLUME);
+    ui_set_visible(&volume_bar, false);
+    ui_blink_init(&alarm_flash, 20, 13, 87, 5);
+
+    ui_label_init(&menu_title, 50, 0, 4, 1);
+    ui_label_set(&menu_title, "MENU");
+    ui_menu_init(&menu_list, 5, 15, 80, MENU_ITEMS, MENU_COUNT, 12);
+
+    ui_label_init(&edit_title, 60, 0, 9, 1);
+    ui_digits_init(&edit_time, 20, 24, 3);
+    ui_blink_init(&edit_hour_mark, 20, 50, 33, 2);
+    ui_blink_init(&edit_minute_mark, 75, 50, 33, 2);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Switch to another screen, repainting it completely
+    @param  screen Screen to show
+*/
+/**************************************************************************/
+void AlarmClock::showScreen(const ui_screen_t *screen)
+{
+    current_screen = screen;
+    platform.displayCommand(DISPLAY_SHOW_SCREEN);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Show a time on the clock screen
+    @param  now Time and date to show
+*/
+/**************************************************************************/
+void AlarmClock::updateClock(const DateTime &now)
+{
+    // Time
+    ui_digits_set(&clock_time, now.hour(), now.minute());
+
+    // Date
+    char date_str[24];
+    snprintf(date_str, sizeof(date_str), "%s %d %s",
+             DAY_NAMES[now.dayOfTheWeek()],
+             now.day(),
+             MONTH_NAMES[now.month() - 1]);
+    ui_label_set(&clock_date, date_str);
+
+    // Show alarm indicator if enabled
+    char alarm_str[16];
+    snprintf(alarm_str, sizeof(alarm_str), "<> %02d:%02d", alarm_hour, alarm_minute);
+    ui_label_set(&clock_alarm, alarm_str);
+    ui_set_visible(&clock_alarm, alarm_enabled);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Change how the clock face moves to spread pixel wear
+    @param  schedule Schedule to follow from the next poll() on. The rows
+            are not copied and must stay valid. An empty schedule keeps the
+            face still.
+    @return False, keeping the current schedule, if an interval is 0 or a
+            shift exceeds BURN_IN_MAX_SHIFT
+*/
+/**************************************************************************/
+bool AlarmClock::setBurnInSchedule(const BurnInSchedule &schedule)
+{
+    if (schedule.count > 0 && (schedule.rows == nullptr || schedule.interval_s == 0))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < schedule.count; i++)
+    {
+        if (schedule.rows[i] > BURN_IN_MAX_SHIFT)
+        {
+            return false;
+        }
+    }
+    burn_in = schedule;
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Highlight a menu entry
+    @param  option Entry to highlight
+*/
+/**************************************************************************/
+void AlarmClock::selectMenu(MenuOption option)
+{
+    current_menu_option = option;
+    updateMenu();
+}
+
+void AlarmClock::updateAlarmIndicator()
+{
+    // Flashing indicator
+    ui_blink_toggle(&alarm_flash);
+}
+
+void AlarmClock::updateMenu()
+{
+    ui_menu_select(&menu_list, current_menu_option);
+}
+
+void AlarmClock::updateEditMarks()
+{
+    ui_blink_set(&edit_hour_mark, edit_time_field == TIME_HOUR);
+    ui_blink_set(&edit_minute_mark, edit_time_field == TIME_MINUTE);
+}
+
+void AlarmClock::updateSetAlarm()
+{
+    ui_label_set(&edit_title, "Set Alarm");
+    ui_digits_set(&edit_time, alarm_hour, alarm_minute);
+    updateEditMarks();
+}
+
+void AlarmClock::updateSetTime()
+{
+    // TODO: SET DATE
+
+    ui_label_set(&edit_title, "Set Time");
+    ui_digits_set(&edit_time, time_setting_hour, time_setting_minute);
+    updateEditMarks();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Return to the clock screen showing the current time
+*/
+/**************************************************************************/
+void AlarmClock::showClock()
+{
+    current_state = STATE_CLOCK;
+    current_time = platform.now();
+    ui_blink_set(&alarm_flash, false);
+    updateClock(current_time);
+    showScreen(&clock_screen);
+}
+
+void AlarmClock::updateVolumeIndicator()
+{
+    ui_bar_set(&volume_bar, current_volume);
+    ui_set_visible(&volume_bar, true);
+
+    // Set timestamp for auto-hide
+    volume_bar_start_time = platform.timeUs();
+    volume_bar_visible = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Roll the next screen into place using the display start line
+    @details Each step costs a single command byte instead of a frame.
+    @param  from_below true to slide the screen up into place, false to
+            slide it down
+*/
+/**************************************************************************/
+void AlarmClock::startRollTransition(bool from_below)
+{
+    roll_offset = from_below ? -(SCREEN_HEIGHT - ROLL_STEP_LINES) : SCREEN_HEIGHT - ROLL_STEP_LINES;
+    platform.displayCommand(DISPLAY_START_LINE, roll_offset + SCREEN_HEIGHT);
+    last_roll_step = platform.timeUs();
+}
+
+void AlarmClock::applyDimStage(size_t stage)
+{
+    platform.displayCommand(DISPLAY_CONTRAST, DIM_STAGES[stage].contrast);
+    platform.displayCommand(DISPLAY_ACTIVE_ROWS, DIM_STAGES[stage].row0, DIM_STAGES[stage].rows);
+    if (roll_offset != 0)
+    {
+        // Active rows reset the start line, keep a transition in progress rolling
+        platform.displayCommand(DISPLAY_START_LINE, roll_offset + SCREEN_HEIGHT);
+    }
+    dim_stage = stage;
+}
+
+void AlarmClock::programAlarm(const DateTime &alarm_time)
+{
+    platform.programAlarm(alarm_time);
+    alarm_enabled = true;
+}
+
+void AlarmClock::powerDownPeripherals()
+{
+    if (display_on == true)
+    {
+        platform.displayCommand(DISPLAY_POWER, 0);
+        display_on = false;
+    }
+}
+
+void AlarmClock::powerUpPeripherals()
+{
+    if (display_on == false)
+    {
+        platform.displayCommand(DISPLAY_POWER, 1);
+        display_on = true;
+    }
+}
+
+void AlarmClock::resetActivity()
+{
+    platform.noteInput();
+    last_activity_time = platform.timeUs();
+    powerUpPeripherals();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Drop presses of a button that follow the last one too closely
+    @param  button Button pressed
+    @return True if the press should be handled
+*/
+/**************************************************************************/
+bool AlarmClock::debounce(int button)
+{
+    uint64_t now = platform.timeUs();
+    if (now - last_press_time[button] < BUTTON_DEBOUNCE_MS * 1000)
+    {
+        return false;
+    }
+    last_press_time[button] = now;
+    return true;
+}
+
+void AlarmClock::handleAlarmFired()
+{
+    resetActivity();
+    if (current_screen != &clock_screen)
+    {
+        showClock();
+    }
+    current_state = STATE_ALARM_RINGING;
+    platform.playAlarm();
+    platform.clearAlarm();
+}
+
+void AlarmClock::handleButtonUp()
+{
+    if (!debounce(BUTTON_UP))
+    {
+        return;
+    }
+
+    if (!display_on)
+    {
+        // Only wake up, don't execute button action
+        resetActivity();
+        return;
+    }
+    resetActivity();
+
+    switch (current_state)
+    {
+    case STATE_CLOCK:
+        if (current_volume < MAX_VOLUME)
+        {
+            platform.volumeUp();
+            current_volume++;
+        }
+        updateVolumeIndicator();
+        break;
+
+    case STATE_MENU:
+        // Move up in menu
+        current_menu_option = (MenuOption)((current_menu_option - 1 + MENU_COUNT) % MENU_COUNT);
+        updateMenu();
+        break;
+
+    case STATE_SET_TIME:
+        // Increment current time setting field
+        if (edit_time_field == TIME_HOUR)
+        {
+            time_setting_hour = (time_setting_hour + 1 + 24) % 24;
+        }
+        else if (edit_time_field == TIME_MINUTE)
+        {
+            time_setting_minute = (time_setting_minute + 1 + 60) % 60;
+        }
+        updateSetTime();
+        break;
+
+    case STATE_SET_ALARM:
+        // Increment current alarm setting field
+        if (edit_time_field == TIME_HOUR)
+        {
+            alarm_hour = (alarm_hour + 1 + 24) % 24;
+        }
+        else if (edit_time_field == TIME_MINUTE)
+        {
+            alarm_minute = (alarm_minute + 1 + 60) % 60;
+        }
+        updateSetAlarm();
+        break;
+
+    case STATE_ALARM_RINGING:
+        // Stop alarm
+        platform.stopAlarm();
+        platform.clearAlarm();
+        showClock();
+        break;
+    }
+}
+
+void AlarmClock::handleButtonDown()
+{
+    if (!debounce(BUTTON_DOWN))
+    {
+        return;
+    }
+
+    if (!display_on)
+    {
+        // Only wake up, don't execute button action
+        resetActivity();
+        return;
+    }
+    resetActivity();
+
+    switch (current_state)
+    {
+    case STATE_CLOCK:
+        if (current_volume > 0)
+        {
+            platform.volumeDown();
+            current_volume--;
+        }
+        updateVolumeIndicator();
+        break;
+
+    case STATE_MENU:
+        // Move down in menu
+        current_menu_option = (MenuOption)((current_menu_option + 1 + MENU_COUNT) % MENU_COUNT);
+        updateMenu();
+        break;
+
+    case STATE_SET_ALARM:
+        // Increment current alarm setting field
+        if (edit_time_field == TIME_HOUR)
+        {
+            alarm_hour = (alarm_hour - 1 + 24) % 24;
+        }
+        else if (edit_time_field == TIME_MINUTE)
+        {
+            alarm_minute = (alarm_minute - 1 + 60) % 60;
+        }
+        updateSetAlarm();
+        break;
+
+    case STATE_SET_TIME:
+        // Increment current time setting field
+        if (edit_time_field == TIME_HOUR)
+        {
+            time_setting_hour = (time_setting_hour - 1 + 24) % 24;
+        }
+        else if (edit_time_field == TIME_MINUTE)
+        {
+            time_setting_minute = (time_setting_minute - 1 + 60) % 60;
+        }
+        updateSetTime();
+        break;
+
+    case STATE_ALARM_RINGING:
+        // Snooze for 5 minutes
+        // snoozeAlarm(5);
+        break;
+    }
+}
+
+void AlarmClock::handleButtonSelect()
+{
+    if (!debounce(BUTTON_SELECT))
+    {
+        return;
+    }
+
+    if (!display_on)
+    {
+        // Only wake up, don't execute button action
+        resetActivity();
+        return;
+    }
+    resetActivity();
+
+    switch (current_state)
+    {
+    case STATE_CLOCK:
+        // Enter menu
+        current_state = STATE_MENU;
+        current_menu_option = MENU_SET_ALARM;
+        updateMenu();
+        showScreen(&menu_screen);
+        startRollTransition(true);
+        break;
+
+    case STATE_MENU:
+        // Execute menu item
+        switch (current_menu_option)
+        {
+        case MENU_SET_ALARM:
+            current_state = STATE_SET_ALARM;
+            edit_time_field = TIME_HOUR;
+            updateSetAlarm();
+            showScreen(&edit_screen);
+            break;
+
+        case MENU_SET_TIME:
+            current_time = platform.now();
+            time_setting_hour = current_time.hour();
+            time_setting_minute = current_time.minute();
+            current_state = STATE_SET_TIME;
+            edit_time_field = TIME_HOUR;
+            updateSetTime();
+            showScreen(&edit_screen);
+            break;
+
+        case MENU_EXIT:
+            showClock();
+            startRollTransition(false);
+            break;
+
+        default:
+            break;
+        }
+        break;
+
+    case STATE_SET_ALARM:
+        if (edit_time_field == TIME_HOUR)
+        {
+            // Move to next field
+            edit_time_field = TIME_MINUTE;
+            updateSetAlarm();
+        }
+        else if (edit_time_field == TIME_MINUTE)
+        {
+            // Save and exit
+            programAlarm(DateTime(2000, 1, 1, alarm_hour, alarm_minute, 0));
+            showClock();
+        }
+        break;
+
+    case STATE_SET_TIME:
+        if (edit_time_field == TIME_HOUR)
+        {
+            // Move to next field
+            edit_time_field = TIME_MINUTE;
+            updateSetTime();
+        }
+        else if (edit_time_field == TIME_MINUTE)
+        {
+            // Save and exit
+            platform.adjustTime(DateTime(current_time.year(), current_time.month(), current_time.day(), time_setting_hour, time_setting_minute, 0));
+            showClock();
+        }
+        break;
+
+    case STATE_ALARM_RINGING:
+        // Stop alarm completely
+        platform.stopAlarm();
+        platform.clearAlarm();
+        showClock();
+        break;
+    }
+}
+
+void AlarmClock::handleTick()
+{
+    platform.updateTime();
+    current_time = platform.now();
+    if ((current_state == STATE_CLOCK || current_state == STATE_ALARM_RINGING) &&
+        current_time.minute() != last_minute)
+    {
+        last_minute = current_time.minute();
+        updateClock(current_time);
+    }
+}
+
+void AlarmClock::handlePlayerRx()
+{
+    // Loop the alarm
+    if (platform.playerFinished() && current_state == STATE_ALARM_RINGING)
+    {
+        platform.playAlarm();
+    }
+}
@@ -0,0 +1,250 @@
+/**************************************************************************/
+/*!
+  @file     AlarmClock.h
+
+  User interface and behaviour of the alarm clock.
+
+  The states, screens and event handlers live here, away from the
+  hardware: the RTC, player, software clock and display are reached
+  through an AlarmClockPlatform, so the whole clock can be driven on the
+  host with synthetic events and a fake platform.
+*/
+/**************************************************************************/
+
+#ifndef _ALARM_CLOCK_H_
+#define _ALARM_CLOCK_H_
+
+#include <RTClib.h>
+extern "C"
+{
+#include "ui.h"
+}
+#include "Events.h"
+
+#define SCREEN_HEIGHT 64            ///< Rows of the panel the screens are laid out for
+#define VOLUME_BAR_TIMEOUT_S 2      ///< Volume bar shown after a change
+#define DISPLAY_TIMEOUT_S 20        ///< Idle time before the display powers off
+#define BUTTON_DEBOUNCE_MS 200      ///< Presses closer together are ignored
+#define ALARM_FLASH_MS 500          ///< Alarm indicator blink period
+#define BURN_IN_SHIFT_INTERVAL_S 60 ///< Default time between clock face shifts
+#define BURN_IN_MAX_SHIFT 6         ///< Blank rows below the clock face, the furthest it can shift
+#define ROLL_STEP_LINES 8           ///< Rows per screen transition step
+#define ROLL_STEP_MS 20             ///< Time between screen transition steps
+#define MAX_VOLUME 30               ///< Loudest player volume
+
+enum State
+{
+    STATE_CLOCK,        // Main clock display
+    STATE_MENU,         // Menu mode
+    STATE_SET_ALARM,    // Setting alarm time
+    STATE_SET_TIME,     // Setting clock time
+    STATE_ALARM_RINGING // Alarm is ringing
+};
+
+enum MenuOption
+{
+    MENU_SET_ALARM,
+    MENU_SET_TIME,
+    MENU_EXIT,
+    MENU_COUNT
+};
+
+enum TimeSetting
+{
+    TIME_HOUR,
+    TIME_MINUTE,
+    // TIME_SECOND,
+    // TIME_DAY,
+    // TIME_MONTH,
+    // TIME_YEAR
+};
+
+// Display power stages while idle, in order of increasing idle time. The
+// display powers off completely after DISPLAY_TIMEOUT_S.
+struct DimStage
+{
+    uint32_t idle_s;  // Seconds without activity before the stage applies
+    uint8_t contrast; // Panel contrast
+    uint8_t row0;     // First RAM row driven
+    uint8_t rows;     // Rows driven, SCREEN_HEIGHT for the full panel
+};
+extern const DimStage DIM_STAGES[];
+extern const size_t DIM_STAGE_COUNT;
+
+// Rows the clock face is shifted by, one entry per interval. The clock
+// layout leaves the bottom BURN_IN_MAX_SHIFT rows blank, which is what
+// wraps around.
+struct BurnInSchedule
+{
+    const uint8_t *rows; // Shift for each interval, repeating; none to never shift
+    size_t count;        // Entries in rows
+    uint32_t interval_s; // Seconds each entry applies for
+};
+extern const uint8_t BURN_IN_SHIFT_ROWS[];
+extern const BurnInSchedule DEFAULT_BURN_IN_SCHEDULE;
+
+// Operations on the display, run on core 1 in DISPLAY_MULTICORE builds
+enum DisplayCommand : uint8_t
+{
+    DISPLAY_RENDER,      // Repaint dirty widgets and flush
+    DISPLAY_SHOW_SCREEN, // Clear and fully repaint the current screen on the next render
+    DISPLAY_START_LINE,  // a: start line
+    DISPLAY_OFFSET,      // a: display offset
+    DISPLAY_CONTRAST,    // a: contrast
+    DISPLAY_ACTIVE_ROWS, // a: first row, b: number of rows
+    DISPLAY_POWER,       // a: 1 for on, 0 for off
+};
+
+size_t dimStageFor(uint64_t idle_us);
+uint8_t burnInShiftAt(const BurnInSchedule &schedule, uint64_t now_us);
+
+/**************************************************************************/
+/*!
+    @brief  Hardware behind the alarm clock
+*/
+/**************************************************************************/
+class AlarmClockPlatform
+{
+public:
+    virtual ~AlarmClockPlatform() = default;
+    /*! @brief Monotonic microseconds since boot */
+    virtual uint64_t timeUs() = 0;
+    /*! @brief Current date and time */
+    virtual DateTime now() = 0;
+    /*! @brief Called every tick before now(), e.g. to resync a software clock */
+    virtual void updateTime() = 0;
+    /*! @brief Set the date and time */
+    virtual void adjustTime(const DateTime &dt) = 0;
+    /*! @brief Arm the RTC alarm for the hour and minute of dt */
+    virtual void programAlarm(const DateTime &dt) = 0;
+    /*! @brief Acknowledge a fired RTC alarm */
+    virtual void clearAlarm() = 0;
+    /*! @brief Start the alarm sound */
+    virtual void playAlarm() = 0;
+    /*! @brief Stop playback */
+    virtual void stopAlarm() = 0;
+    /*! @brief Raise the player volume one step */
+    virtual void volumeUp() = 0;
+    /*! @brief Lower the player volume one step */
+    virtual void volumeDown() = 0;
+    /*!
+        @brief  Read the messages the player sent
+        @return True if one of them reported the end of playback
+    */
+    virtual bool playerFinished() = 0;
+    /*! @brief Run a display operation, see DisplayCommand */
+    virtual void displayCommand(DisplayCommand cmd, uint8_t a = 0, uint8_t b = 0) = 0;
+    /*! @brief The input that caused the current activity is being handled */
+    virtual void noteInput() = 0;
+};
+
+/**************************************************************************/
+/*!
+    @brief  Alarm clock state machine and screens
+*/
+/**************************************************************************/
+class AlarmClock
+{
+public:
+    explicit AlarmClock(AlarmClockPlatform &platform);
+    void begin();
+    void restoreAlarm(uint8_t hour, uint8_t minute);
+    void dispatch(uint32_t events);
+    void dispatchEvent(Event event);
+    uint64_t poll();
+
+    void updateClock(const DateTime &now);
+    void selectMenu(MenuOption option);
+    bool setBurnInSchedule(const BurnInSchedule &schedule);
+
+    /*! @brief Screen currently shown */
+    const ui_screen_t *screen() const { return current_screen; }
+    /*! @brief The clock screen */
+    const ui_screen_t *clockScreen() const { return &clock_screen; }
+    /*! @brief The menu screen */
+    const ui_screen_t *menuScreen() const { return &menu_screen; }
+    /*! @brief Current state */
+    State state() const { return current_state; }
+    /*! @brief Highlighted menu entry */
+    MenuOption menuOption() const { return current_menu_option; }
+    /*! @brief Field being edited on the set alarm and set time screens */
+    TimeSetting editField() const { return edit_time_field; }
+    /*! @brief True if the alarm is armed */
+    bool alarmEnabled() const { return alarm_enabled; }
+    /*! @brief Alarm hour */
+    uint8_t alarmHour() const { return alarm_hour; }
+    /*! @brief Alarm minute */
+    uint8_t alarmMinute() const { return alarm_minute; }
+    /*! @brief Player volume */
+    uint8_t volume() const { return current_volume; }
+    /*! @brief True unless powered off after DISPLAY_TIMEOUT_S */
+    bool displayOn() const { return display_on; }
+
+private:
+    AlarmClockPlatform &platform;
+
+    State current_state = STATE_CLOCK;
+    MenuOption current_menu_option = MENU_SET_ALARM;
+    TimeSetting edit_time_field = TIME_HOUR;
+    bool display_on = true;
+    bool alarm_enabled = false;
+    uint8_t alarm_hour = 7;
+    uint8_t alarm_minute = 0;
+    uint8_t time_setting_hour = 7;
+    uint8_t time_setting_minute = 0;
+    uint8_t current_volume = 15;
+    uint64_t last_activity_time = 0;
+    uint64_t last_press_time[3] = {}; // Per button, for debouncing
+    uint64_t volume_bar_start_time = 0;
+    bool volume_bar_visible = false;
+    BurnInSchedule burn_in = DEFAULT_BURN_IN_SCHEDULE; // Moves the clock face around to spread pixel wear
+    uint8_t burn_in_offset = 0;
+    size_t dim_stage = 0;
+    int roll_offset = 0; // Rows the picture is still rolled by during a screen transition
+    uint64_t last_roll_step = 0;
+    uint64_t last_flash = 0;
+    uint8_t last_minute = 0xff; // Minute shown on the clock screen
+    DateTime current_time;
+
+    // Clock screen
+    ui_widget_t clock_time, clock_date, clock_alarm, volume_bar, alarm_flash;
+    ui_widget_t *const clock_widgets[5] = {&clock_time, &clock_date, &clock_alarm, &volume_bar, &alarm_flash};
+    const ui_screen_t clock_screen = {clock_widgets, 5};
+
+    // Menu screen
+    ui_widget_t menu_title, menu_list;
+    ui_widget_t *const menu_widgets[2] = {&menu_title, &menu_list};
+    const ui_screen_t menu_screen = {menu_widgets, 2};
+
+    // Set alarm / set time screen
+    ui_widget_t edit_title, edit_time, edit_hour_mark, edit_minute_mark;
+    ui_widget_t *const edit_widgets[4] = {&edit_title, &edit_time, &edit_hour_mark, &edit_minute_mark};
+    const ui_screen_t edit_screen = {edit_widgets, 4};
+
+    const ui_screen_t *current_screen = &clock_screen;
+
+    void initScreens();
+    void showScreen(const ui_screen_t *screen);
+    void showClock();
+    void updateAlarmIndicator();
+    void updateMenu();
+    void updateEditMarks();
+    void updateSetAlarm();
+    void updateSetTime();
+    void updateVolumeIndicator();
+    void startRollTransition(bool from_below);
+    void applyDimStage(size_t stage);
+    void programAlarm(const DateTime &alarm_time);
+    void powerDownPeripherals();
+    void powerUpPeripherals();
+    void resetActivity();
+    bool debounce(int button);
+    void handleAlarmFired();
+    void handleButtonUp();
+    void handleButtonDown();
+    void handleButtonSelect();
+    void handleTick();
+    void handlePlayerRx();
+};
+
+#endif
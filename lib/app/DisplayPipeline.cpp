@@ -0,0 +1,283 @@
+#include "DisplayPipeline.h"
+
+/**************************************************************************/
+/*!
+    @brief  Set up the pipeline, before anything can send it commands
+    @param  display Panel to draw on
+    @param  app Clock whose current screen is drawn
+    @param  multicore True to queue the commands for core 1, which then has
+            to call serve(). The caller, core 0, holds the widgets from
+            here on.
+*/
+/**************************************************************************/
+void DisplayPipeline::begin(ssd1309_t *display, const AlarmClock *app, bool multicore)
+{
+    this->display = display;
+    this->app = app;
+    this->multicore = multicore;
+    if (multicore)
+    {
+        queue_init(&queue, sizeof(uint32_t), DISPLAY_QUEUE_LENGTH);
+        mutex_init(&ui_mutex);
+        mutex_init(&stats_mutex);
+        mutex_enter_blocking(&ui_mutex);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run a display operation, or hand it to core 1
+    @details With two cores, must be called from core 0 while it holds the
+    widgets, i.e. outside release()/acquire().
+    @param  type Operation, see DisplayCommand
+    @param  a First argument
+    @param  b Second argument
+*/
+/**************************************************************************/
+void DisplayPipeline::command(DisplayCommand type, uint8_t a, uint8_t b)
+{
+    uint32_t cmd = type | (uint32_t)a << 8 | (uint32_t)b << 16;
+    if (!multicore)
+    {
+        run(cmd);
+        return;
+    }
+
+    if (queue_try_add(&queue, &cmd) || type == DISPLAY_RENDER)
+    {
+        // Renders are requested every loop iteration, the next one catches up
+        return;
+    }
+
+    // Core 1 may be waiting for the widgets to render before it gets to the
+    // rest of the queue
+    mutex_exit(&ui_mutex);
+    queue_add_blocking(&queue, &cmd);
+    mutex_enter_blocking(&ui_mutex);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Let core 1 render the widgets, e.g. while core 0 sleeps
+*/
+/**************************************************************************/
+void DisplayPipeline::release()
+{
+    if (multicore)
+    {
+        mutex_exit(&ui_mutex);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Take the widgets back from core 1 before changing them
+*/
+/**************************************************************************/
+void DisplayPipeline::acquire()
+{
+    if (multicore)
+    {
+        mutex_enter_blocking(&ui_mutex);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run the commands queued for core 1 without waiting for more
+    @return True if there were any
+*/
+/**************************************************************************/
+bool DisplayPipeline::runQueued()
+{
+    uint32_t cmd;
+    bool ran = false;
+    while (queue_try_remove(&queue, &cmd))
+    {
+        run(cmd);
+        ran = true;
+    }
+    return ran;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run the commands queued for core 1 as they arrive, never returns
+*/
+/**************************************************************************/
+void DisplayPipeline::serve()
+{
+    while (true)
+    {
+        uint32_t cmd;
+        queue_remove_blocking(&queue, &cmd);
+        run(cmd);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start timing an input until its result reaches the panel
+    @details Called from core 0 while it holds the widgets, like the
+    handlers that change them.
+    @param  irq_us time_us_32() when the input's interrupt fired
+*/
+/**************************************************************************/
+void DisplayPipeline::noteInput(uint32_t irq_us)
+{
+    input_us = irq_us;
+    input_pending = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Latency of the inputs served so far
+    @details Safe to call from either core, with or without the widgets.
+    @return Consistent copy of the counters
+*/
+/**************************************************************************/
+InputLatency DisplayPipeline::latency() const
+{
+    if (!multicore)
+    {
+        return stats;
+    }
+
+    mutex_enter_blocking(&stats_mutex);
+    InputLatency copy = stats;
+    mutex_exit(&stats_mutex);
+    return copy;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check for a frame held back by a flush in progress
+    @return True if a frame can be flushed now, so the caller should not
+            sleep until the next event
+*/
+/**************************************************************************/
+bool DisplayPipeline::flushPending()
+{
+    return dirty && !ssd1309_is_busy(display);
+}
+
+void DisplayPipeline::run(uint32_t cmd)
+{
+    uint8_t a = cmd >> 8;
+    uint8_t b = cmd >> 16;
+
+    switch ((DisplayCommand)(cmd & 0xff))
+    {
+    case DISPLAY_RENDER:
+        render();
+        break;
+    case DISPLAY_SHOW_SCREEN:
+        if (multicore)
+        {
+            mutex_enter_blocking(&ui_mutex);
+            ui_screen_show(display, app->screen());
+            mutex_exit(&ui_mutex);
+        }
+        else
+        {
+            ui_screen_show(display, app->screen());
+        }
+        break;
+    case DISPLAY_START_LINE:
+        ssd1309_set_start_line(display, a);
+        break;
+    case DISPLAY_OFFSET:
+        ssd1309_set_display_offset(display, a);
+        break;
+    case DISPLAY_CONTRAST:
+        ssd1309_contrast(display, a);
+        break;
+    case DISPLAY_ACTIVE_ROWS:
+        ssd1309_set_active_rows(display, a, b);
+        break;
+    case DISPLAY_POWER:
+        if (a)
+        {
+            ssd1309_poweron(display);
+        }
+        else
+        {
+            ssd1309_poweroff(display);
+        }
+        break;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Repaint dirty widgets and start flushing them to the panel
+*/
+/**************************************************************************/
+void DisplayPipeline::render()
+{
+    uint32_t irq_us;
+
+    if (multicore)
+    {
+        // Core 1 owns the panel, so a blocking flush only holds up rendering
+        mutex_enter_blocking(&ui_mutex);
+        bool changed = ui_render(display, app->screen());
+        bool served = takeInput(irq_us);
+        mutex_exit(&ui_mutex);
+        if (served)
+        {
+            inputServed(irq_us);
+        }
+        if (changed)
+        {
+            ssd1309_show_partial(display);
+        }
+        return;
+    }
+
+    if (ui_render(display, app->screen()))
+    {
+        dirty = true;
+    }
+
+    // Retried on the next loop iteration while a flush is in progress
+    if (dirty && ssd1309_show_async(display, NULL, NULL))
+    {
+        dirty = false;
+    }
+    if (!dirty && takeInput(irq_us))
+    {
+        inputServed(irq_us);
+    }
+}
+
+bool DisplayPipeline::takeInput(uint32_t &irq_us)
+{
+    if (!input_pending)
+    {
+        return false;
+    }
+    irq_us = input_us;
+    input_pending = false;
+    return true;
+}
+
+void DisplayPipeline::inputServed(uint32_t irq_us)
+{
+    uint32_t latency_us = time_us_32() - irq_us;
+    if (multicore)
+    {
+        mutex_enter_blocking(&stats_mutex);
+    }
+    stats.count++;
+    stats.last_us = latency_us;
+    stats.total_us += latency_us;
+    if (latency_us > stats.worst_us)
+    {
+        stats.worst_us = latency_us;
+    }
+    if (multicore)
+    {
+        mutex_exit(&stats_mutex);
+    }
+}
@@ -0,0 +1,82 @@
+/**************************************************************************/
+/*!
+  @file     DisplayPipeline.h
+
+  Runs the display commands of an AlarmClock against the panel, either
+  directly on the calling core or handed over a queue to core 1.
+
+  With two cores, the widgets are shared under a mutex: core 0 holds it
+  whenever it is awake and changing them, and core 1 takes it to render
+  them. The flush itself runs without it.
+*/
+/**************************************************************************/
+
+#ifndef _DISPLAY_PIPELINE_H_
+#define _DISPLAY_PIPELINE_H_
+
+#include "pico/stdlib.h"
+#include "pico/mutex.h"
+#include "pico/util/queue.h"
+
+#include "AlarmClock.h"
+
+#define DISPLAY_QUEUE_LENGTH 16 ///< Commands core 0 can get ahead of core 1
+
+/**************************************************************************/
+/*!
+    @brief  Time from an input interrupt until the frame showing its result
+            starts flushing
+*/
+/**************************************************************************/
+struct InputLatency
+{
+    uint32_t count;    ///< Inputs served
+    uint32_t last_us;  ///< Latency of the latest one
+    uint32_t worst_us; ///< Highest latency seen
+    uint64_t total_us; ///< Sum of all of them, for the mean
+};
+
+/**************************************************************************/
+/*!
+    @brief  Display side of the alarm clock, on one core or two
+*/
+/**************************************************************************/
+class DisplayPipeline
+{
+public:
+    void begin(ssd1309_t *display, const AlarmClock *app, bool multicore);
+    void command(DisplayCommand type, uint8_t a = 0, uint8_t b = 0);
+    void release();
+    void acquire();
+    bool runQueued();
+    void serve();
+    void noteInput(uint32_t irq_us);
+    bool flushPending();
+
+    InputLatency latency() const;
+
+private:
+    ssd1309_t *display = nullptr;
+    const AlarmClock *app = nullptr;
+    bool multicore = false;
+    queue_t queue;
+    mutex_t ui_mutex; // Held by core 0 while awake and by core 1 while rendering widgets
+    bool dirty = false; // A rendered frame still has to be flushed
+
+    // Input waiting to reach the panel. Written by core 0 and taken by
+    // core 1, both while holding ui_mutex.
+    bool input_pending = false;
+    uint32_t input_us = 0;
+
+    // Written by core 1 and read by core 0 at any time, so it has a mutex of
+    // its own rather than ui_mutex, which core 0 may already hold
+    mutable mutex_t stats_mutex;
+    InputLatency stats = {};
+
+    void run(uint32_t cmd);
+    void render();
+    bool takeInput(uint32_t &irq_us);
+    void inputServed(uint32_t irq_us);
+};
+
+#endif
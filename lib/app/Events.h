@@ -0,0 +1,58 @@
+/**************************************************************************/
+/*!
+  @file     Events.h
+
+  Events posted from interrupt context and dispatched by the main loop.
+
+  Each source has one pending bit rather than a slot in a queue, so a
+  burst of button presses cannot crowd out an alarm or a player message:
+  posting never fails, and a source that fires again before the loop gets
+  to it is dispatched once.
+*/
+/**************************************************************************/
+
+#ifndef _EVENTS_H_
+#define _EVENTS_H_
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * Event sources, dispatched in this order when several are pending. Presses
+ * come before the alarm, so one that landed just before it fired cannot
+ * silence it.
+ */
+enum Event : uint8_t
+{
+    EVENT_BUTTON_UP,     ///< Up button pressed
+    EVENT_BUTTON_DOWN,   ///< Down button pressed
+    EVENT_BUTTON_SELECT, ///< Select button pressed
+    EVENT_TICK,          ///< 1 Hz timer tick
+    EVENT_ALARM,         ///< RTC alarm interrupt
+    EVENT_PLAYER_RX,     ///< DFPlayer sent data
+    EVENT_COUNT
+};
+
+/*! @brief Pending bit of an event */
+constexpr uint32_t eventBit(Event event) { return 1u << event; }
+
+/**************************************************************************/
+/*!
+    @brief  Pending events, set from interrupts and taken by the main loop
+*/
+/**************************************************************************/
+class EventFlags
+{
+public:
+    /*! @brief Mark an event pending, safe to call from interrupts */
+    void post(Event event) { pending.fetch_or(eventBit(event), std::memory_order_release); }
+    /*! @brief Take all pending events, leaving none */
+    uint32_t take() { return pending.exchange(0, std::memory_order_acquire); }
+    /*! @brief True if no event is pending */
+    bool empty() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    std::atomic<uint32_t> pending{0};
+};
+
+#endif
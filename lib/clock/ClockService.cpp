@@ -0,0 +1,158 @@
+#include <stdio.h>
+
+#include "pico/stdlib.h"
+#include "ClockService.h"
+
+#define US_PER_S 1000000LL
+
+/**************************************************************************/
+/*!
+    @brief  Create a clock service
+    @param  monotonic source of monotonic microseconds, defaults to
+            time_us_64. Tests can pass a fake.
+    @param  sleep sleep used between RTC reads in begin(), defaults to
+            sleep_us. Tests pass one that moves their fake time on.
+*/
+/**************************************************************************/
+ClockService::ClockService(MonotonicFn monotonic, SleepFn sleep)
+    : monotonic(monotonic ? monotonic : time_us_64), sleep(sleep ? sleep : sleep_us)
+{
+}
+
+/**************************************************************************/
+/*!
+    @brief  Attach to the RTC and load the current time from it
+
+    Waits for the RTC seconds to roll over (up to two seconds) so the local
+    clock starts in phase with the RTC. The RTC is read every
+    CLOCK_ROLLOVER_POLL_US rather than back to back, which keeps the bus
+    mostly idle at boot; the rollover is placed halfway between the last
+    two reads, so the local clock starts within half that interval of the
+    RTC. Failed reads are retried at the same pace within the two seconds.
+
+    @param  rtc initialized DS3231, used for resyncs and adjustments
+    @param  resync_interval_s seconds between RTC reads, 0 to never resync
+    @return true once in phase, false if the RTC could not be read or its
+            seconds did not advance. Without any reading, the clock counts
+            on from its previous time and update() keeps trying to sync.
+*/
+/**************************************************************************/
+bool ClockService::begin(RTC_DS3231 *rtc, uint32_t resync_interval_s)
+{
+    this->rtc = rtc;
+    resync_interval_us = resync_interval_s * US_PER_S;
+    last_drift_us = 0;
+
+    DateTime dt;
+    bool have_start = false;
+    uint32_t start = 0;
+    uint32_t t = 0;
+    uint64_t read_us = monotonic();
+    uint64_t last_read_us = read_us;
+    uint64_t deadline = read_us + 2 * US_PER_S;
+    while (true)
+    {
+        if (rtc->read(dt))
+        {
+            t = dt.unixtime();
+            if (!have_start)
+            {
+                start = t;
+                have_start = true;
+            }
+            else if (t != start)
+                break;
+            last_read_us = read_us;
+        }
+        sleep(CLOCK_ROLLOVER_POLL_US);
+        read_us = monotonic();
+        if (read_us >= deadline)
+            break;
+    }
+    if (!have_start)
+        return false;
+
+    base_unixtime = t;
+    last_sync_us = monotonic();
+    base_us = t != start ? last_read_us + (read_us - last_read_us) / 2 : last_sync_us;
+    synced = true;
+    return t != start;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Resync from the RTC when the interval has passed, or until a
+            first reading succeeded. Call periodically, e.g. once per second.
+*/
+/**************************************************************************/
+void ClockService::update()
+{
+    if (!synced || (resync_interval_us && monotonic() - last_sync_us >= resync_interval_us))
+        sync();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Correct the local clock against the RTC and log the drift
+
+    The RTC only resolves whole seconds, so the local clock is only moved
+    when it has left the second the RTC reports, and then by as little as
+    possible. This keeps the sub-second phase found by begin() and the
+    local clock within a second of the RTC. If the RTC cannot be read the
+    local clock is left alone and the next update() tries again.
+*/
+/**************************************************************************/
+void ClockService::sync()
+{
+    DateTime dt;
+    if (!rtc->read(dt))
+        return;
+    uint32_t rtc_s = dt.unixtime();
+    uint64_t t = monotonic();
+
+    // Local time relative to the start of the RTC second
+    int64_t local_us = ((int64_t)base_unixtime - (int64_t)rtc_s) * US_PER_S + (int64_t)(t - base_us);
+    int64_t phase_us = local_us;
+    if (phase_us < 0)
+        phase_us = 0;
+    else if (phase_us >= US_PER_S)
+        phase_us = US_PER_S - 1;
+
+    last_drift_us = phase_us - local_us;
+    if (last_drift_us)
+    {
+        printf("Clock resync: corrected by %+lld us after %llu s\n",
+               (long long)last_drift_us, (unsigned long long)((t - last_sync_us) / US_PER_S));
+    }
+
+    base_unixtime = rtc_s;
+    base_us = t - phase_us;
+    last_sync_us = t;
+    synced = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Set the RTC and the local clock
+    @param  dt new date and time
+*/
+/**************************************************************************/
+void ClockService::adjust(const DateTime &dt)
+{
+    // Writing the seconds register restarts the RTC's one second countdown
+    rtc->adjust(dt);
+    base_unixtime = dt.unixtime();
+    base_us = last_sync_us = monotonic();
+    synced = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Current time from the local clock, without touching the RTC
+    @return DateTime of the current second
+*/
+/**************************************************************************/
+DateTime ClockService::now() const
+{
+    return DateTime(base_unixtime + (uint32_t)((monotonic() - base_us) / US_PER_S));
+}
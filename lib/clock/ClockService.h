@@ -0,0 +1,62 @@
+/**************************************************************************/
+/*!
+  @file     ClockService.h
+
+  Local software clock kept in step with a DS3231.
+
+  The time is answered from the last RTC reading plus the microseconds
+  elapsed on the Pico's monotonic timer since then. The RTC is only read
+  at startup and on a resync interval, so reading the time costs no I2C
+  traffic. A failed read never moves the clock; the read is tried again on
+  the next update().
+*/
+/**************************************************************************/
+
+#ifndef _CLOCK_SERVICE_H_
+#define _CLOCK_SERVICE_H_
+
+#include <RTClib.h>
+
+#define CLOCK_DEFAULT_RESYNC_S 3600 ///< Seconds between RTC reads by default
+#define CLOCK_ROLLOVER_POLL_US 5000 ///< Time between RTC reads while begin() waits for a rollover
+
+/**************************************************************************/
+/*!
+    @brief  Software clock derived from the monotonic timer and resynchronized
+            from a DS3231
+*/
+/**************************************************************************/
+class ClockService
+{
+public:
+    /*! Source of monotonic microseconds, time_us_64 on target */
+    typedef uint64_t (*MonotonicFn)(void);
+    /*! Sleep for some microseconds, sleep_us on target */
+    typedef void (*SleepFn)(uint64_t us);
+
+    explicit ClockService(MonotonicFn monotonic = nullptr, SleepFn sleep = nullptr);
+    bool begin(RTC_DS3231 *rtc, uint32_t resync_interval_s = CLOCK_DEFAULT_RESYNC_S);
+    void update();
+    void sync();
+    void adjust(const DateTime &dt);
+    DateTime now() const;
+    /*!
+        @brief  Correction applied by the last resync
+        @return microseconds the local clock was moved forward (positive) or
+                back (negative)
+    */
+    int64_t lastDrift() const { return last_drift_us; }
+
+private:
+    RTC_DS3231 *rtc = nullptr;
+    MonotonicFn monotonic;
+    SleepFn sleep;
+    uint32_t base_unixtime = SECONDS_FROM_1970_TO_2000; ///< RTC second the local clock counts from
+    uint64_t base_us = 0;          ///< Monotonic time at which base_unixtime began
+    uint64_t last_sync_us = 0;     ///< Monotonic time of the last RTC read
+    uint64_t resync_interval_us = 0; ///< Time between RTC reads, 0 to never resync
+    int64_t last_drift_us = 0;     ///< Correction applied by the last resync
+    bool synced = false;           ///< base_unixtime was read from the RTC
+};
+
+#endif
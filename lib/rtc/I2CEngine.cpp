@@ -0,0 +1,356 @@
+#include "I2CEngine.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define I2C_FIFO_DEPTH 16       ///< Entries in the controller's TX and RX FIFOs
+#define I2C_RECOVERY_PULSES 9   ///< SCL pulses that release any stuck target
+#define I2C_RECOVERY_HALF_US 5  ///< Half period of the recovery clock (100 kHz)
+#define I2C_ABRT_NOACK_BITS                                                       \
+    (I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS |                              \
+     I2C_IC_TX_ABRT_SOURCE_ABRT_10ADDR1_NOACK_BITS |                              \
+     I2C_IC_TX_ABRT_SOURCE_ABRT_10ADDR2_NOACK_BITS |                              \
+     I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS) ///< Aborts caused by a NAK
+
+I2CEngine *I2CEngine::instances[2];
+
+/**************************************************************************/
+/*!
+    @brief  Take over an initialized I2C controller
+    @details i2c_init() must have been called. The pins are only needed for
+    bus recovery; without them a timeout just fails the request.
+    @param  i2c_instance pointer to the I2C bus (i2c0 or i2c1)
+    @param  sda_pin GPIO used as SDA, -1 if unknown
+    @param  scl_pin GPIO used as SCL, -1 if unknown
+    @return True
+*/
+/**************************************************************************/
+bool I2CEngine::begin(i2c_inst_t *i2c_instance, int sda_pin, int scl_pin)
+{
+    uint index = i2c_get_index(i2c_instance);
+
+    i2c = i2c_instance;
+    hw = i2c_get_hw(i2c_instance);
+    sda = sda_pin;
+    scl = scl_pin;
+    head = count = 0;
+    active = nullptr;
+    counters = {};
+
+    hw->intr_mask = 0;
+    instances[index] = this;
+    uint irq = index ? I2C1_IRQ : I2C0_IRQ;
+    irq_set_exclusive_handler(irq, index ? irqHandler1 : irqHandler0);
+    irq_set_enabled(irq, true);
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start a request, or queue it behind the active one
+    @details The request must stay valid until done is set. The callback
+    runs in interrupt context and may submit further requests.
+    @param  req Request to run
+    @return False if the queue is full
+*/
+/**************************************************************************/
+bool I2CEngine::submit(I2CRequest *req)
+{
+    req->done = false;
+    req->result = PICO_ERROR_GENERIC;
+
+    uint32_t save = save_and_disable_interrupts();
+    bool ok = true;
+    if (!active)
+        start(req);
+    else if (count < I2C_QUEUE_LENGTH)
+        queue[(head + count++) % I2C_QUEUE_LENGTH] = req;
+    else
+        ok = false;
+    restore_interrupts(save);
+    return ok;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Run a transaction and wait for it to complete
+    @param  addr 7-bit target address
+    @param  tx Bytes to write
+    @param  tx_len Number of bytes to write, at most I2C_REQUEST_TX_MAX
+    @param  rx Buffer for the bytes read, may be null if rx_len is 0
+    @param  rx_len Number of bytes to read after a repeated start
+    @param  timeout_us Time allowed for each attempt
+    @param  retries Attempts to make after the first one failed
+    @return Bytes transferred, or PICO_ERROR_GENERIC on a NAK or when no
+            alarm was free for the timeout, and PICO_ERROR_TIMEOUT if the
+            bus hung, as reported by the last attempt
+*/
+/**************************************************************************/
+int I2CEngine::transfer(uint8_t addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx,
+                        uint8_t rx_len, uint32_t timeout_us, uint8_t retries)
+{
+    if (tx_len > I2C_REQUEST_TX_MAX || tx_len + rx_len == 0)
+        return PICO_ERROR_GENERIC;
+
+    I2CRequest req = {};
+    req.addr = addr;
+    for (uint8_t i = 0; i < tx_len; ++i)
+        req.tx[i] = tx[i];
+    req.tx_len = tx_len;
+    req.rx = rx;
+    req.rx_len = rx_len;
+    req.timeout_us = timeout_us;
+
+    for (;;)
+    {
+        if (!submit(&req))
+            return PICO_ERROR_GENERIC;
+        while (!req.done)
+            tight_loop_contents();
+        if (req.result >= 0 || !retries--)
+            return req.result;
+        ++counters.retries;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Free a bus held low by a target that lost track of a transfer
+    @details Clocks SCL until the target lets SDA go, then sends a STOP.
+    Both lines are driven open drain and handed back to the controller.
+*/
+/**************************************************************************/
+void I2CEngine::recoverBus()
+{
+    if (sda < 0 || scl < 0)
+        return;
+
+    // A line is pulled low by making it an output at 0, released by making it an input
+    gpio_put(sda, 0);
+    gpio_put(scl, 0);
+    gpio_set_dir(sda, GPIO_IN);
+    gpio_set_dir(scl, GPIO_IN);
+    gpio_set_function(sda, GPIO_FUNC_SIO);
+    gpio_set_function(scl, GPIO_FUNC_SIO);
+
+    for (int i = 0; i < I2C_RECOVERY_PULSES && !gpio_get(sda); ++i)
+    {
+        gpio_set_dir(scl, GPIO_OUT);
+        busy_wait_us_32(I2C_RECOVERY_HALF_US);
+        gpio_set_dir(scl, GPIO_IN);
+        busy_wait_us_32(I2C_RECOVERY_HALF_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    gpio_set_dir(sda, GPIO_OUT);
+    busy_wait_us_32(I2C_RECOVERY_HALF_US);
+    gpio_set_dir(sda, GPIO_IN);
+    busy_wait_us_32(I2C_RECOVERY_HALF_US);
+
+    gpio_set_function(sda, GPIO_FUNC_I2C);
+    gpio_set_function(scl, GPIO_FUNC_I2C);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Address the target and push the first commands of a request
+    @details A request that cannot get a timeout alarm is failed without
+    touching the bus, since nothing could end it if the bus hung.
+    @param  req Request to make active
+*/
+/**************************************************************************/
+void I2CEngine::start(I2CRequest *req)
+{
+    active = req;
+    cmds_sent = 0;
+    rx_received = 0;
+    aborted = false;
+
+    alarm = add_alarm_in_us(req->timeout_us, timeoutCallback, this, true);
+    if (alarm < 0)
+    {
+        alarm = 0;
+        ++counters.errors;
+        finish(PICO_ERROR_GENERIC);
+        return;
+    }
+
+    hw->enable = 0;
+    hw->tar = req->addr;
+    hw->enable = 1;
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+
+    fill();
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS |
+                    I2C_IC_INTR_MASK_M_RX_FULL_BITS | (canFill() ? I2C_IC_INTR_MASK_M_TX_EMPTY_BITS : 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Push as many commands of the active request as the FIFOs allow
+    @details Writes come first, then one read command per byte to read. The
+    first read gets a repeated start and the last command a STOP. Reads
+    are only issued while the RX FIFO has room for their data.
+*/
+/**************************************************************************/
+void I2CEngine::fill()
+{
+    I2CRequest *req = active;
+    uint total = req->tx_len + req->rx_len;
+
+    while (cmds_sent < total && i2c_get_write_available(i2c))
+    {
+        uint32_t cmd;
+        if (cmds_sent < req->tx_len)
+        {
+            cmd = req->tx[cmds_sent];
+        }
+        else
+        {
+            if (cmds_sent - req->tx_len - rx_received >= I2C_FIFO_DEPTH)
+                break;
+            cmd = I2C_IC_DATA_CMD_CMD_BITS;
+            if (cmds_sent == req->tx_len && req->tx_len)
+                cmd |= I2C_IC_DATA_CMD_RESTART_BITS;
+        }
+        if (cmds_sent == total - 1)
+            cmd |= I2C_IC_DATA_CMD_STOP_BITS;
+
+        hw->data_cmd = cmd;
+        ++cmds_sent;
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check whether room in the TX FIFO would let fill() push more
+    @details Not while reads are held back for room in the RX FIFO: the
+    data arriving for them raises RX_FULL, whose handling reads it out
+    and fills again. Until then TX_EMPTY would only fire for nothing.
+    @return True if TX_EMPTY should be unmasked
+*/
+/**************************************************************************/
+bool I2CEngine::canFill() const
+{
+    const I2CRequest *req = active;
+    if (aborted || cmds_sent == req->tx_len + req->rx_len)
+        return false;
+    return cmds_sent < req->tx_len || cmds_sent - req->tx_len - rx_received < I2C_FIFO_DEPTH;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Move data between the FIFOs and the active request
+    @details The controller always ends with a STOP, also after an abort,
+    so the request completes on STOP_DET.
+*/
+/**************************************************************************/
+void I2CEngine::handleIrq()
+{
+    I2CRequest *req = active;
+    uint32_t stat = hw->intr_stat;
+
+    if (!req)
+    {
+        hw->intr_mask = 0;
+        return;
+    }
+
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+    {
+        // Read the cause before clearing, which also clears the source register
+        aborted = true;
+        abort_source = hw->tx_abrt_source;
+        (void)hw->clr_tx_abrt;
+    }
+
+    while (i2c_get_read_available(i2c) && rx_received < req->rx_len)
+        req->rx[rx_received++] = (uint8_t)hw->data_cmd;
+
+    if (!aborted)
+        fill();
+    if (canFill())
+        hw->intr_mask |= I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+    else
+        hw->intr_mask &= ~I2C_IC_INTR_MASK_M_TX_EMPTY_BITS;
+
+    if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+    {
+        (void)hw->clr_stop_det;
+        if (aborted || rx_received < req->rx_len)
+        {
+            if (aborted && (abort_source & I2C_ABRT_NOACK_BITS))
+                ++counters.naks;
+            else
+                ++counters.errors;
+            finish(PICO_ERROR_GENERIC);
+        }
+        else
+            finish(req->rx_len ? req->rx_len : req->tx_len);
+    }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Complete the active request and start the next queued one
+    @param  result Value reported in the request
+*/
+/**************************************************************************/
+void I2CEngine::finish(int result)
+{
+    I2CRequest *req = active;
+
+    if (alarm > 0)
+        cancel_alarm(alarm);
+    alarm = 0;
+    hw->intr_mask = 0;
+    active = nullptr;
+    ++counters.transactions;
+
+    req->result = result;
+    req->done = true;
+    if (req->callback)
+        req->callback(req);
+
+    // The callback may have started a request already
+    if (!active && count)
+    {
+        I2CRequest *next = queue[head];
+        head = (head + 1) % I2C_QUEUE_LENGTH;
+        --count;
+        start(next);
+    }
+}
+
+void I2CEngine::irqHandler0()
+{
+    instances[0]->handleIrq();
+}
+
+void I2CEngine::irqHandler1()
+{
+    instances[1]->handleIrq();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Fail the active request when its time is up
+    @details The controller is stopped and the bus recovered, which takes
+    under 100 us, before the next request is started.
+*/
+/**************************************************************************/
+int64_t I2CEngine::timeoutCallback(alarm_id_t id, void *user_data)
+{
+    I2CEngine *engine = static_cast<I2CEngine *>(user_data);
+
+    if (engine->active && engine->alarm == id)
+    {
+        engine->alarm = 0;
+        engine->hw->intr_mask = 0;
+        engine->hw->enable = 0;
+        engine->recoverBus();
+        ++engine->counters.timeouts;
+        engine->finish(PICO_ERROR_TIMEOUT);
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**************************************************************************/
+/*!
+  @file     I2CEngine.h
+
+  Interrupt driven I2C transactions.
+
+  A transaction is a register write optionally followed by a repeated start
+  and a read, which covers everything the DS3231 needs. Requests are queued
+  and run one after another from the I2C interrupt, so the caller is free
+  to do other work until the completion callback runs. Every request has a
+  timeout; when it expires the bus is recovered by clocking SCL until the
+  target releases SDA. Failures are counted so flaky wiring shows up in the
+  diagnostics.
+*/
+/**************************************************************************/
+
+#ifndef _I2C_ENGINE_H_
+#define _I2C_ENGINE_H_
+
+#include "hardware/i2c.h"
+#include "pico/stdlib.h"
+#include <stdint.h>
+
+#define I2C_REQUEST_TX_MAX 8          ///< Largest write, register address included
+#define I2C_QUEUE_LENGTH 8            ///< Requests that can wait behind the active one
+#define I2C_DEFAULT_TIMEOUT_US 5000   ///< Timeout of a transaction unless given
+
+struct I2CRequest;
+
+/*! Called from interrupt context when a request completes */
+typedef void (*I2CCallback)(I2CRequest *req);
+
+/**************************************************************************/
+/*!
+    @brief  One I2C transaction, owned by the caller until it is done
+*/
+/**************************************************************************/
+struct I2CRequest
+{
+    uint8_t addr;                   ///< 7-bit target address
+    uint8_t tx[I2C_REQUEST_TX_MAX]; ///< Bytes to write
+    uint8_t tx_len;                 ///< Number of bytes to write
+    uint8_t *rx;                    ///< Buffer for the bytes read
+    uint8_t rx_len;                 ///< Number of bytes to read, 0 for a plain write
+    uint32_t timeout_us;            ///< Time allowed from start to stop
+    I2CCallback callback;           ///< Completion callback, may be null
+    void *user_data;                ///< Passed through to the callback
+    volatile int result;            ///< Bytes transferred, or a PICO_ERROR_ code
+    volatile bool done;             ///< Set once result is valid
+};
+
+/**************************************************************************/
+/*!
+    @brief  Bus health counters, kept since begin() or the last resetStats()
+*/
+/**************************************************************************/
+struct I2CStats
+{
+    uint32_t transactions; ///< Requests completed, successful or not
+    uint32_t naks;         ///< Address or data not acknowledged by the target
+    uint32_t timeouts;     ///< Requests that ran out of time, each followed by a bus recovery
+    uint32_t errors;       ///< Other aborts, e.g. lost arbitration, and requests without a timeout alarm
+    uint32_t retries;      ///< Requests repeated by transfer() after a failure
+};
+
+/**************************************************************************/
+/*!
+    @brief  Queue of I2C transactions run from the I2C interrupt
+*/
+/**************************************************************************/
+class I2CEngine
+{
+public:
+    bool begin(i2c_inst_t *i2c_instance, int sda_pin = -1, int scl_pin = -1);
+    bool submit(I2CRequest *req);
+    int transfer(uint8_t addr, const uint8_t *tx, uint8_t tx_len, uint8_t *rx,
+                 uint8_t rx_len, uint32_t timeout_us = I2C_DEFAULT_TIMEOUT_US,
+                 uint8_t retries = 0);
+    void recoverBus();
+    /*! @brief True while a request is running or queued */
+    bool busy() const { return active != nullptr; }
+    /*! @brief Bus health counters */
+    I2CStats stats() const { return counters; }
+    /*! @brief Zero the bus health counters */
+    void resetStats() { counters = {}; }
+
+private:
+    i2c_inst_t *i2c = nullptr;
+    i2c_hw_t *hw = nullptr;
+    int sda = -1;
+    int scl = -1;
+
+    I2CRequest *queue[I2C_QUEUE_LENGTH];
+    uint8_t head = 0;
+    uint8_t count = 0;
+
+    I2CRequest *volatile active = nullptr;
+    uint8_t cmds_sent = 0;   ///< Commands of the active request pushed to the TX FIFO
+    uint8_t rx_received = 0; ///< Bytes of the active request read back
+    bool aborted = false;    ///< Controller reported a NAK or lost arbitration
+    uint32_t abort_source = 0; ///< TX_ABRT_SOURCE of the abort
+    alarm_id_t alarm = 0;    ///< Timeout of the active request
+    I2CStats counters = {};
+
+    static I2CEngine *instances[2];
+
+    void start(I2CRequest *req);
+    void fill();
+    bool canFill() const;
+    void handleIrq();
+    void finish(int result);
+    static void irqHandler0();
+    static void irqHandler1();
+    static int64_t timeoutCallback(alarm_id_t id, void *user_data);
+};
+
+#endif
@@ -6,35 +6,233 @@
 #define DS3231_ALARM2 0x0B    ///< Alarm 2 register
 #define DS3231_CONTROL 0x0E   ///< Control register
 #define DS3231_STATUSREG 0x0F ///< Status register
+#define DS3231_AGINGREG 0x10  ///< Aging offset register
 #define DS3231_TEMPERATUREREG \
     0x11 ///< Temperature register (high byte - low byte is at 0x12), 10-bit
          ///< temperature value
+#define DS3231_VERIFY_FIRST DS3231_ALARM1 ///< First register compared by verifyBus()
+#define DS3231_VERIFY_COUNT \
+    (DS3231_AGINGREG - DS3231_VERIFY_FIRST + 1) ///< Alarms, control, status and aging
+#define DS3231_VERIFY_READS 2 ///< Reads compared by verifyBus()
 
 /**************************************************************************/
 /*!
     @brief  Start I2C for the DS3231 and test succesful connection
+    @details The DS3231 is probed in standard mode, then max_baudrate is
+    tried and kept if registers read over it match those read in standard
+    mode. Otherwise the bus stays at DS3231_STANDARD_BAUDRATE. Nothing is
+    written to the DS3231.
     @param  i2c_instance pointer to the I2C bus (i2c0 or i2c1)
     @param  address I2C address of the DS3231 (default 0x68)
+    @param  sda_pin GPIO used as SDA, needed to recover a stuck bus
+    @param  scl_pin GPIO used as SCL, needed to recover a stuck bus
+    @param  max_baudrate Fastest bus rate to try in Hz
     @return True if DS3231 responds, false otherwise
 */
 /**************************************************************************/
-bool RTC_DS3231::begin(i2c_inst_t *i2c_instance, uint8_t address)
+bool RTC_DS3231::begin(i2c_inst_t *i2c_instance, uint8_t address, int sda_pin, int scl_pin,
+                       uint32_t max_baudrate)
 {
     i2c = i2c_instance;
     addr = address;
+    bus.begin(i2c_instance, sda_pin, scl_pin);
+
+    // Test if device responds by reading the reference for verifyBus(),
+    // which also loads the CONTROL/STATUS shadow
+    baud = i2c_set_baudrate(i2c, DS3231_STANDARD_BAUDRATE);
+    shadow_valid = false;
+    uint8_t reference[DS3231_VERIFY_COUNT];
+    if (!readRegisters(DS3231_VERIFY_FIRST, reference, DS3231_VERIFY_COUNT))
+        return false;
+    control = reference[DS3231_CONTROL - DS3231_VERIFY_FIRST];
+    status = reference[DS3231_STATUSREG - DS3231_VERIFY_FIRST];
+    shadow_valid = true;
+
+    if (max_baudrate > DS3231_STANDARD_BAUDRATE)
+    {
+        uint32_t fast = i2c_set_baudrate(i2c, max_baudrate);
+        if (verifyBus(reference))
+            baud = fast;
+        else
+            i2c_set_baudrate(i2c, DS3231_STANDARD_BAUDRATE);
+    }
+
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check the bus at the current rate by reading registers only
+    @details The alarm, CONTROL and aging registers do not change on their
+    own, so they are read back DS3231_VERIFY_READS times without retries
+    and compared with the same burst read in standard mode. Any NAK,
+    timeout or flipped bit fails. STATUS is skipped, the chip sets its
+    flags at any time.
+    @param  reference Registers DS3231_VERIFY_FIRST onwards read at
+            DS3231_STANDARD_BAUDRATE
+    @return True if every read matched the reference
+*/
+/**************************************************************************/
+bool RTC_DS3231::verifyBus(const uint8_t *reference)
+{
+    uint8_t reg = DS3231_VERIFY_FIRST;
+
+    for (int i = 0; i < DS3231_VERIFY_READS; ++i)
+    {
+        uint8_t check[DS3231_VERIFY_COUNT];
 
-    // Test if device responds by trying to read a register
-    uint8_t test_reg = DS3231_CONTROL;
-    uint8_t dummy;
+        if (bus.transfer(addr, &reg, 1, check, DS3231_VERIFY_COUNT) != DS3231_VERIFY_COUNT)
+            return false;
+        for (uint8_t j = 0; j < DS3231_VERIFY_COUNT; ++j)
+            if (j != DS3231_STATUSREG - DS3231_VERIFY_FIRST && check[j] != reference[j])
+                return false;
+    }
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read consecutive registers
+    @param  reg First register
+    @param  buffer Buffer for the register values
+    @param  len Number of registers
+    @return True if the DS3231 responded in time
+*/
+/**************************************************************************/
+bool RTC_DS3231::readRegisters(uint8_t reg, uint8_t *buffer, uint8_t len)
+{
+    return bus.transfer(addr, &reg, 1, buffer, len, I2C_DEFAULT_TIMEOUT_US, DS3231_RETRIES) == len;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Write consecutive registers
+    @param  buffer First register followed by the values
+    @param  len Number of bytes in buffer, register included
+    @return True if the DS3231 acknowledged every byte in time
+*/
+/**************************************************************************/
+bool RTC_DS3231::writeRegisters(const uint8_t *buffer, uint8_t len)
+{
+    return bus.transfer(addr, buffer, len, nullptr, 0, I2C_DEFAULT_TIMEOUT_US, DS3231_RETRIES) == len;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Start reading consecutive registers without waiting
+    @details The read runs from the I2C interrupt while the caller carries
+    on, and the callback runs in interrupt context once buffer is filled or
+    the read failed (req.result < 0). req and buffer must stay valid until
+    then. Use the decode helpers on the result, e.g. a read of 7 bytes
+    from register 0 holds the time.
+    @param  req Request to fill in and submit
+    @param  reg First register
+    @param  buffer Buffer for the register values
+    @param  len Number of registers
+    @param  callback Called on completion, may be null to poll req.done
+    @param  user_data Passed to the callback in req.user_data
+    @return False if the request could not be queued
+*/
+/**************************************************************************/
+bool RTC_DS3231::readAsync(I2CRequest &req, uint8_t reg, uint8_t *buffer, uint8_t len,
+                           I2CCallback callback, void *user_data)
+{
+    req.addr = addr;
+    req.tx[0] = reg;
+    req.tx_len = 1;
+    req.rx = buffer;
+    req.rx_len = len;
+    req.timeout_us = I2C_DEFAULT_TIMEOUT_US;
+    req.callback = callback;
+    req.user_data = user_data;
+    return bus.submit(&req);
+}
 
-    int result = i2c_write_blocking(i2c, addr, &test_reg, 1, true);
-    if (result < 0)
+/**************************************************************************/
+/*!
+    @brief  Read CONTROL and STATUS in one burst into the shadow copies
+    @return True if the DS3231 responded
+*/
+/**************************************************************************/
+bool RTC_DS3231::refreshShadow()
+{
+    uint8_t buffer[2];
+
+    if (!readRegisters(DS3231_CONTROL, buffer, 2))
         return false;
 
-    result = i2c_read_blocking(i2c, addr, &dummy, 1, false);
-    if (result < 0)
+    control = buffer[0];
+    status = buffer[1];
+    shadow_valid = true;
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  CONTROL register, from the shadow when valid
+    @return Register value
+*/
+/**************************************************************************/
+uint8_t RTC_DS3231::shadowControl()
+{
+    if (!shadow_valid)
+        refreshShadow();
+    return control;
+}
+
+/**************************************************************************/
+/*!
+    @brief  STATUS register as last read, refreshed when the shadow is invalid
+    @return Register value
+*/
+/**************************************************************************/
+uint8_t RTC_DS3231::shadowStatus()
+{
+    if (!shadow_valid)
+        refreshShadow();
+    return status;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Write CONTROL and keep the shadow in step
+    @param  val New register value
+    @return True if the DS3231 acknowledged the write, otherwise the shadow
+            is invalidated
+*/
+/**************************************************************************/
+bool RTC_DS3231::writeControl(uint8_t val)
+{
+    if (!write_register(DS3231_CONTROL, val))
+    {
+        shadow_valid = false;
         return false;
+    }
+    control = val;
+    return true;
+}
 
+/**************************************************************************/
+/*!
+    @brief  Write STATUS without reading it first
+    @details OSF, A1F and A2F can only be cleared by writing 0, writing 1
+    leaves them unchanged, so flags not being cleared are written as 1.
+    @param  en32k EN32kHz bit value (0 or 1)
+    @param  clear_flags Mask of the OSF/A1F/A2F flags to clear
+    @return True if the DS3231 acknowledged the write, otherwise the shadow
+            is invalidated
+*/
+/**************************************************************************/
+bool RTC_DS3231::writeStatus(uint8_t en32k, uint8_t clear_flags)
+{
+    shadowStatus(); // load the shadow before updating it below
+    uint8_t val = ((0x83 & ~clear_flags) | (en32k ? 0x08 : 0x00));
+    if (!write_register(DS3231_STATUSREG, val))
+    {
+        shadow_valid = false;
+        return false;
+    }
+    status = (status & ~(clear_flags | 0x08)) | (val & 0x08);
     return true;
 }
 
@@ -43,12 +241,14 @@ bool RTC_DS3231::begin(i2c_inst_t *i2c_instance, uint8_t address)
     @brief  Check the status register Oscillator Stop Flag to see if the DS3231
    stopped due to power loss
     @return True if the bit is set (oscillator stopped) or false if it is
-   running
+   running or the DS3231 did not respond
 */
 /**************************************************************************/
 bool RTC_DS3231::lostPower(void)
 {
-    return read_register(DS3231_STATUSREG) >> 7;
+    if (!refreshShadow())
+        return false;
+    return status >> 7;
 }
 
 /**************************************************************************/
@@ -67,27 +267,59 @@ void RTC_DS3231::adjust(const DateTime &dt)
                          bin2bcd(dt.day()),
                          bin2bcd(dt.month()),
                          bin2bcd(dt.year() - 2000U)};
-    i2c_write_blocking(i2c, addr, buffer, 8, false);
+    writeRegisters(buffer, 8);
 
-    uint8_t statreg = read_register(DS3231_STATUSREG);
-    statreg &= ~0x80; // flip OSF bit
-    write_register(DS3231_STATUSREG, statreg);
+    writeStatus(isEnabled32K(), 0x80); // flip OSF bit
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read the current date/time
+    @details A failed transfer or registers that do not decode to a valid
+    date leave dt unchanged.
+    @param  dt DateTime to fill in
+    @return True if dt holds the time read from the DS3231
+*/
+/**************************************************************************/
+bool RTC_DS3231::read(DateTime &dt)
+{
+    uint8_t buffer[7];
+
+    if (!readRegisters(DS3231_TIME, buffer, 7))
+        return false;
+
+    DateTime t = decodeTime(buffer);
+    if (!t.isValid())
+        return false;
+    dt = t;
+    return true;
 }
 
 /**************************************************************************/
 /*!
     @brief  Get the current date/time
-    @return DateTime object with the current date/time
+    @return DateTime object with the current date/time, 2000-01-01 00:00:00
+            if it could not be read. Use read() to tell.
 */
 /**************************************************************************/
 DateTime RTC_DS3231::now()
 {
-    uint8_t buffer[7];
-    uint8_t reg = DS3231_TIME;
+    DateTime dt;
+
+    read(dt);
 
-    i2c_write_blocking(i2c, addr, &reg, 1, true); // keep=true to not release bus
-    i2c_read_blocking(i2c, addr, buffer, 7, false);
+    return dt;
+}
 
+/**************************************************************************/
+/*!
+    @brief  Decode the time registers
+    @param  buffer Registers 0x00-0x06
+    @return DateTime object with the date/time
+*/
+/**************************************************************************/
+DateTime RTC_DS3231::decodeTime(const uint8_t *buffer)
+{
     return DateTime(bcd2bin(buffer[6]) + 2000U, bcd2bin(buffer[5] & 0x7F),
                     bcd2bin(buffer[4]), bcd2bin(buffer[2]), bcd2bin(buffer[1]),
                     bcd2bin(buffer[0] & 0x7F));
@@ -102,7 +334,7 @@ DateTime RTC_DS3231::now()
 Ds3231SqwPinMode RTC_DS3231::readSqwPinMode()
 {
     int mode;
-    mode = read_register(DS3231_CONTROL) & 0x1C;
+    mode = shadowControl() & 0x1C;
     if (mode & 0x04)
         mode = DS3231_OFF;
     return static_cast<Ds3231SqwPinMode>(mode);
@@ -116,12 +348,12 @@ Ds3231SqwPinMode RTC_DS3231::readSqwPinMode()
 /**************************************************************************/
 void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode)
 {
-    uint8_t ctrl = read_register(DS3231_CONTROL);
+    uint8_t ctrl = shadowControl();
 
     ctrl &= ~0x04; // turn off INTCON
     ctrl &= ~0x18; // set freq bits to 0
 
-    write_register(DS3231_CONTROL, ctrl | mode);
+    writeControl(ctrl | mode);
 }
 
 /**************************************************************************/
@@ -132,13 +364,23 @@ void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode)
 /**************************************************************************/
 float RTC_DS3231::getTemperature()
 {
-    uint8_t buffer[2];
-    uint8_t reg = DS3231_TEMPERATUREREG;
+    uint8_t buffer[2] = {};
 
-    i2c_write_blocking(i2c, addr, &reg, 1, true);
-    i2c_read_blocking(i2c, addr, buffer, 2, false);
+    readRegisters(DS3231_TEMPERATUREREG, buffer, 2);
 
-    return (float)buffer[0] + (buffer[1] >> 6) * 0.25f;
+    return decodeTemperature(buffer);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decode the temperature registers
+    @param  buffer Registers 0x11-0x12
+    @return Temperature in degrees Celsius
+*/
+/**************************************************************************/
+float RTC_DS3231::decodeTemperature(const uint8_t *buffer)
+{
+    return (int8_t)buffer[0] + (buffer[1] >> 6) * 0.25f;
 }
 
 /**************************************************************************/
@@ -151,7 +393,7 @@ float RTC_DS3231::getTemperature()
 /**************************************************************************/
 bool RTC_DS3231::setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode)
 {
-    uint8_t ctrl = read_register(DS3231_CONTROL);
+    uint8_t ctrl = shadowControl();
     if (!(ctrl & 0x04))
     {
         return false;
@@ -169,9 +411,9 @@ bool RTC_DS3231::setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode)
                          uint8_t(bin2bcd(dt.minute()) | A1M2),
                          uint8_t(bin2bcd(dt.hour()) | A1M3),
                          uint8_t(bin2bcd(day) | A1M4 | DY_DT)};
-    i2c_write_blocking(i2c, addr, buffer, 5, false);
+    writeRegisters(buffer, 5);
 
-    write_register(DS3231_CONTROL, ctrl | 0x01); // AI1E
+    writeControl(ctrl | 0x01); // AI1E
 
     return true;
 }
@@ -186,7 +428,7 @@ bool RTC_DS3231::setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode)
 /**************************************************************************/
 bool RTC_DS3231::setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode)
 {
-    uint8_t ctrl = read_register(DS3231_CONTROL);
+    uint8_t ctrl = shadowControl();
     if (!(ctrl & 0x04))
     {
         return false;
@@ -202,9 +444,9 @@ bool RTC_DS3231::setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode)
     uint8_t buffer[4] = {DS3231_ALARM2, uint8_t(bin2bcd(dt.minute()) | A2M2),
                          uint8_t(bin2bcd(dt.hour()) | A2M3),
                          uint8_t(bin2bcd(day) | A2M4 | DY_DT)};
-    i2c_write_blocking(i2c, addr, buffer, 4, false);
+    writeRegisters(buffer, 4);
 
-    write_register(DS3231_CONTROL, ctrl | 0x02); // AI2E
+    writeControl(ctrl | 0x02); // AI2E
 
     return true;
 }
@@ -218,12 +460,23 @@ bool RTC_DS3231::setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode)
 /**************************************************************************/
 DateTime RTC_DS3231::getAlarm1()
 {
-    uint8_t buffer[5];
-    uint8_t reg = DS3231_ALARM1;
+    uint8_t buffer[5] = {};
 
-    i2c_write_blocking(i2c, addr, &reg, 1, true);
-    i2c_read_blocking(i2c, addr, buffer, 5, false);
+    readRegisters(DS3231_ALARM1, buffer, 5);
 
+    return decodeAlarm1(buffer);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decode the Alarm1 registers
+    @param  buffer Registers 0x07-0x0A
+    @return DateTime object with the Alarm1 data set in the
+            day, hour, minutes, and seconds fields
+*/
+/**************************************************************************/
+DateTime RTC_DS3231::decodeAlarm1(const uint8_t *buffer)
+{
     uint8_t seconds = bcd2bin(buffer[0] & 0x7F);
     uint8_t minutes = bcd2bin(buffer[1] & 0x7F);
     // Fetching the hour assumes 24 hour time (never 12)
@@ -262,12 +515,23 @@ DateTime RTC_DS3231::getAlarm1()
 /**************************************************************************/
 DateTime RTC_DS3231::getAlarm2()
 {
-    uint8_t buffer[4];
-    uint8_t reg = DS3231_ALARM2;
+    uint8_t buffer[4] = {};
+
+    readRegisters(DS3231_ALARM2, buffer, 4);
 
-    i2c_write_blocking(i2c, addr, &reg, 1, true);
-    i2c_read_blocking(i2c, addr, buffer, 4, false);
+    return decodeAlarm2(buffer);
+}
 
+/**************************************************************************/
+/*!
+    @brief  Decode the Alarm2 registers
+    @param  buffer Registers 0x0B-0x0D
+    @return DateTime object with the Alarm2 data set in the
+            day, hour, and minutes fields
+*/
+/**************************************************************************/
+DateTime RTC_DS3231::decodeAlarm2(const uint8_t *buffer)
+{
     uint8_t minutes = bcd2bin(buffer[0] & 0x7F);
     // Fetching the hour assumes 24 hour time (never 12)
     // because this library exclusively stores the time
@@ -304,12 +568,22 @@ DateTime RTC_DS3231::getAlarm2()
 /**************************************************************************/
 Ds3231Alarm1Mode RTC_DS3231::getAlarm1Mode()
 {
-    uint8_t buffer[5];
-    uint8_t reg = DS3231_ALARM1;
+    uint8_t buffer[5] = {};
 
-    i2c_write_blocking(i2c, addr, &reg, 1, true);
-    i2c_read_blocking(i2c, addr, buffer, 5, false);
+    readRegisters(DS3231_ALARM1, buffer, 5);
+
+    return decodeAlarm1Mode(buffer);
+}
 
+/**************************************************************************/
+/*!
+    @brief  Decode the mode of Alarm1
+    @param  buffer Registers 0x07-0x0A
+    @return Ds3231Alarm1Mode enum value
+*/
+/**************************************************************************/
+Ds3231Alarm1Mode RTC_DS3231::decodeAlarm1Mode(const uint8_t *buffer)
+{
     uint8_t alarm_mode = (buffer[0] & 0x80) >> 7    // A1M1 - Seconds bit
                          | (buffer[1] & 0x80) >> 6  // A1M2 - Minutes bit
                          | (buffer[2] & 0x80) >> 5  // A1M3 - Hour bit
@@ -340,12 +614,22 @@ Ds3231Alarm1Mode RTC_DS3231::getAlarm1Mode()
 /**************************************************************************/
 Ds3231Alarm2Mode RTC_DS3231::getAlarm2Mode()
 {
-    uint8_t buffer[4];
-    uint8_t reg = DS3231_ALARM2;
+    uint8_t buffer[4] = {};
+
+    readRegisters(DS3231_ALARM2, buffer, 4);
 
-    i2c_write_blocking(i2c, addr, &reg, 1, true);
-    i2c_read_blocking(i2c, addr, buffer, 4, false);
+    return decodeAlarm2Mode(buffer);
+}
 
+/**************************************************************************/
+/*!
+    @brief  Decode the mode of Alarm2
+    @param  buffer Registers 0x0B-0x0D
+    @return Ds3231Alarm2Mode enum value
+*/
+/**************************************************************************/
+Ds3231Alarm2Mode RTC_DS3231::decodeAlarm2Mode(const uint8_t *buffer)
+{
     uint8_t alarm_mode = (buffer[0] & 0x80) >> 7    // A2M2 - Minutes bit
                          | (buffer[1] & 0x80) >> 6  // A2M3 - Hour bit
                          | (buffer[2] & 0x80) >> 5  // A2M4 - Day/Date bit
@@ -375,7 +659,7 @@ Ds3231Alarm2Mode RTC_DS3231::getAlarm2Mode()
 /**************************************************************************/
 bool RTC_DS3231::getAlarmEnabled(uint8_t alarm_num)
 {
-    return (read_register(DS3231_CONTROL) >> (alarm_num - 1)) & 0x1;
+    return (shadowControl() >> (alarm_num - 1)) & 0x1;
 }
 
 /**************************************************************************/
@@ -386,9 +670,9 @@ bool RTC_DS3231::getAlarmEnabled(uint8_t alarm_num)
 /**************************************************************************/
 void RTC_DS3231::disableAlarm(uint8_t alarm_num)
 {
-    uint8_t ctrl = read_register(DS3231_CONTROL);
+    uint8_t ctrl = shadowControl();
     ctrl &= ~(1 << (alarm_num - 1));
-    write_register(DS3231_CONTROL, ctrl);
+    writeControl(ctrl);
 }
 
 /**************************************************************************/
@@ -399,21 +683,22 @@ void RTC_DS3231::disableAlarm(uint8_t alarm_num)
 /**************************************************************************/
 void RTC_DS3231::clearAlarm(uint8_t alarm_num)
 {
-    uint8_t status = read_register(DS3231_STATUSREG);
-    status &= ~(0x1 << (alarm_num - 1));
-    write_register(DS3231_STATUSREG, status);
+    writeStatus(isEnabled32K(), 0x1 << (alarm_num - 1));
 }
 
 /**************************************************************************/
 /*!
     @brief  Get status of alarm
         @param 	alarm_num Alarm number to check status of
-        @return True if alarm has been fired otherwise false
+        @return True if alarm has been fired, false if not or if the DS3231
+        did not respond
 */
 /**************************************************************************/
 bool RTC_DS3231::alarmFired(uint8_t alarm_num)
 {
-    return (read_register(DS3231_STATUSREG) >> (alarm_num - 1)) & 0x1;
+    if (!refreshShadow())
+        return false;
+    return (status >> (alarm_num - 1)) & 0x1;
 }
 
 /**************************************************************************/
@@ -425,9 +710,7 @@ bool RTC_DS3231::alarmFired(uint8_t alarm_num)
 /**************************************************************************/
 void RTC_DS3231::enable32K(void)
 {
-    uint8_t status = read_register(DS3231_STATUSREG);
-    status |= (0x1 << 0x03);
-    write_register(DS3231_STATUSREG, status);
+    writeStatus(1, 0);
 }
 
 /**************************************************************************/
@@ -437,9 +720,7 @@ void RTC_DS3231::enable32K(void)
 /**************************************************************************/
 void RTC_DS3231::disable32K(void)
 {
-    uint8_t status = read_register(DS3231_STATUSREG);
-    status &= ~(0x1 << 0x03);
-    write_register(DS3231_STATUSREG, status);
+    writeStatus(0, 0);
 }
 
 /**************************************************************************/
@@ -450,5 +731,35 @@ void RTC_DS3231::disable32K(void)
 /**************************************************************************/
 bool RTC_DS3231::isEnabled32K(void)
 {
-    return (read_register(DS3231_STATUSREG) >> 0x03) & 0x01;
-}
\ No newline at end of file
+    return (shadowStatus() >> 0x03) & 0x01;
+}
+/**************************************************************************/
+/*!
+    @brief  Read every register in one burst and decode it
+    @details Gives a consistent view of time and alarm state for the cost of
+    a single transaction, and refreshes the CONTROL/STATUS shadow.
+    @param  snap Snapshot to fill in
+    @return True if the DS3231 responded
+*/
+/**************************************************************************/
+bool RTC_DS3231::snapshot(DS3231Snapshot &snap)
+{
+    if (!readRegisters(DS3231_TIME, snap.registers, DS3231_REGISTER_COUNT))
+        return false;
+
+    const uint8_t *r = snap.registers;
+    snap.time = decodeTime(r + DS3231_TIME);
+    snap.alarm1 = decodeAlarm1(r + DS3231_ALARM1);
+    snap.alarm1_mode = decodeAlarm1Mode(r + DS3231_ALARM1);
+    snap.alarm2 = decodeAlarm2(r + DS3231_ALARM2);
+    snap.alarm2_mode = decodeAlarm2Mode(r + DS3231_ALARM2);
+    snap.control = r[DS3231_CONTROL];
+    snap.status = r[DS3231_STATUSREG];
+    snap.aging = (int8_t)r[DS3231_AGINGREG];
+    snap.temperature = decodeTemperature(r + DS3231_TEMPERATUREREG);
+
+    control = snap.control;
+    status = snap.status;
+    shadow_valid = true;
+    return true;
+}
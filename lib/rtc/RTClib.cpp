@@ -61,6 +61,59 @@
 */
 const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
 
+/**************************************************************************/
+/*!
+    @brief  Given a civil date, return the number of days since 1970/01/01
+    @details Closed form after Howard Hinnant's days_from_civil. Years are
+    counted from March so the leap day ends the year, which turns the days
+    before a month into a linear formula. Valid from 1970 on.
+    @param y Full year
+    @param m Month (1--12)
+    @param d Day (1--31)
+    @return Number of days
+*/
+/**************************************************************************/
+static constexpr uint32_t daysFromCivil(uint32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;                                  // [0, 399]
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1; // [0, 365]
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;          // [0, 146096]
+    return era * 146097 + doe - 719468;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Given a number of days since 1970/01/01, return the civil date
+    @details Closed form after Howard Hinnant's civil_from_days, the
+    converse of daysFromCivil().
+    @param z Number of days
+    @param y Full year
+    @param m Month (1--12)
+    @param d Day (1--31)
+*/
+/**************************************************************************/
+static constexpr void civilFromDays(uint32_t z, uint16_t &y, uint8_t &m, uint8_t &d)
+{
+    z += 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;                                     // [0, 146096]
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);              // [0, 365]
+    uint32_t mp = (5 * doy + 2) / 153;                                   // [0, 11], from March
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+/** Days from 1970/01/01 to 2000/01/01 */
+#define DAYS_FROM_1970_TO_2000 10957
+
+static_assert(daysFromCivil(2000, 1, 1) == DAYS_FROM_1970_TO_2000, "epoch offset");
+static_assert(daysFromCivil(2000, 3, 1) - daysFromCivil(2000, 2, 28) == 2, "2000 is a leap year");
+static_assert(daysFromCivil(2100, 1, 1) - DAYS_FROM_1970_TO_2000 == 36525, "25 leap years in 2000--2099");
+
 /**************************************************************************/
 /*!
     @brief  Given a date, return number of days since 2000/01/01,
@@ -73,14 +126,9 @@ const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
 /**************************************************************************/
 static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d)
 {
-    if (y >= 2000U)
-        y -= 2000U;
-    uint16_t days = d;
-    for (uint8_t i = 1; i < m; ++i)
-        days += daysInMonth[i - 1];
-    if (m > 2 && y % 4 == 0)
-        ++days;
-    return days + 365 * y + (y + 3) / 4 - 1;
+    if (y < 2000U)
+        y += 2000U;
+    return daysFromCivil(y, m, d) - DAYS_FROM_1970_TO_2000;
 }
 
 /**************************************************************************/
@@ -136,25 +184,10 @@ DateTime::DateTime(uint32_t t)
     mm = t % 60;
     t /= 60;
     hh = t % 24;
-    uint16_t days = t / 24;
-    uint8_t leap;
-    for (yOff = 0;; ++yOff)
-    {
-        leap = yOff % 4 == 0;
-        if (days < 365U + leap)
-            break;
-        days -= 365 + leap;
-    }
-    for (m = 1; m < 12; ++m)
-    {
-        uint8_t daysPerMonth = daysInMonth[m - 1];
-        if (leap && m == 2)
-            ++daysPerMonth;
-        if (days < daysPerMonth)
-            break;
-        days -= daysPerMonth;
-    }
-    d = days + 1;
+
+    uint16_t year;
+    civilFromDays(t / 24 + DAYS_FROM_1970_TO_2000, year, m, d);
+    yOff = year - 2000;
 }
 
 /**************************************************************************/
@@ -25,6 +25,7 @@
 #define _RTCLIB_H_
 
 #include "hardware/i2c.h"
+#include "I2CEngine.h"
 #include <stdint.h>
 
 class TimeSpan;
@@ -266,6 +267,38 @@ protected:
     int32_t _seconds; ///< Actual TimeSpan value is stored as seconds
 };
 
+#define DS3231_REGISTER_COUNT 19 ///< Registers 0x00 (seconds) to 0x12 (temperature LSB)
+#define DS3231_STANDARD_BAUDRATE 100000 ///< Standard mode, always tried as the fallback
+#define DS3231_FAST_BAUDRATE 400000     ///< Fast mode, the fastest the DS3231 supports
+#define DS3231_RETRIES 2                ///< Repeats of a failed register access
+
+/**************************************************************************/
+/*!
+    @brief  Contents of all DS3231 registers, read in a single burst by
+            RTC_DS3231::snapshot()
+*/
+/**************************************************************************/
+struct DS3231Snapshot
+{
+    uint8_t registers[DS3231_REGISTER_COUNT]; ///< Raw register file
+    DateTime time;                            ///< Current date/time
+    DateTime alarm1;                          ///< Alarm 1 day, hour, minute, second
+    Ds3231Alarm1Mode alarm1_mode;             ///< Alarm 1 match mode
+    DateTime alarm2;                          ///< Alarm 2 day, hour, minute
+    Ds3231Alarm2Mode alarm2_mode;             ///< Alarm 2 match mode
+    uint8_t control;                          ///< CONTROL register
+    uint8_t status;                           ///< STATUS register
+    int8_t aging;                             ///< Aging offset
+    float temperature;                        ///< Degrees Celsius
+
+    /*! @brief True if the oscillator stopped since the time was last set */
+    bool lostPower() const { return status >> 7; }
+    /*! @brief True if the given alarm (1 or 2) is enabled */
+    bool alarmEnabled(uint8_t alarm_num) const { return (control >> (alarm_num - 1)) & 0x1; }
+    /*! @brief True if the given alarm (1 or 2) has fired */
+    bool alarmFired(uint8_t alarm_num) const { return (status >> (alarm_num - 1)) & 0x1; }
+};
+
 /**************************************************************************/
 /*!
     @brief  RTC based on the DS3231 chip connected via I2C and the Wire library
@@ -276,6 +309,8 @@ class RTC_DS3231
 protected:
     i2c_inst_t *i2c;
     uint8_t addr;
+    I2CEngine bus; ///< Every transaction has a timeout, so a stuck bus cannot hang the caller
+    uint32_t baud = DS3231_STANDARD_BAUDRATE; ///< Bus rate chosen by begin()
 
     static uint8_t bcd2bin(uint8_t val) { return val - 6 * (val >> 4); }
     static uint8_t bin2bcd(uint8_t val) { return val + 6 * (val / 10); }
@@ -290,27 +325,62 @@ protected:
 
     uint8_t read_register(uint8_t reg)
     {
-        uint8_t data;
-        i2c_write_blocking(i2c, addr, &reg, 1, true);
-        i2c_read_blocking(i2c, addr, &data, 1, false);
+        uint8_t data = 0;
+        readRegisters(reg, &data, 1);
         return data;
     }
 
-    void write_register(uint8_t reg, uint8_t val)
+    bool write_register(uint8_t reg, uint8_t val)
     {
         uint8_t buffer[2] = {reg, val};
-        i2c_write_blocking(i2c, addr, buffer, 2, false);
+        return writeRegisters(buffer, 2);
     }
 
+    // Shadow copies of CONTROL and STATUS, so updates need no read first.
+    // The oscillator and alarm flags in STATUS are set by the chip, so they
+    // are always read fresh; only EN32kHz is taken from the shadow. A write
+    // the chip did not acknowledge invalidates the shadow, so the next use
+    // reads back what the chip actually holds.
+    uint8_t control = 0;
+    uint8_t status = 0;
+    bool shadow_valid = false;
+
+    static DateTime decodeTime(const uint8_t *buffer);
+    static DateTime decodeAlarm1(const uint8_t *buffer);
+    static DateTime decodeAlarm2(const uint8_t *buffer);
+    static Ds3231Alarm1Mode decodeAlarm1Mode(const uint8_t *buffer);
+    static Ds3231Alarm2Mode decodeAlarm2Mode(const uint8_t *buffer);
+    static float decodeTemperature(const uint8_t *buffer);
+
+    bool readRegisters(uint8_t reg, uint8_t *buffer, uint8_t len);
+    bool writeRegisters(const uint8_t *buffer, uint8_t len);
+    bool verifyBus(const uint8_t *reference);
+    bool refreshShadow();
+    uint8_t shadowControl();
+    uint8_t shadowStatus();
+    bool writeControl(uint8_t val);
+    bool writeStatus(uint8_t en32k, uint8_t clear_flags);
+
 public:
-    bool begin(i2c_inst_t *i2c_instance, uint8_t address = 0x68);
-    void adjust(const DateTime &dt);
+    // read() and adjust() are virtual so time keeping can be tested against a fake RTC
+    virtual ~RTC_DS3231() = default;
+    bool begin(i2c_inst_t *i2c_instance, uint8_t address = 0x68, int sda_pin = -1,
+               int scl_pin = -1, uint32_t max_baudrate = DS3231_FAST_BAUDRATE);
+    uint32_t baudrate() const { return baud; }           ///< Bus rate in Hz chosen by begin()
+    I2CStats busStats() const { return bus.stats(); }   ///< NAK, timeout and retry counters
+    void resetBusStats() { bus.resetStats(); }          ///< Zero the bus counters
+    virtual void adjust(const DateTime &dt);
     bool lostPower(void);
+    virtual bool read(DateTime &dt);
     DateTime now();
+    bool snapshot(DS3231Snapshot &snap);
+    bool readAsync(I2CRequest &req, uint8_t reg, uint8_t *buffer, uint8_t len,
+                   I2CCallback callback, void *user_data = nullptr);
     Ds3231SqwPinMode readSqwPinMode();
     void writeSqwPinMode(Ds3231SqwPinMode mode);
     bool setAlarm1(const DateTime &dt, Ds3231Alarm1Mode alarm_mode);
     bool setAlarm2(const DateTime &dt, Ds3231Alarm2Mode alarm_mode);
+    void invalidateShadow() { shadow_valid = false; } ///< Re-read CONTROL/STATUS before the next use
     DateTime getAlarm1();
     DateTime getAlarm2();
     Ds3231Alarm1Mode getAlarm1Mode();
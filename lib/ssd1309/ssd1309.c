@@ -29,48 +29,98 @@ Modified 2026:
 
 #include <pico/stdlib.h>
 #include <hardware/spi.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
 #include <pico/binary_info.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "ssd1309.h"
-#include "font.h"
+#include "ssd1309_fonts.h"
+
+#ifndef SSD1309_GLYPH_CACHE_SLOTS
+#define SSD1309_GLYPH_CACHE_SLOTS 16 ///< number of scaled glyphs kept in RAM
+#endif
+#ifndef SSD1309_GLYPH_CACHE_BYTES
+#define SSD1309_GLYPH_CACHE_BYTES 96 ///< largest scaled glyph (width * pages) that is cached
+#endif
+
+/**
+ * @brief Scaled glyph, stored column-major with `pages` bytes per column
+ */
+typedef struct
+{
+    const void *font; /**< raw or compiled font the glyph belongs to, NULL if slot unused */
+    uint8_t scale;
+    char c;
+    uint8_t width;    /**< scaled width in columns */
+    uint8_t pages;    /**< scaled height in pages */
+    uint32_t last_used; /**< LRU stamp */
+    uint8_t bits[SSD1309_GLYPH_CACHE_BYTES];
+} ssd1309_glyph_t;
+
+static ssd1309_glyph_t ssd1309_glyph_cache[SSD1309_GLYPH_CACHE_SLOTS];
+static uint32_t ssd1309_glyph_clock;
+
+/** displays owning a DMA channel, indexed by channel */
+static ssd1309_t *ssd1309_dma_owner[NUM_DMA_CHANNELS];
 
 inline static void swap(int32_t *a, int32_t *b)
 {
-    int32_t *t = a;
+    int32_t t = *a;
     *a = *b;
-    *b = *t;
+    *b = t;
 }
 
 /**
- * @brief Write a command byte to the SSD1309 display
+ * @brief Assert CS, starting a bus transaction
  *
  * @param p Pointer to display instance
- * @param cmd Command byte to write
  */
-inline static void ssd1309_write_cmd(ssd1309_t *p, uint8_t cmd)
+inline static void ssd1309_select(ssd1309_t *p)
 {
-    gpio_put(p->dc_pin, 0); // DC low = command mode
+    ssd1309_wait(p);
     gpio_put(p->cs_pin, 0); // CS low = select device
-    spi_write_blocking(p->spi_i, &cmd, 1);
+    p->stats.cs_toggles++;
+}
+
+inline static void ssd1309_deselect(ssd1309_t *p)
+{
     gpio_put(p->cs_pin, 1); // CS high = deselect device
 }
 
 /**
- * @brief Write data bytes to the SSD1309 display
+ * @brief Send bytes within the current transaction
+ *
+ * spi_write_blocking() returns once the last bit has been shifted out, so
+ * DC can be switched between calls while CS stays asserted.
  *
  * @param p Pointer to display instance
- * @param data Pointer to data buffer
+ * @param data_mode true to send display data, false to send commands
+ * @param bytes Pointer to bytes to write
  * @param len Number of bytes to write
  */
-inline static void ssd1309_write_data(ssd1309_t *p, uint8_t *data, size_t len)
+inline static void ssd1309_spi_write(ssd1309_t *p, bool data_mode, const uint8_t *bytes, size_t len)
 {
-    gpio_put(p->dc_pin, 1); // DC high = data mode
-    gpio_put(p->cs_pin, 0); // CS low = select device
-    spi_write_blocking(p->spi_i, data, len);
-    gpio_put(p->cs_pin, 1); // CS high = deselect device
+    gpio_put(p->dc_pin, data_mode); // DC high = data mode, low = command mode
+    spi_write_blocking(p->spi_i, bytes, len);
+    p->stats.transactions++;
+    p->stats.bytes += len;
+}
+
+/**
+ * @brief Write a sequence of command bytes under a single CS assertion
+ *
+ * @param p Pointer to display instance
+ * @param cmds Command bytes (including their arguments)
+ * @param len Number of bytes to write
+ */
+inline static void ssd1309_write_cmds(ssd1309_t *p, const uint8_t *cmds, size_t len)
+{
+    ssd1309_select(p);
+    ssd1309_spi_write(p, false, cmds, len);
+    ssd1309_deselect(p);
 }
 
 /**
@@ -90,7 +140,216 @@ inline static void ssd1309_reset(ssd1309_t *p)
 
 inline static void ssd1309_write(ssd1309_t *p, uint8_t val)
 {
-    ssd1309_write_cmd(p, val);
+    ssd1309_write_cmds(p, &val, 1);
+}
+
+/**
+ * @brief Extend the dirty region of pages page0..page1 to cover columns x0..x1
+ *
+ * Coordinates must already be clipped to the display.
+ */
+inline static void ssd1309_mark_dirty(ssd1309_t *p, uint32_t x0, uint32_t x1, uint32_t page0, uint32_t page1)
+{
+    for (uint32_t page = page0; page <= page1; ++page)
+    {
+        if (x0 < p->dirty_x0[page])
+            p->dirty_x0[page] = x0;
+        if (x1 > p->dirty_x1[page])
+            p->dirty_x1[page] = x1;
+    }
+}
+
+inline static void ssd1309_mark_clean(ssd1309_t *p)
+{
+    memset(p->dirty_x0, 0xff, sizeof(p->dirty_x0));
+    memset(p->dirty_x1, 0x00, sizeof(p->dirty_x1));
+}
+
+/**
+ * @brief Make the next flush send the whole frame, for when the panel RAM
+ *        no longer matches what was last sent
+ */
+static void ssd1309_invalidate(ssd1309_t *p)
+{
+    ssd1309_mark_dirty(p, 0, p->width - 1, 0, p->pages - 1);
+
+    // Nothing can be skipped by diffing against a front buffer that no
+    // longer matches the panel
+    p->front_valid = false;
+}
+
+/**
+ * @brief Narrow the dirty ranges to the bytes that differ from the front
+ *        buffer and copy them over
+ *
+ * @param p Pointer to display instance
+ * @return Buffer to send from: the front buffer when double buffering,
+ *         otherwise the draw buffer
+ */
+static uint8_t *ssd1309_sync_front(ssd1309_t *p)
+{
+    if (!p->front)
+        return p->buffer;
+
+    if (!p->front_valid)
+    {
+        // Every dirty byte goes out as drawn
+        memcpy(p->front, p->buffer, p->bufsize);
+        p->front_valid = true;
+        return p->front;
+    }
+
+    for (uint8_t page = 0; page < p->pages; ++page)
+    {
+        int32_t x0 = p->dirty_x0[page];
+        int32_t x1 = p->dirty_x1[page];
+        if (x0 > x1)
+            continue;
+
+        const uint8_t *back = p->buffer + page * p->width;
+        uint8_t *front = p->front + page * p->width;
+
+        while (x0 <= x1 && back[x0] == front[x0])
+            ++x0;
+        while (x1 >= x0 && back[x1] == front[x1])
+            --x1;
+
+        if (x0 > x1)
+        {
+            p->dirty_x0[page] = 0xff;
+            p->dirty_x1[page] = 0x00;
+            continue;
+        }
+
+        memcpy(front + x0, back + x0, x1 - x0 + 1);
+        p->dirty_x0[page] = x0;
+        p->dirty_x1[page] = x1;
+    }
+
+    return p->front;
+}
+
+/**
+ * @brief Send the column/page window that following data bytes are written to
+ *
+ * Must be called inside a transaction (after ssd1309_select()).
+ */
+inline static void ssd1309_send_window(ssd1309_t *p, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    // 64 pixel wide panels are centered on the 128 column controller
+    uint8_t col_offset = p->width == 64 ? 32 : 0;
+    uint8_t payload[] = {SET_COL_ADDR, x0 + col_offset, x1 + col_offset, SET_PAGE_ADDR, page0, page1};
+
+    ssd1309_spi_write(p, false, payload, sizeof(payload));
+}
+
+/**
+ * @brief Finish an async flush: release the bus and notify the caller
+ *
+ * Runs in interrupt context once the DMA channel has pushed the last byte
+ * into the TX FIFO.
+ */
+static void ssd1309_async_complete(ssd1309_t *p)
+{
+    // DMA is done when the FIFO has accepted the last byte, not when it has
+    // been shifted out
+    while (spi_is_busy(p->spi_i))
+        tight_loop_contents();
+
+    ssd1309_deselect(p);
+    p->busy = false;
+
+    if (p->flush_cb)
+        p->flush_cb(p->flush_cb_data);
+}
+
+/**
+ * @brief Start the DMA transfer of the next dirty row or band of an async flush
+ *
+ * Sends the address window first when the row starts a new one, once the
+ * data before it has left the FIFO, as DC applies to the bytes on the wire.
+ *
+ * @param p Pointer to display instance
+ * @return false if everything has been sent
+ */
+static bool ssd1309_async_next(ssd1309_t *p)
+{
+    uint8_t page = p->async_page;
+    while (page < p->pages && p->async_x0[page] > p->async_x1[page])
+        ++page;
+    if (page >= p->pages)
+        return false;
+
+    uint8_t x0 = p->async_x0[page];
+    uint8_t x1 = p->async_x1[page];
+    if (page >= p->async_window_end)
+    {
+        // Pages with the same column range share one address window
+        uint8_t last = page;
+        while (last + 1 < p->pages && p->async_x0[last + 1] == x0 && p->async_x1[last + 1] == x1)
+            ++last;
+
+        while (spi_is_busy(p->spi_i))
+            tight_loop_contents();
+        ssd1309_send_window(p, x0, x1, page, last);
+        p->async_window_end = last + 1;
+    }
+
+    // Full width pages are contiguous in the buffer, narrower rows are not
+    uint8_t next = x0 == 0 && x1 == p->width - 1 ? p->async_window_end : page + 1;
+    size_t len = (size_t)(next - page - 1) * p->width + x1 - x0 + 1;
+    p->async_page = next;
+    p->stats.transactions++;
+    p->stats.bytes += len;
+
+    gpio_put(p->dc_pin, 1); // DC high = data mode
+    dma_channel_transfer_from_buffer_now(p->dma_chan, p->async_src + page * p->width + x0, len);
+    return true;
+}
+
+static void ssd1309_dma_irq_handler(void)
+{
+    for (uint i = 0; i < NUM_DMA_CHANNELS; ++i)
+    {
+        ssd1309_t *p = ssd1309_dma_owner[i];
+        if (p && dma_channel_get_irq0_status(i))
+        {
+            dma_channel_acknowledge_irq0(i);
+            if (!ssd1309_async_next(p))
+                ssd1309_async_complete(p);
+        }
+    }
+}
+
+/**
+ * @brief Claim and configure a DMA channel feeding the SPI TX FIFO
+ *
+ * @param p Pointer to display instance
+ */
+static void ssd1309_dma_init(ssd1309_t *p)
+{
+    static bool irq_installed = false;
+
+    p->busy = false;
+    p->dma_chan = dma_claim_unused_channel(false);
+    if (p->dma_chan < 0)
+        return;
+
+    dma_channel_config cfg = dma_channel_get_default_config(p->dma_chan);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, spi_get_dreq(p->spi_i, true));
+    dma_channel_configure(p->dma_chan, &cfg, &spi_get_hw(p->spi_i)->dr, NULL, 0, false);
+
+    ssd1309_dma_owner[p->dma_chan] = p;
+    if (!irq_installed)
+    {
+        irq_add_shared_handler(DMA_IRQ_0, ssd1309_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        irq_installed = true;
+    }
+    dma_channel_set_irq0_enabled(p->dma_chan, true);
 }
 
 bool ssd1309_init(ssd1309_t *p, uint16_t width, uint16_t height,
@@ -100,6 +359,12 @@ bool ssd1309_init(ssd1309_t *p, uint16_t width, uint16_t height,
     p->height = height;
     p->pages = height / 8;
 
+    if (p->pages > SSD1309_MAX_PAGES)
+        return false;
+
+    p->front = NULL;
+    p->front_valid = false;
+
     p->spi_i = spi_instance;
     p->cs_pin = cs_pin;
     p->dc_pin = dc_pin;
@@ -127,6 +392,10 @@ bool ssd1309_init(ssd1309_t *p, uint16_t width, uint16_t height,
 
     // Clear buffer
     memset(p->buffer, 0, p->bufsize);
+    ssd1309_mark_clean(p);
+    ssd1309_mark_dirty(p, 0, p->width - 1, 0, p->pages - 1);
+
+    ssd1309_dma_init(p);
 
     // Perform hardware reset
     ssd1309_reset(p);
@@ -162,15 +431,46 @@ bool ssd1309_init(ssd1309_t *p, uint16_t width, uint16_t height,
         0x00, // horizontal
     };
 
-    for (size_t i = 0; i < sizeof(cmds); ++i)
-        ssd1309_write(p, cmds[i]);
+    ssd1309_write_cmds(p, cmds, sizeof(cmds));
 
     return true;
 }
 
 inline void ssd1309_deinit(ssd1309_t *p)
 {
+    ssd1309_wait(p);
+    if (p->dma_chan >= 0)
+    {
+        dma_channel_set_irq0_enabled(p->dma_chan, false);
+        ssd1309_dma_owner[p->dma_chan] = NULL;
+        dma_channel_unclaim(p->dma_chan);
+        p->dma_chan = -1;
+    }
     free(p->buffer);
+    free(p->front);
+}
+
+bool ssd1309_set_double_buffer(ssd1309_t *p, bool enable)
+{
+    ssd1309_wait(p);
+
+    if (!enable)
+    {
+        free(p->front);
+        p->front = NULL;
+        return true;
+    }
+
+    if (p->front)
+        return true;
+
+    if ((p->front = malloc(p->bufsize)) == NULL)
+        return false;
+
+    // The panel contents are unknown
+    ssd1309_invalidate(p);
+
+    return true;
 }
 
 inline void ssd1309_poweroff(ssd1309_t *p)
@@ -185,8 +485,8 @@ inline void ssd1309_poweron(ssd1309_t *p)
 
 inline void ssd1309_contrast(ssd1309_t *p, uint8_t val)
 {
-    ssd1309_write(p, SET_CONTRAST);
-    ssd1309_write(p, val);
+    uint8_t cmds[] = {SET_CONTRAST, val};
+    ssd1309_write_cmds(p, cmds, sizeof(cmds));
 }
 
 inline void ssd1309_invert(ssd1309_t *p, uint8_t inv)
@@ -194,9 +494,73 @@ inline void ssd1309_invert(ssd1309_t *p, uint8_t inv)
     ssd1309_write(p, SET_NORM_INV | (inv & 1));
 }
 
+void ssd1309_set_start_line(ssd1309_t *p, uint8_t line)
+{
+    ssd1309_write(p, SET_DISP_START_LINE | (line % p->height));
+}
+
+void ssd1309_set_display_offset(ssd1309_t *p, uint8_t rows)
+{
+    uint8_t cmds[] = {SET_DISP_OFFSET, rows % p->height};
+    ssd1309_write_cmds(p, cmds, sizeof(cmds));
+}
+
+void ssd1309_set_active_rows(ssd1309_t *p, uint8_t row0, uint8_t rows)
+{
+    if (rows < 16 || rows > p->height)
+        rows = p->height;
+
+    uint8_t cmds[] = {
+        SET_MUX_RATIO,
+        rows - 1,
+        SET_DISP_START_LINE | (row0 % p->height),
+    };
+
+    ssd1309_write_cmds(p, cmds, sizeof(cmds));
+}
+
+void ssd1309_scroll_horizontal(ssd1309_t *p, bool left, uint8_t page0, uint8_t page1, uint8_t interval)
+{
+    uint8_t col_offset = p->width == 64 ? 32 : 0;
+    uint8_t cmds[] = {
+        SET_SCROLL_OFF,
+        SET_HSCROLL | (left ? 0x01 : 0x00),
+        0x00, // dummy
+        page0 & 0x07,
+        interval & 0x07,
+        page1 & 0x07,
+        0x00, // dummy
+        col_offset,
+        col_offset + p->width - 1,
+        SET_SCROLL_ON,
+    };
+
+    ssd1309_write_cmds(p, cmds, sizeof(cmds));
+}
+
+void ssd1309_scroll_stop(ssd1309_t *p)
+{
+    ssd1309_write(p, SET_SCROLL_OFF);
+    ssd1309_invalidate(p);
+}
+
 inline void ssd1309_clear(ssd1309_t *p)
 {
     memset(p->buffer, 0, p->bufsize);
+    ssd1309_mark_dirty(p, 0, p->width - 1, 0, p->pages - 1);
+}
+
+void ssd1309_write_pbm(ssd1309_t *p, FILE *f)
+{
+    fprintf(f, "P1\n%u %u\n", (unsigned)p->width, (unsigned)p->height);
+    for (uint32_t y = 0; y < p->height; ++y)
+    {
+        const uint8_t *row = p->buffer + (y >> 3) * p->width;
+        uint8_t mask = 1 << (y & 7);
+        for (uint32_t x = 0; x < p->width; ++x)
+            fputc(row[x] & mask ? '1' : '0', f);
+        fputc('\n', f);
+    }
 }
 
 void ssd1309_clear_pixel(ssd1309_t *p, uint32_t x, uint32_t y)
@@ -205,6 +569,7 @@ void ssd1309_clear_pixel(ssd1309_t *p, uint32_t x, uint32_t y)
         return;
 
     p->buffer[x + p->width * (y >> 3)] &= ~(0x1 << (y & 0x07));
+    ssd1309_mark_dirty(p, x, x, y >> 3, y >> 3);
 }
 
 void ssd1309_draw_pixel(ssd1309_t *p, uint32_t x, uint32_t y)
@@ -213,54 +578,342 @@ void ssd1309_draw_pixel(ssd1309_t *p, uint32_t x, uint32_t y)
         return;
 
     p->buffer[x + p->width * (y >> 3)] |= 0x1 << (y & 0x07); // y>>3==y/8 && y&0x7==y%8
+    ssd1309_mark_dirty(p, x, x, y >> 3, y >> 3);
 }
 
-void ssd1309_draw_line(ssd1309_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+/**
+ * @brief Set or clear a rectangle using whole-byte operations per page
+ *
+ * Only the top and bottom pages need masking; full pages are memset.
+ *
+ * @param p Pointer to display instance
+ * @param set true to set the pixels, false to clear them
+ */
+static void ssd1309_fill_rect(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool set)
 {
-    if (x1 > x2)
+    if (x >= p->width || y >= p->height || width == 0 || height == 0)
+        return;
+
+    if (width > p->width - x)
+        width = p->width - x;
+    if (height > p->height - y)
+        height = p->height - y;
+
+    uint32_t y1 = y + height - 1;
+    uint32_t page0 = y >> 3;
+    uint32_t page1 = y1 >> 3;
+
+    for (uint32_t page = page0; page <= page1; ++page)
     {
+        uint8_t mask = 0xff;
+        if (page == page0)
+            mask &= 0xff << (y & 7);
+        if (page == page1)
+            mask &= 0xff >> (7 - (y1 & 7));
+
+        uint8_t *row = p->buffer + page * p->width + x;
+        if (mask == 0xff)
+        {
+            memset(row, set ? 0xff : 0x00, width);
+        }
+        else if (set)
+        {
+            for (uint32_t i = 0; i < width; ++i)
+                row[i] |= mask;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < width; ++i)
+                row[i] &= ~mask;
+        }
+    }
+
+    ssd1309_mark_dirty(p, x, x + width - 1, page0, page1);
+}
+
+/**
+ * @brief Draw a horizontal span from x1 to x2 (inclusive) as a byte-wise fill
+ */
+static void ssd1309_draw_hline(ssd1309_t *p, int32_t x1, int32_t x2, int32_t y)
+{
+    if (x1 > x2)
         swap(&x1, &x2);
+    if (x2 < 0 || y < 0)
+        return;
+    if (x1 < 0)
+        x1 = 0;
+
+    ssd1309_fill_rect(p, x1, y, x2 - x1 + 1, 1, true);
+}
+
+/**
+ * @brief Draw a vertical span from y1 to y2 (inclusive) as a byte-wise fill
+ */
+static void ssd1309_draw_vline(ssd1309_t *p, int32_t x, int32_t y1, int32_t y2)
+{
+    if (y1 > y2)
         swap(&y1, &y2);
-    }
+    if (y2 < 0 || x < 0)
+        return;
+    if (y1 < 0)
+        y1 = 0;
 
+    ssd1309_fill_rect(p, x, y1, 1, y2 - y1 + 1, true);
+}
+
+void ssd1309_draw_line(ssd1309_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    if (y1 == y2)
+    {
+        ssd1309_draw_hline(p, x1, x2, y1);
+        return;
+    }
     if (x1 == x2)
     {
-        if (y1 > y2)
-            swap(&y1, &y2);
-        for (int32_t i = y1; i <= y2; ++i)
-            ssd1309_draw_pixel(p, x1, i);
+        ssd1309_draw_vline(p, x1, y1, y2);
         return;
     }
 
-    float m = (float)(y2 - y1) / (float)(x2 - x1);
+    // Bresenham, stepping in both axes so steep lines stay connected
+    int32_t dx = x2 > x1 ? x2 - x1 : x1 - x2;
+    int32_t dy = y2 > y1 ? y1 - y2 : y2 - y1;
+    int32_t sx = x1 < x2 ? 1 : -1;
+    int32_t sy = y1 < y2 ? 1 : -1;
+    int32_t err = dx + dy;
 
-    for (int32_t i = x1; i <= x2; ++i)
+    for (;;)
     {
-        float y = m * (float)(i - x1) + (float)y1;
-        ssd1309_draw_pixel(p, i, (uint32_t)y);
+        // negative coordinates wrap to large values and are rejected
+        ssd1309_draw_pixel(p, x1, y1);
+        if (x1 == x2 && y1 == y2)
+            break;
+
+        int32_t e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y1 += sy;
+        }
     }
 }
 
 void ssd1309_clear_square(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
 {
-    for (uint32_t i = 0; i < width; ++i)
-        for (uint32_t j = 0; j < height; ++j)
-            ssd1309_clear_pixel(p, x + i, y + j);
+    ssd1309_fill_rect(p, x, y, width, height, false);
 }
 
 void ssd1309_draw_square(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
 {
-    for (uint32_t i = 0; i < width; ++i)
-        for (uint32_t j = 0; j < height; ++j)
-            ssd1309_draw_pixel(p, x + i, y + j);
+    ssd1309_fill_rect(p, x, y, width, height, true);
 }
 
 void ssd1309_draw_empty_square(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
 {
-    ssd1309_draw_line(p, x, y, x + width, y);
-    ssd1309_draw_line(p, x, y + height, x + width, y + height);
-    ssd1309_draw_line(p, x, y, x, y + height);
-    ssd1309_draw_line(p, x + width, y, x + width, y + height);
+    ssd1309_draw_hline(p, x, x + width, y);
+    ssd1309_draw_hline(p, x, x + width, y + height);
+    ssd1309_draw_vline(p, x, y, y + height);
+    ssd1309_draw_vline(p, x + width, y, y + height);
+}
+
+/**
+ * @brief OR a page-packed bitmap into the buffer at any pixel position
+ *
+ * @param p Pointer to display instance
+ * @param x Left column
+ * @param y Top row, need not be page aligned
+ * @param bits Bitmap of vertical 8 pixel bytes, LSB on top
+ * @param width Width in columns
+ * @param pages Height in pages
+ * @param col_stride Distance in bytes between neighbouring columns
+ * @param page_stride Distance in bytes between neighbouring pages
+ */
+static void ssd1309_blit_strided(ssd1309_t *p, uint32_t x, uint32_t y, const uint8_t *bits, uint32_t width, uint32_t pages,
+                                 uint32_t col_stride, uint32_t page_stride)
+{
+    if (x >= p->width || y >= p->height)
+        return;
+
+    uint32_t visible = width;
+    if (visible > p->width - x)
+        visible = p->width - x;
+
+    uint32_t page0 = y >> 3;
+    uint32_t shift = y & 7;
+    uint32_t page1 = page0 + pages - (shift ? 0 : 1);
+    if (page1 >= p->pages)
+        page1 = p->pages - 1;
+
+    for (uint32_t pg = 0; pg < pages; ++pg)
+    {
+        uint32_t dst_page = page0 + pg;
+        if (dst_page >= p->pages)
+            break;
+
+        const uint8_t *src = bits + pg * page_stride;
+        uint8_t *dst = p->buffer + dst_page * p->width + x;
+
+        if (shift == 0)
+        {
+            for (uint32_t i = 0; i < visible; ++i, src += col_stride)
+                dst[i] |= *src;
+        }
+        else if (dst_page + 1 < p->pages)
+        {
+            uint8_t *next = dst + p->width;
+            for (uint32_t i = 0; i < visible; ++i, src += col_stride)
+            {
+                dst[i] |= *src << shift;
+                next[i] |= *src >> (8 - shift);
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < visible; ++i, src += col_stride)
+                dst[i] |= *src << shift;
+        }
+    }
+
+    ssd1309_mark_dirty(p, x, x + visible - 1, page0, page1);
+}
+
+/**
+ * @brief Blit a column-major bitmap with `pages` bytes per column
+ */
+inline static void ssd1309_blit(ssd1309_t *p, uint32_t x, uint32_t y, const uint8_t *bits, uint32_t width, uint32_t pages)
+{
+    ssd1309_blit_strided(p, x, y, bits, width, pages, pages, 1);
+}
+
+/**
+ * @brief Find a scaled glyph in the cache, expanding it on a miss
+ *
+ * @param font Cache key identifying the font
+ * @param scale Scale factor
+ * @param c Character
+ * @param src Unscaled glyph, column-major with `parts` bytes per column
+ * @param src_width Unscaled width in columns
+ * @param parts Unscaled height in pages
+ * @return The cached glyph, or NULL if it is too large to cache
+ */
+static const ssd1309_glyph_t *ssd1309_glyph_lookup(const void *font, uint32_t scale, char c,
+                                                  const uint8_t *src, uint32_t src_width, uint32_t parts)
+{
+    uint32_t width = src_width * scale;
+    uint32_t pages = parts * scale;
+
+    if (width * pages > SSD1309_GLYPH_CACHE_BYTES)
+        return NULL;
+
+    ssd1309_glyph_t *slot = &ssd1309_glyph_cache[0];
+    for (size_t i = 0; i < SSD1309_GLYPH_CACHE_SLOTS; ++i)
+    {
+        ssd1309_glyph_t *g = &ssd1309_glyph_cache[i];
+        if (g->font == font && g->scale == scale && g->c == c)
+        {
+            g->last_used = ++ssd1309_glyph_clock;
+            return g;
+        }
+        if (g->last_used < slot->last_used)
+            slot = g;
+    }
+
+    // Evict the least recently used slot and expand the glyph into it
+    slot->font = font;
+    slot->scale = scale;
+    slot->c = c;
+    slot->width = width;
+    slot->pages = pages;
+    slot->last_used = ++ssd1309_glyph_clock;
+    memset(slot->bits, 0, width * pages);
+
+    for (uint32_t w = 0; w < src_width; ++w, src += parts)
+    {
+        uint8_t *col = slot->bits + w * scale * pages;
+        for (uint32_t row = 0; row < parts * 8; ++row)
+        {
+            if (!((src[row >> 3] >> (row & 7)) & 1))
+                continue;
+            for (uint32_t k = row * scale; k < (row + 1) * scale; ++k)
+                col[k >> 3] |= 1 << (k & 7);
+        }
+        for (uint32_t k = 1; k < scale; ++k)
+            memcpy(col + k * pages, col, pages);
+    }
+
+    return slot;
+}
+
+#define SSD1309_ANIM_KEYFRAME 0x01 ///< frame flag: bytes replace the buffer instead of XOR
+
+void ssd1309_anim_init(ssd1309_anim_t *anim, const uint8_t *data)
+{
+    anim->data = data;
+    anim->width = data[0];
+    anim->pages = data[1];
+    anim->frames = data[2];
+    anim->next = data + 3;
+    anim->frame = 0;
+}
+
+void ssd1309_anim_draw_frame(ssd1309_t *p, ssd1309_anim_t *anim, uint32_t x, uint32_t page)
+{
+    if (anim->frame >= anim->frames)
+    {
+        anim->next = anim->data + 3;
+        anim->frame = 0;
+    }
+
+    const uint8_t *src = anim->next;
+    bool key = *src++ & SSD1309_ANIM_KEYFRAME;
+    uint32_t total = anim->width * anim->pages;
+
+    for (uint32_t pos = 0; pos < total;)
+    {
+        uint8_t token = *src++;
+        uint32_t count = (token & 0x7f) + 1;
+        bool run = token & 0x80;
+        uint8_t value = run ? *src++ : 0;
+
+        // An all zero delta run leaves the buffer unchanged
+        if (run && value == 0 && !key)
+        {
+            pos += count;
+            continue;
+        }
+
+        uint32_t col = pos % anim->width;
+        uint32_t dst_page = page + pos / anim->width;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint8_t v = run ? value : *src++;
+            if (dst_page < p->pages && x + col < p->width)
+            {
+                uint8_t *dst = p->buffer + dst_page * p->width + x + col;
+                *dst = key ? v : *dst ^ v;
+            }
+            if (++col == anim->width)
+            {
+                col = 0;
+                ++dst_page;
+            }
+        }
+        pos += count;
+    }
+
+    anim->next = src;
+    ++anim->frame;
+
+    if (x < p->width && page < p->pages)
+    {
+        uint32_t x1 = x + anim->width - 1;
+        uint32_t page1 = page + anim->pages - 1;
+        ssd1309_mark_dirty(p, x, x1 < p->width ? x1 : p->width - 1u, page, page1 < p->pages ? page1 : p->pages - 1u);
+    }
 }
 
 void ssd1309_draw_char_with_font(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, char c)
@@ -269,6 +922,23 @@ void ssd1309_draw_char_with_font(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t
         return;
 
     uint32_t parts_per_line = (font[0] >> 3) + ((font[0] & 7) > 0);
+
+    const uint8_t *src = font + 5 + (c - font[3]) * font[1] * parts_per_line;
+
+    // Font data is already column-major and page-packed
+    if (scale == 1)
+    {
+        ssd1309_blit(p, x, y, src, font[1], parts_per_line);
+        return;
+    }
+
+    const ssd1309_glyph_t *g = ssd1309_glyph_lookup(font, scale, c, src, font[1], parts_per_line);
+    if (g)
+    {
+        ssd1309_blit(p, x, y, g->bits, g->width, g->pages);
+        return;
+    }
+
     for (uint8_t w = 0; w < font[1]; ++w)
     { // width
         uint32_t pp = (c - font[3]) * font[1] * parts_per_line + w * parts_per_line + 5;
@@ -297,12 +967,63 @@ void ssd1309_draw_string_with_font(ssd1309_t *p, uint32_t x, uint32_t y, uint32_
 
 void ssd1309_draw_char(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, char c)
 {
-    ssd1309_draw_char_with_font(p, x, y, scale, font_8x5, c);
+    ssd1309_draw_glyph(p, x, y, scale, &ssd1309_font_8x5, c);
 }
 
 void ssd1309_draw_string(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const char *s)
 {
-    ssd1309_draw_string_with_font(p, x, y, scale, font_8x5, s);
+    ssd1309_draw_text(p, x, y, scale, &ssd1309_font_8x5, s);
+}
+
+uint32_t ssd1309_draw_glyph(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const ssd1309_font_t *font, char c)
+{
+    uint8_t uc = (uint8_t)c;
+    if (uc < font->first || uc > font->last)
+        return 0;
+
+    uint32_t index = uc - font->first;
+    const uint8_t *src = font->data + font->offsets[index];
+    uint32_t width = font->widths[index];
+
+    if (scale == 1)
+    {
+        ssd1309_blit(p, x, y, src, width, font->pages);
+    }
+    else
+    {
+        const ssd1309_glyph_t *g = ssd1309_glyph_lookup(font, scale, c, src, width, font->pages);
+        if (g)
+        {
+            ssd1309_blit(p, x, y, g->bits, g->width, g->pages);
+        }
+        else
+        {
+            for (uint32_t w = 0; w < width; ++w, src += font->pages)
+                for (uint32_t row = 0; row < font->pages * 8u; ++row)
+                    if ((src[row >> 3] >> (row & 7)) & 1)
+                        ssd1309_draw_square(p, x + w * scale, y + row * scale, scale, scale);
+        }
+    }
+
+    return (width + font->spacing) * scale;
+}
+
+void ssd1309_draw_text(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const ssd1309_font_t *font, const char *s)
+{
+    while (*s)
+        x += ssd1309_draw_glyph(p, x, y, scale, font, *(s++));
+}
+
+uint32_t ssd1309_text_width(const ssd1309_font_t *font, uint32_t scale, const char *s)
+{
+    uint32_t width = 0;
+    for (; *s; ++s)
+    {
+        uint8_t uc = (uint8_t)*s;
+        if (uc >= font->first && uc <= font->last)
+            width += (font->widths[uc - font->first] + font->spacing) * scale;
+    }
+    return width;
 }
 
 static inline uint32_t ssd1309_bmp_get_val(const uint8_t *data, const size_t offset, uint8_t size)
@@ -321,10 +1042,22 @@ static inline uint32_t ssd1309_bmp_get_val(const uint8_t *data, const size_t off
     __builtin_unreachable();
 }
 
-void ssd1309_bmp_show_image_with_offset(ssd1309_t *p, const uint8_t *data, const long size, uint32_t x_offset, uint32_t y_offset)
+/**
+ * @brief Decoded header of a monochrome, uncompressed BMP
+ */
+typedef struct
+{
+    uint32_t width;
+    int32_t height;          /**< positive for bottom-up images */
+    const uint8_t *pixels;   /**< first stored row */
+    uint32_t bytes_per_line; /**< stored row size including padding */
+    uint8_t color_val;       /**< bit value of lit pixels */
+} ssd1309_bmp_t;
+
+static bool ssd1309_bmp_parse(const uint8_t *data, const long size, ssd1309_bmp_t *bmp)
 {
     if (size < 54) // data smaller than header
-        return;
+        return false;
 
     const uint32_t bfOffBits = ssd1309_bmp_get_val(data, 10, 4);
     const uint32_t biSize = ssd1309_bmp_get_val(data, 14, 4);
@@ -334,10 +1067,10 @@ void ssd1309_bmp_show_image_with_offset(ssd1309_t *p, const uint8_t *data, const
     const uint32_t biCompression = ssd1309_bmp_get_val(data, 30, 4);
 
     if (biBitCount != 1) // image not monochrome
-        return;
+        return false;
 
     if (biCompression != 0) // image compressed
-        return;
+        return false;
 
     const int table_start = 14 + biSize;
     uint8_t color_val = 0;
@@ -355,20 +1088,87 @@ void ssd1309_bmp_show_image_with_offset(ssd1309_t *p, const uint8_t *data, const
     if (bytes_per_line & 3)
         bytes_per_line = (bytes_per_line ^ (bytes_per_line & 3)) + 4;
 
-    const uint8_t *img_data = data + bfOffBits;
+    bmp->width = biWidth;
+    bmp->height = biHeight;
+    bmp->pixels = data + bfOffBits;
+    bmp->bytes_per_line = bytes_per_line;
+    bmp->color_val = color_val;
+    return true;
+}
+
+void ssd1309_bmp_show_image_with_offset(ssd1309_t *p, const uint8_t *data, const long size, uint32_t x_offset, uint32_t y_offset)
+{
+    ssd1309_bmp_t bmp;
+    if (!ssd1309_bmp_parse(data, size, &bmp))
+        return;
 
-    int32_t step = biHeight > 0 ? -1 : 1;
-    int32_t border = biHeight > 0 ? -1 : -biHeight;
+    const uint8_t *img_data = bmp.pixels;
 
-    for (uint32_t y = biHeight > 0 ? biHeight - 1 : 0; y != (uint32_t)border; y += step)
+    int32_t step = bmp.height > 0 ? -1 : 1;
+    int32_t border = bmp.height > 0 ? -1 : -bmp.height;
+
+    for (uint32_t y = bmp.height > 0 ? bmp.height - 1 : 0; y != (uint32_t)border; y += step)
     {
-        for (uint32_t x = 0; x < biWidth; ++x)
+        for (uint32_t x = 0; x < bmp.width; ++x)
         {
-            if (((img_data[x >> 3] >> (7 - (x & 7))) & 1) == color_val)
+            if (((img_data[x >> 3] >> (7 - (x & 7))) & 1) == bmp.color_val)
                 ssd1309_draw_pixel(p, x_offset + x, y_offset + y);
         }
-        img_data += bytes_per_line;
+        img_data += bmp.bytes_per_line;
+    }
+}
+
+bool ssd1309_image_from_bmp(ssd1309_image_t *img, const uint8_t *data, const long size)
+{
+    ssd1309_bmp_t bmp;
+    if (!ssd1309_bmp_parse(data, size, &bmp))
+        return false;
+
+    uint32_t height = bmp.height > 0 ? bmp.height : -bmp.height;
+    img->width = bmp.width;
+    img->height = height;
+    img->pages = (height + 7) / 8;
+    if ((img->data = calloc(img->pages * img->width, 1)) == NULL)
+        return false;
+
+    const uint8_t *img_data = bmp.pixels;
+
+    int32_t step = bmp.height > 0 ? -1 : 1;
+    int32_t border = bmp.height > 0 ? -1 : -bmp.height;
+
+    for (uint32_t y = bmp.height > 0 ? bmp.height - 1 : 0; y != (uint32_t)border; y += step)
+    {
+        uint8_t *row = img->data + (y >> 3) * img->width;
+        uint8_t bit = 1 << (y & 7);
+        for (uint32_t x = 0; x < bmp.width; ++x)
+        {
+            if (((img_data[x >> 3] >> (7 - (x & 7))) & 1) == bmp.color_val)
+                row[x] |= bit;
+        }
+        img_data += bmp.bytes_per_line;
+    }
+
+    return true;
+}
+
+void ssd1309_image_free(ssd1309_image_t *img)
+{
+    free(img->data);
+    img->data = NULL;
+}
+
+void ssd1309_draw_image(ssd1309_t *p, const ssd1309_image_t *img, uint32_t x, uint32_t y)
+{
+    // A full screen image lines up with the buffer byte for byte
+    if (x == 0 && y == 0 && img->width == p->width && img->pages == p->pages)
+    {
+        for (size_t i = 0; i < p->bufsize; ++i)
+            p->buffer[i] |= img->data[i];
+        ssd1309_mark_dirty(p, 0, p->width - 1, 0, p->pages - 1);
+        return;
     }
+
+    ssd1309_blit_strided(p, x, y, img->data, img->width, img->pages, 1, img->width);
 }
 
 inline void ssd1309_bmp_show_image(ssd1309_t *p, const uint8_t *data, const long size)
@@ -378,17 +1178,133 @@ inline void ssd1309_bmp_show_image(ssd1309_t *p, const uint8_t *data, const long
 
 void ssd1309_show(ssd1309_t *p)
 {
-    uint8_t payload[] = {SET_COL_ADDR, 0, p->width - 1, SET_PAGE_ADDR, 0, p->pages - 1};
-    if (p->width == 64)
+    // An async flush may still be reading the front buffer and counting into stats
+    ssd1309_wait(p);
+    memset(&p->stats, 0, sizeof(p->stats));
+
+    if (p->front)
+    {
+        memcpy(p->front, p->buffer, p->bufsize);
+        p->front_valid = true;
+    }
+
+    // Address window and buffer data in one transaction
+    ssd1309_select(p);
+    ssd1309_send_window(p, 0, p->width - 1, 0, p->pages - 1);
+    ssd1309_spi_write(p, true, p->front ? p->front : p->buffer, p->bufsize);
+    ssd1309_deselect(p);
+    ssd1309_mark_clean(p);
+}
+
+void ssd1309_send_commands(ssd1309_t *p, const uint8_t *cmds, size_t len)
+{
+    ssd1309_write_cmds(p, cmds, len);
+}
+
+void ssd1309_show_partial(ssd1309_t *p)
+{
+    ssd1309_wait(p);
+    memset(&p->stats, 0, sizeof(p->stats));
+
+    uint8_t *src = ssd1309_sync_front(p);
+
+    bool selected = false;
+    uint8_t page = 0;
+    while (page < p->pages)
+    {
+        uint8_t x0 = p->dirty_x0[page];
+        uint8_t x1 = p->dirty_x1[page];
+        if (x0 > x1)
+        {
+            ++page;
+            continue;
+        }
+
+        // Pages with the same column range share one address window; the
+        // controller wraps to the next page at the end of each row
+        uint8_t last = page;
+        while (last + 1 < p->pages && p->dirty_x0[last + 1] == x0 && p->dirty_x1[last + 1] == x1)
+            ++last;
+
+        // All windows go out in a single transaction
+        if (!selected)
+        {
+            ssd1309_select(p);
+            selected = true;
+        }
+
+        ssd1309_send_window(p, x0, x1, page, last);
+        if (x0 == 0 && x1 == p->width - 1)
+        {
+            ssd1309_spi_write(p, true, src + page * p->width, (last - page + 1) * p->width);
+        }
+        else
+        {
+            for (uint8_t i = page; i <= last; ++i)
+                ssd1309_spi_write(p, true, src + i * p->width + x0, x1 - x0 + 1);
+        }
+
+        page = last + 1;
+    }
+
+    if (selected)
+        ssd1309_deselect(p);
+    ssd1309_mark_clean(p);
+}
+
+bool ssd1309_show_async(ssd1309_t *p, ssd1309_flush_cb_t cb, void *user_data)
+{
+    if (p->busy)
+        return false;
+
+    if (p->dma_chan < 0)
     {
-        payload[1] += 32;
-        payload[2] += 32;
+        ssd1309_show_partial(p);
+        if (cb)
+            cb(user_data);
+        return true;
     }
 
-    // Send column and page address commands
-    for (size_t i = 0; i < sizeof(payload); ++i)
-        ssd1309_write(p, payload[i]);
+    memset(&p->stats, 0, sizeof(p->stats));
+
+    uint8_t *src = ssd1309_sync_front(p);
 
-    // Write buffer data to display
-    ssd1309_write_data(p, p->buffer, p->bufsize);
+    uint8_t page = 0;
+    while (page < p->pages && p->dirty_x0[page] > p->dirty_x1[page])
+        ++page;
+    if (page == p->pages)
+    {
+        if (cb)
+            cb(user_data);
+        return true;
+    }
+
+    // The windows are taken over so drawing during the flush marks afresh
+    memcpy(p->async_x0, p->dirty_x0, sizeof(p->async_x0));
+    memcpy(p->async_x1, p->dirty_x1, sizeof(p->async_x1));
+    ssd1309_mark_clean(p);
+    p->async_src = src;
+    p->async_page = 0;
+    p->async_window_end = 0;
+    p->flush_cb = cb;
+    p->flush_cb_data = user_data;
+
+    // Each window is sent synchronously, then CS stays asserted for the DMA
+    // transfers and is released by the last completion interrupt
+    ssd1309_select(p);
+    p->busy = true;
+    ssd1309_async_next(p);
+
+    return true;
+}
+
+inline bool ssd1309_is_busy(ssd1309_t *p)
+{
+    return p->busy;
+}
+
+void ssd1309_wait(ssd1309_t *p)
+{
+    while (p->busy)
+        tight_loop_contents();
 }
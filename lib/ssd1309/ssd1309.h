@@ -34,6 +34,7 @@ Modified 2026:
 
 #ifndef _inc_ssd1309
 #define _inc_ssd1309
+#include <stdio.h>
 #include <pico/stdlib.h>
 #include <hardware/spi.h>
 
@@ -58,8 +59,79 @@ typedef enum
 	SET_DISP_CLK_DIV = 0xD5,
 	SET_PRECHARGE = 0xD9,
 	SET_VCOM_DESEL = 0xDB,
+	SET_HSCROLL = 0x26,
+	SET_SCROLL_OFF = 0x2E,
+	SET_SCROLL_ON = 0x2F,
 } ssd1309_command_t;
 
+/**
+ *	@brief maximum number of pages supported by the controller (64 rows)
+ */
+#define SSD1309_MAX_PAGES 8
+
+/**
+ *	@brief transfer counters, reset at the start of every flush
+ */
+typedef struct
+{
+	size_t bytes;		   /**< bytes sent over SPI (commands and data) */
+	uint32_t transactions; /**< SPI bursts (blocking writes and DMA transfers) */
+	uint32_t cs_toggles;   /**< CS assertions */
+} ssd1309_stats_t;
+
+/**
+ *	@brief font compiled by tools/font_compiler.py into blit-ready tables
+ *
+ *	Glyphs are stored column-major with `pages` bytes per column (LSB on
+ *	top), the same layout as the display buffer.
+ */
+typedef struct
+{
+	uint8_t pages;			 /**< glyph height in pages */
+	uint8_t spacing;		 /**< columns between glyphs */
+	uint8_t first;			 /**< first character in the font */
+	uint8_t last;			 /**< last character in the font */
+	uint8_t max_width;		 /**< widest glyph in columns */
+	const uint16_t *offsets; /**< offset of each glyph in data */
+	const uint8_t *widths;	 /**< width of each glyph in columns */
+	const uint8_t *data;	 /**< glyph data */
+} ssd1309_font_t;
+
+/**
+ *	@brief monochrome image pre-decoded into display page order
+ *
+ *	Rows of 8 pixels are packed into bytes (LSB on top), page by page, so a
+ *	full screen image has the same layout as the display buffer.
+ */
+typedef struct
+{
+	uint16_t width;	 /**< width in pixels */
+	uint16_t height; /**< height in pixels */
+	uint16_t pages;	 /**< height in pages */
+	uint8_t *data;	 /**< pages * width bytes */
+} ssd1309_image_t;
+
+/**
+ *	@brief playback state of an animation encoded by tools/sprite_encoder.py
+ *
+ *	Frames are run-length encoded keyframes or XOR deltas against the
+ *	previous frame, in display page order.
+ */
+typedef struct
+{
+	const uint8_t *data; /**< encoded animation */
+	const uint8_t *next; /**< next frame to decode */
+	uint8_t width;		 /**< width in pixels */
+	uint8_t pages;		 /**< height in pages */
+	uint8_t frames;		 /**< number of frames */
+	uint8_t frame;		 /**< index of the next frame */
+} ssd1309_anim_t;
+
+/**
+ *	@brief called when an asynchronous flush has finished, from interrupt context
+ */
+typedef void (*ssd1309_flush_cb_t)(void *user_data);
+
 /**
  *	@brief holds the configuration
  */
@@ -72,8 +144,22 @@ typedef struct
 	uint8_t cs_pin;	   /**< Chip Select (CS) pin */
 	uint8_t dc_pin;	   /**< Data/Command (DC) pin */
 	uint8_t rst_pin;   /**< Reset (RST) pin */
-	uint8_t *buffer;   /**< display buffer */
+	uint8_t *buffer;   /**< display buffer (back buffer when double buffering) */
+	uint8_t *front;	   /**< copy of what the panel shows, NULL unless double buffering */
+	bool front_valid;  /**< front matches the panel RAM; if not, the next flush sends every dirty byte */
 	size_t bufsize;	   /**< buffer size */
+	uint8_t dirty_x0[SSD1309_MAX_PAGES]; /**< first modified column per page since last flush */
+	uint8_t dirty_x1[SSD1309_MAX_PAGES]; /**< last modified column per page (x0 > x1 when clean) */
+	ssd1309_stats_t stats; /**< counters of the last flush */
+	int dma_chan;		   /**< DMA channel used for async flushes, -1 if none could be claimed */
+	volatile bool busy;	   /**< an async flush is in progress */
+	const uint8_t *async_src;				/**< buffer the async flush sends from */
+	uint8_t async_x0[SSD1309_MAX_PAGES];	/**< column range per page the async flush sends */
+	uint8_t async_x1[SSD1309_MAX_PAGES];	/**< last column per page (x0 > x1 when not sent) */
+	uint8_t async_page;						/**< next page the async flush sends */
+	uint8_t async_window_end;				/**< page after the last one of the current address window */
+	ssd1309_flush_cb_t flush_cb; /**< completion callback of the current async flush */
+	void *flush_cb_data;		 /**< user data passed to flush_cb */
 } ssd1309_t;
 
 /**
@@ -102,6 +188,23 @@ bool ssd1309_init(ssd1309_t *p, uint16_t width, uint16_t height,
  */
 void ssd1309_deinit(ssd1309_t *p);
 
+/**
+ *	@brief enable or disable double buffering
+ *
+ *	Drawing keeps targeting the buffer. On flush the modified regions are
+ *	diffed against a front buffer holding what the panel shows; only the
+ *	changed columns are copied to the front buffer and sent from there, so
+ *	drawing during an async flush cannot tear the transferred frame.
+ *
+ *	@param[in] p : instance of display
+ *	@param[in] enable : true to allocate the front buffer, false to free it
+ *
+ * 	@return bool.
+ *	@retval true for Success
+ *	@retval false if the front buffer could not be allocated
+ */
+bool ssd1309_set_double_buffer(ssd1309_t *p, bool enable);
+
 /**
  *	@brief turn off display
  *
@@ -136,14 +239,145 @@ void ssd1309_contrast(ssd1309_t *p, uint8_t val);
 */
 void ssd1309_invert(ssd1309_t *p, uint8_t inv);
 
+/**
+	@brief set the RAM row shown on the top line of the panel
+
+	Rolls the whole picture vertically (wrapping around) without sending
+	the buffer again.
+
+	@param[in] p : instance of display
+	@param[in] line : RAM row, 0 for the normal layout
+
+*/
+void ssd1309_set_start_line(ssd1309_t *p, uint8_t line);
+
+/**
+	@brief shift the picture vertically on the panel
+
+	Remaps COM lines to rows, wrapping around, so the same RAM is shown
+	on different pixels without resending the buffer. Independent of the
+	start line.
+
+	@param[in] p : instance of display
+	@param[in] rows : COM offset, 0 for the normal layout
+
+*/
+void ssd1309_set_display_offset(ssd1309_t *p, uint8_t rows);
+
+/**
+	@brief drive only a band of rows, leaving the rest of the panel dark
+
+	Lowers the multiplex ratio so only the first rows COM lines are scanned,
+	starting at RAM row row0. Unlit rows draw no current. Overrides the
+	start line; call with rows = height and row0 = 0 to restore the full
+	panel.
+
+	@param[in] p : instance of display
+	@param[in] row0 : first RAM row shown
+	@param[in] rows : number of rows driven, 16..height (out of range means height)
+
+*/
+void ssd1309_set_active_rows(ssd1309_t *p, uint8_t row0, uint8_t rows);
+
+/**
+	@brief start continuous hardware horizontal scroll of a band of pages
+
+	The panel content wraps around within the band. The buffer must not be
+	flushed while scrolling; stop the scroll first.
+
+	@param[in] p : instance of display
+	@param[in] left : scroll direction, true for left
+	@param[in] page0 : first page of the band
+	@param[in] page1 : last page of the band
+	@param[in] interval : step interval, 0-7 as encoded by the controller (0 = 5 frames, 7 = 2 frames)
+
+*/
+void ssd1309_scroll_horizontal(ssd1309_t *p, bool left, uint8_t page0, uint8_t page1, uint8_t interval);
+
+/**
+	@brief stop hardware scrolling
+
+	The controller leaves scrolled content in RAM, so the next flush sends
+	the whole buffer, skipping no byte even when double buffering.
+
+	@param[in] p : instance of display
+
+*/
+void ssd1309_scroll_stop(ssd1309_t *p);
+
+/**
+	@brief send a sequence of command bytes under a single CS assertion
+
+	@param[in] p : instance of display
+	@param[in] cmds : command bytes including their arguments
+	@param[in] len : number of bytes
+
+*/
+void ssd1309_send_commands(ssd1309_t *p, const uint8_t *cmds, size_t len);
+
 /**
 	@brief display buffer, should be called on change
 
+	Waits for an async flush in progress to finish first.
+
 	@param[in] p : instance of display
 
 */
 void ssd1309_show(ssd1309_t *p);
 
+/**
+	@brief send only the regions of the buffer modified since the last flush
+
+	Each run of pages sharing the same dirty column range is sent with a
+	single SET_COL_ADDR/SET_PAGE_ADDR window. Waits for an async flush in
+	progress to finish first.
+
+	@param[in] p : instance of display
+
+*/
+void ssd1309_show_partial(ssd1309_t *p);
+
+/**
+	@brief start sending the modified regions of the buffer in the background
+
+	The dirty regions are sent in the same column windows as
+	ssd1309_show_partial(), by a DMA channel feeding the SPI TX FIFO: one
+	transfer per page, or per band of full width pages. The DMA completion
+	interrupt sends the next window and starts the next transfer, and
+	releases CS after the last one. Each extra window costs its 6 command
+	bytes and the wait for the FIFO to drain before them, far less than
+	the unchanged columns a full width band would send. Falls back to
+	ssd1309_show_partial() if no DMA channel is available.
+
+	Drawing into the buffer while the flush is running is allowed; touched
+	regions are sent again by the next flush.
+
+	@param[in] p : instance of display
+	@param[in] cb : called on completion (may be NULL)
+	@param[in] user_data : passed to cb
+
+	@return bool.
+	@retval true if the flush was started (or nothing needed sending)
+	@retval false if a flush is already in progress
+*/
+bool ssd1309_show_async(ssd1309_t *p, ssd1309_flush_cb_t cb, void *user_data);
+
+/**
+	@brief check whether an async flush is in progress
+
+	@param[in] p : instance of display
+
+*/
+bool ssd1309_is_busy(ssd1309_t *p);
+
+/**
+	@brief block until an async flush in progress has finished
+
+	@param[in] p : instance of display
+
+*/
+void ssd1309_wait(ssd1309_t *p);
+
 /**
 	@brief clear display buffer
 
@@ -152,6 +386,17 @@ void ssd1309_show(ssd1309_t *p);
 */
 void ssd1309_clear(ssd1309_t *p);
 
+/**
+	@brief write the display buffer as a plain (P1) PBM image
+
+	Lets frames be saved and compared without the panel.
+
+	@param[in] p : instance of display
+	@param[in] f : stream to write to, e.g. stdout for the serial console
+
+*/
+void ssd1309_write_pbm(ssd1309_t *p, FILE *f);
+
 /**
 	@brief clear pixel on buffer
 
@@ -234,9 +479,66 @@ void ssd1309_bmp_show_image_with_offset(ssd1309_t *p, const uint8_t *data, const
 */
 void ssd1309_bmp_show_image(ssd1309_t *p, const uint8_t *data, const long size);
 
+/**
+	@brief decode a monochrome bitmap once into page order
+
+	@param[out] img : decoded image, release with ssd1309_image_free()
+	@param[in] data : image data (whole file)
+	@param[in] size : size of image data in bytes
+
+	@return bool.
+	@retval true for Success
+	@retval false if the bitmap is not supported or allocation failed
+*/
+bool ssd1309_image_from_bmp(ssd1309_image_t *img, const uint8_t *data, const long size);
+
+/**
+	@brief free the data of a decoded image
+
+	@param[in] img : image to free
+*/
+void ssd1309_image_free(ssd1309_image_t *img);
+
+/**
+	@brief draw a decoded image at any position
+
+	Set pixels are ORed into the buffer with whole-byte operations.
+
+	@param[in] p : instance of display
+	@param[in] img : decoded image
+	@param[in] x : x position of top left corner
+	@param[in] y : y position of top left corner
+*/
+void ssd1309_draw_image(ssd1309_t *p, const ssd1309_image_t *img, uint32_t x, uint32_t y);
+
+/**
+	@brief prepare an encoded animation for playback
+
+	@param[out] anim : playback state
+	@param[in] data : animation generated by tools/sprite_encoder.py
+*/
+void ssd1309_anim_init(ssd1309_anim_t *anim, const uint8_t *data);
+
+/**
+	@brief decode the next frame straight into the buffer
+
+	Keyframes overwrite the animation area, delta frames are XORed into it,
+	so nothing else may be drawn over the area between frames. Playback
+	loops after the last frame.
+
+	@param[in] p : instance of display
+	@param[in] anim : playback state
+	@param[in] x : x position of top left corner
+	@param[in] page : page of top left corner (animations are page aligned)
+*/
+void ssd1309_anim_draw_frame(ssd1309_t *p, ssd1309_anim_t *anim, uint32_t x, uint32_t page);
+
 /**
 	@brief draw char with given font
 
+	Scaled glyphs are expanded once into a small LRU cache and blitted
+	with byte-wise ORs on later calls.
+
 	@param[in] p : instance of display
 	@param[in] x : x starting position of char
 	@param[in] y : y starting position of char
@@ -280,4 +582,41 @@ void ssd1309_draw_string_with_font(ssd1309_t *p, uint32_t x, uint32_t y, uint32_
 */
 void ssd1309_draw_string(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const char *s);
 
+/**
+	@brief draw char with given compiled font
+
+	@param[in] p : instance of display
+	@param[in] x : x starting position of char
+	@param[in] y : y starting position of char
+	@param[in] scale : scale font to n times of original size (default should be 1)
+	@param[in] font : compiled font
+	@param[in] c : character to draw
+
+	@return horizontal advance in pixels, including spacing
+*/
+uint32_t ssd1309_draw_glyph(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const ssd1309_font_t *font, char c);
+
+/**
+	@brief draw string with given compiled font
+
+	@param[in] p : instance of display
+	@param[in] x : x starting position of text
+	@param[in] y : y starting position of text
+	@param[in] scale : scale font to n times of original size (default should be 1)
+	@param[in] font : compiled font
+	@param[in] s : text to draw
+*/
+void ssd1309_draw_text(ssd1309_t *p, uint32_t x, uint32_t y, uint32_t scale, const ssd1309_font_t *font, const char *s);
+
+/**
+	@brief width of a string drawn with ssd1309_draw_text()
+
+	@param[in] font : compiled font
+	@param[in] scale : scale factor
+	@param[in] s : text to measure
+
+	@return width in pixels, including trailing spacing
+*/
+uint32_t ssd1309_text_width(const ssd1309_font_t *font, uint32_t scale, const char *s);
+
 #endif
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Compile the raw ssd1309 font arrays into blit-ready ssd1309_font_t tables.
+
+The raw fonts (font.h, BMSPA_font.h, ...) are uint8_t arrays with a 5 byte
+header followed by fixed size, column-major glyphs:
+
+    <height>, <width>, <additional spacing per char>, <first char>, <last char>,
+    <data>
+
+For every font this emits a per-glyph offset table, a per-glyph width table
+and the glyph data, so drawing text needs no header parsing or offset math.
+Fonts marked as proportional have trailing empty columns trimmed from each
+glyph.
+
+Usage:
+    font_compiler.py -o <output basename> <header>[:proportional] ...
+
+writes <output basename>.h and <output basename>.c.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ARRAY_RE = re.compile(r"uint8_t\s+(\w+)\s*\[\s*\]\s*=\s*\{(.*?)\}\s*;", re.S)
+COMMENT_RE = re.compile(r"//[^\n]*|/\*.*?\*/", re.S)
+
+
+def parse_font(path):
+    """Return (name, bytes) of the first uint8_t array in a font header."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    match = ARRAY_RE.search(COMMENT_RE.sub("", text))
+    if not match:
+        sys.exit(f"{path}: no uint8_t font array found")
+    values = [int(v, 0) for v in match.group(2).replace("\n", " ").split(",") if v.strip()]
+    return match.group(1), values
+
+
+def compile_font(name, raw, proportional):
+    height, width, spacing, first, last = raw[:5]
+    pages = (height + 7) // 8
+    glyph_size = width * pages
+    count = last - first + 1
+
+    data = []
+    offsets = []
+    widths = []
+    for i in range(count):
+        glyph = raw[5 + i * glyph_size:5 + (i + 1) * glyph_size]
+        if len(glyph) != glyph_size:
+            sys.exit(f"{name}: truncated glyph {i + first}")
+        columns = [glyph[c * pages:(c + 1) * pages] for c in range(width)]
+        if proportional:
+            while columns and not any(columns[-1]):
+                columns.pop()
+            if not columns:
+                # blank glyphs (space) keep half a cell of advance
+                columns = [[0] * pages] * max(1, width // 2)
+        offsets.append(len(data))
+        widths.append(len(columns))
+        for column in columns:
+            data.extend(column)
+
+    if proportional:
+        spacing = max(spacing, 1)
+
+    return {
+        "name": name,
+        "pages": pages,
+        "spacing": spacing,
+        "first": first,
+        "last": last,
+        "max_width": max(widths),
+        "offsets": offsets,
+        "widths": widths,
+        "data": data,
+    }
+
+
+def format_array(values, per_line=16, fmt="0x{:02x}"):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("\t" + ", ".join(fmt.format(v) for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def write_outputs(basename, fonts, sources):
+    guard = "_inc_" + os.path.basename(basename)
+    header = os.path.basename(basename) + ".h"
+    banner = "/* Generated by font_compiler.py from {} - do not edit. */\n".format(
+        ", ".join(os.path.basename(s) for s in sources))
+
+    with open(basename + ".h", "w", encoding="utf-8") as h:
+        h.write(banner)
+        h.write(f"\n#ifndef {guard}\n#define {guard}\n\n#include \"ssd1309.h\"\n\n")
+        for font in fonts:
+            h.write(f"extern const ssd1309_font_t ssd1309_{font['name']};\n")
+        h.write("\n#endif\n")
+
+    with open(basename + ".c", "w", encoding="utf-8") as c:
+        c.write(banner)
+        c.write(f"\n#include \"{header}\"\n")
+        for font in fonts:
+            n = font["name"]
+            c.write(f"\nstatic const uint8_t {n}_data[] = {{\n{format_array(font['data'])}\n}};\n")
+            c.write(f"\nstatic const uint16_t {n}_offsets[] = {{\n"
+                    f"{format_array(font['offsets'], 12, '{:4d}')}\n}};\n")
+            c.write(f"\nstatic const uint8_t {n}_widths[] = {{\n"
+                    f"{format_array(font['widths'], 16, '{:2d}')}\n}};\n")
+            c.write(f"\nconst ssd1309_font_t ssd1309_{n} = {{\n"
+                    f"\t.pages = {font['pages']},\n"
+                    f"\t.spacing = {font['spacing']},\n"
+                    f"\t.first = {font['first']},\n"
+                    f"\t.last = {font['last']},\n"
+                    f"\t.max_width = {font['max_width']},\n"
+                    f"\t.offsets = {n}_offsets,\n"
+                    f"\t.widths = {n}_widths,\n"
+                    f"\t.data = {n}_data,\n"
+                    "};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-o", "--output", required=True, help="output basename (without extension)")
+    parser.add_argument("fonts", nargs="+", help="font header, optionally suffixed with :proportional")
+    args = parser.parse_args()
+
+    fonts = []
+    sources = []
+    for spec in args.fonts:
+        path, _, mode = spec.partition(":")
+        if mode not in ("", "proportional"):
+            sys.exit(f"{spec}: unknown mode '{mode}'")
+        name, raw = parse_font(path)
+        fonts.append(compile_font(name, raw, mode == "proportional"))
+        sources.append(path)
+
+    write_outputs(args.output, fonts, sources)
+
+
+if __name__ == "__main__":
+    main()
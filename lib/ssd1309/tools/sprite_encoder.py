@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Encode monochrome BMP frames into a compressed ssd1309 animation.
+
+Each frame is converted to display page order (vertical 8 pixel bytes,
+LSB on top, page by page) and stored either as a keyframe or as the XOR
+delta against the previous frame, then run-length encoded:
+
+    <width> <pages> <frames>
+    per frame: <flags> <tokens...>
+
+    flags  bit 0: keyframe (bytes replace the buffer), otherwise the bytes
+           are XORed into it
+    token  0x00-0x7f: (token + 1) literal bytes follow
+           0x80-0xff: the next byte repeats (token & 0x7f) + 1 times
+
+The decoder is ssd1309_anim_draw_frame(). A delta run of zeros leaves the
+buffer untouched and is skipped without writing.
+
+Usage:
+    sprite_encoder.py -n <name> -o <header> [-k <keyframe interval>] <bmp>...
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+KEYFRAME = 0x01
+MAX_COUNT = 128
+
+
+def read_bmp(path):
+    """Return (width, height, rows) of a 1 bit uncompressed BMP; rows[y][x] is 1 for lit pixels."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < 54 or data[:2] != b"BM":
+        sys.exit(f"{path}: not a BMP file")
+
+    off_bits, = struct.unpack_from("<I", data, 10)
+    bi_size, width, height = struct.unpack_from("<Iii", data, 14)
+    bit_count, compression = struct.unpack_from("<HI", data, 28)
+    if bit_count != 1 or compression != 0:
+        sys.exit(f"{path}: only monochrome uncompressed BMPs are supported")
+
+    # the palette entry that is black marks lit pixels, as in ssd1309_bmp_parse()
+    table = 14 + bi_size
+    color_val = 0
+    for i in range(2):
+        if not any(data[table + i * 4:table + i * 4 + 3]):
+            color_val = i
+            break
+
+    bytes_per_line = ((width + 31) // 32) * 4
+    rows = []
+    for r in range(abs(height)):
+        line = data[off_bits + r * bytes_per_line:off_bits + (r + 1) * bytes_per_line]
+        rows.append([1 if ((line[x >> 3] >> (7 - (x & 7))) & 1) == color_val else 0 for x in range(width)])
+    if height > 0:
+        rows.reverse()
+    return width, abs(height), rows
+
+
+def to_pages(width, height, rows):
+    pages = (height + 7) // 8
+    out = bytearray(width * pages)
+    for y in range(height):
+        for x in range(width):
+            if rows[y][x]:
+                out[(y >> 3) * width + x] |= 1 << (y & 7)
+    return out
+
+
+def rle(data):
+    out = bytearray()
+    literal = bytearray()
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:MAX_COUNT]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literal[:MAX_COUNT]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < MAX_COUNT:
+            run += 1
+        if run >= 3:
+            flush_literal()
+            out.append(0x80 | (run - 1))
+            out.append(data[i])
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+    flush_literal()
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-n", "--name", required=True, help="C array name")
+    parser.add_argument("-o", "--output", required=True, help="output header")
+    parser.add_argument("-k", "--keyframe-interval", type=int, default=0,
+                        help="emit a keyframe every N frames (0: first frame only)")
+    parser.add_argument("frames", nargs="+", help="BMP frames in order")
+    args = parser.parse_args()
+
+    size = None
+    frames = []
+    for path in args.frames:
+        width, height, rows = read_bmp(path)
+        if size and size != (width, height):
+            sys.exit(f"{path}: frame size {width}x{height} differs from {size[0]}x{size[1]}")
+        size = (width, height)
+        frames.append(to_pages(width, height, rows))
+
+    width, height = size
+    pages = (height + 7) // 8
+    if width > 255 or pages > 255 or len(frames) > 255:
+        sys.exit("animation too large: width, pages and frame count must fit in a byte")
+
+    encoded = bytearray([width, pages, len(frames)])
+    previous = None
+    for i, frame in enumerate(frames):
+        key = previous is None or (args.keyframe_interval and i % args.keyframe_interval == 0)
+        payload = frame if key else bytes(a ^ b for a, b in zip(frame, previous))
+        chunk = bytearray([KEYFRAME if key else 0]) + rle(payload)
+        print(f"{args.name} frame {i}: {'key' if key else 'delta'} {len(chunk)} bytes "
+              f"(raw {len(frame)})", file=sys.stderr)
+        encoded += chunk
+        previous = frame
+
+    guard = "_inc_" + args.name
+    sources = ", ".join(os.path.basename(p) for p in args.frames)
+    with open(args.output, "w", encoding="utf-8") as h:
+        h.write(f"/* Generated by sprite_encoder.py from {sources} - do not edit. */\n\n")
+        h.write(f"#ifndef {guard}\n#define {guard}\n\n#include <stdint.h>\n\n")
+        h.write(f"static const uint8_t {args.name}[] = {{\n")
+        for i in range(0, len(encoded), 16):
+            h.write("\t" + ", ".join(f"0x{b:02x}" for b in encoded[i:i + 16]) + ",\n")
+        h.write("};\n\n#endif\n")
+
+
+if __name__ == "__main__":
+    main()
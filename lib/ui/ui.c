@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "ui.h"
+#include "ssd1309_fonts.h"
+
+/**
+ * @brief Horizontal advance of one 8x5 font character at the given scale
+ */
+static uint8_t ui_char_advance(uint8_t scale)
+{
+    return (ssd1309_font_8x5.max_width + ssd1309_font_8x5.spacing) * scale;
+}
+
+static void ui_widget_init(ui_widget_t *w, ui_widget_type_t type, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    memset(w, 0, sizeof(*w));
+    w->type = type;
+    w->x = x;
+    w->y = y;
+    w->width = width;
+    w->height = height;
+    w->visible = true;
+    w->dirty = true;
+}
+
+void ui_label_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t chars, uint8_t scale)
+{
+    if (chars >= UI_LABEL_MAX)
+        chars = UI_LABEL_MAX - 1;
+    ui_widget_init(w, UI_LABEL, x, y, chars * ui_char_advance(scale), ssd1309_font_8x5.pages * 8 * scale);
+    w->label.scale = scale;
+}
+
+void ui_label_set(ui_widget_t *w, const char *text)
+{
+    if (strncmp(w->label.text, text, sizeof(w->label.text) - 1) == 0)
+        return;
+
+    strncpy(w->label.text, text, sizeof(w->label.text) - 1);
+    w->dirty = true;
+}
+
+void ui_digits_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t scale)
+{
+    ui_widget_init(w, UI_DIGITS, x, y, 5 * ui_char_advance(scale), ssd1309_font_8x5.pages * 8 * scale);
+    w->digits.scale = scale;
+}
+
+void ui_digits_set(ui_widget_t *w, uint8_t a, uint8_t b)
+{
+    if (w->digits.a == a && w->digits.b == b)
+        return;
+
+    w->digits.a = a;
+    w->digits.b = b;
+    w->dirty = true;
+}
+
+void ui_bar_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t max)
+{
+    ui_widget_init(w, UI_BAR, x, y, width, height);
+    w->bar.max = max ? max : 1;
+}
+
+void ui_bar_set(ui_widget_t *w, uint8_t value)
+{
+    if (value > w->bar.max)
+        value = w->bar.max;
+    if (w->bar.value == value)
+        return;
+
+    w->bar.value = value;
+    w->dirty = true;
+}
+
+void ui_menu_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t width,
+                  const char *const *items, uint8_t count, uint8_t spacing)
+{
+    ui_widget_init(w, UI_MENU, x, y, width, count ? (count - 1) * spacing + 8 : 0);
+    w->menu.items = items;
+    w->menu.count = count;
+    w->menu.spacing = spacing;
+}
+
+void ui_menu_select(ui_widget_t *w, uint8_t selected)
+{
+    if (w->menu.selected == selected || selected >= w->menu.count)
+        return;
+
+    w->menu.selected = selected;
+    w->dirty = true;
+}
+
+void ui_blink_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    ui_widget_init(w, UI_BLINK, x, y, width, height);
+}
+
+void ui_blink_set(ui_widget_t *w, bool on)
+{
+    if (w->blink.on == on)
+        return;
+
+    w->blink.on = on;
+    w->dirty = true;
+}
+
+void ui_blink_toggle(ui_widget_t *w)
+{
+    ui_blink_set(w, !w->blink.on);
+}
+
+void ui_set_visible(ui_widget_t *w, bool visible)
+{
+    if (w->visible == visible)
+        return;
+
+    w->visible = visible;
+    w->dirty = true;
+}
+
+/**
+ * @brief Draw a widget into its (already cleared) bounding box
+ */
+static void ui_draw(ssd1309_t *p, const ui_widget_t *w)
+{
+    switch (w->type)
+    {
+    case UI_LABEL:
+        ssd1309_draw_string(p, w->x, w->y, w->label.scale, w->label.text);
+        break;
+
+    case UI_DIGITS:
+    {
+        char str[8];
+        snprintf(str, sizeof(str), "%02u:%02u", w->digits.a, w->digits.b);
+        ssd1309_draw_string(p, w->x, w->y, w->digits.scale, str);
+        break;
+    }
+
+    case UI_BAR:
+    {
+        ssd1309_draw_empty_square(p, w->x, w->y, w->width - 1, w->height - 1);
+        // Scaled to the outline width like the original volume indicator, so a
+        // full bar also covers the right edge of the outline
+        uint32_t fill = (uint32_t)(w->width - 1) * w->bar.value / w->bar.max;
+        if (fill)
+            ssd1309_draw_square(p, w->x + 1, w->y + 1, fill, w->height - 2);
+        break;
+    }
+
+    case UI_MENU:
+        for (uint8_t i = 0; i < w->menu.count; ++i)
+        {
+            uint32_t y = w->y + i * w->menu.spacing;
+            if (i == w->menu.selected)
+                ssd1309_draw_char(p, w->x, y, 1, '>');
+            ssd1309_draw_string(p, w->x + 10, y, 1, w->menu.items[i]);
+        }
+        break;
+
+    case UI_BLINK:
+        if (w->blink.on)
+            ssd1309_draw_square(p, w->x, w->y, w->width, w->height);
+        break;
+    }
+}
+
+void ui_screen_show(ssd1309_t *p, const ui_screen_t *s)
+{
+    ssd1309_clear(p);
+    for (size_t i = 0; i < s->count; ++i)
+        s->widgets[i]->dirty = true;
+}
+
+bool ui_render(ssd1309_t *p, const ui_screen_t *s)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < s->count; ++i)
+    {
+        ui_widget_t *w = s->widgets[i];
+        if (!w->dirty)
+            continue;
+
+        ssd1309_clear_square(p, w->x, w->y, w->width, w->height);
+        if (w->visible)
+            ui_draw(p, w);
+        w->dirty = false;
+        changed = true;
+    }
+
+    return changed;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file ui.h
+ *
+ * retained widget layer on top of the ssd1309 driver
+ *
+ * Widgets keep their last value and bounding box. Setters only mark a widget
+ * dirty when the value actually changes, and ui_render() repaints just the
+ * dirty widgets, so the following partial flush only sends their pages.
+ * Rendering only touches the ssd1309 frame buffer and can run against an
+ * in-memory display.
+ */
+
+#ifndef _inc_ui
+#define _inc_ui
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "ssd1309.h"
+
+#define UI_LABEL_MAX 24
+
+/**
+ *	@brief kinds of widgets
+ */
+typedef enum
+{
+	UI_LABEL,  /**< text in the 8x5 font */
+	UI_DIGITS, /**< two zero padded numbers separated by a colon, e.g. HH:MM */
+	UI_BAR,	   /**< outlined horizontal bar filled in proportion to a value */
+	UI_MENU,   /**< vertical list of items with a cursor */
+	UI_BLINK,  /**< filled rectangle that can be toggled on and off */
+} ui_widget_type_t;
+
+/**
+ *	@brief a single widget
+ *
+ *	The bounding box is cleared before the widget is repainted, so it must
+ *	cover the largest content the widget can show.
+ */
+typedef struct
+{
+	ui_widget_type_t type; /**< kind of widget */
+	uint8_t x;			   /**< left column of bounding box */
+	uint8_t y;			   /**< top row of bounding box */
+	uint8_t width;		   /**< width of bounding box */
+	uint8_t height;		   /**< height of bounding box */
+	bool visible;		   /**< drawn when true, bounding box left blank otherwise */
+	bool dirty;			   /**< needs repainting on the next ui_render() */
+	union
+	{
+		struct
+		{
+			char text[UI_LABEL_MAX]; /**< current text */
+			uint8_t scale;			 /**< font scale */
+		} label;
+		struct
+		{
+			uint8_t a;	   /**< left number */
+			uint8_t b;	   /**< right number */
+			uint8_t scale; /**< font scale */
+		} digits;
+		struct
+		{
+			uint8_t value; /**< current value */
+			uint8_t max;   /**< value of a full bar */
+		} bar;
+		struct
+		{
+			const char *const *items; /**< item captions */
+			uint8_t count;			  /**< number of items */
+			uint8_t selected;		  /**< index of the item under the cursor */
+			uint8_t spacing;		  /**< rows between items */
+		} menu;
+		struct
+		{
+			bool on; /**< rectangle currently lit */
+		} blink;
+	};
+} ui_widget_t;
+
+/**
+ *	@brief a set of widgets shown together
+ */
+typedef struct
+{
+	ui_widget_t *const *widgets; /**< widgets on this screen */
+	size_t count;				 /**< number of widgets */
+} ui_screen_t;
+
+/**
+ *	@brief initialize a text label
+ *
+ *	@param[out] w : widget
+ *	@param[in] x : left column
+ *	@param[in] y : top row
+ *	@param[in] chars : maximum number of characters shown, sizes the bounding box
+ *	@param[in] scale : font scale
+ */
+void ui_label_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t chars, uint8_t scale);
+
+/**
+ *	@brief change the text of a label, marks it dirty if different
+ */
+void ui_label_set(ui_widget_t *w, const char *text);
+
+/**
+ *	@brief initialize a pair of two digit numbers drawn as "AA:BB"
+ */
+void ui_digits_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t scale);
+
+/**
+ *	@brief change the numbers of a digits widget, marks it dirty if different
+ */
+void ui_digits_set(ui_widget_t *w, uint8_t a, uint8_t b);
+
+/**
+ *	@brief initialize an outlined bar
+ *
+ *	The fill is (width - 1) * value / max columns wide, rounded down.
+ *
+ *	@param[in] max : value at which the bar is full
+ */
+void ui_bar_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t max);
+
+/**
+ *	@brief change the value of a bar, marks it dirty if different
+ */
+void ui_bar_set(ui_widget_t *w, uint8_t value);
+
+/**
+ *	@brief initialize a menu list
+ *
+ *	@param[in] items : item captions, must outlive the widget
+ *	@param[in] count : number of items
+ *	@param[in] spacing : rows between the tops of consecutive items
+ */
+void ui_menu_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t width,
+				  const char *const *items, uint8_t count, uint8_t spacing);
+
+/**
+ *	@brief move the menu cursor, marks it dirty if different
+ */
+void ui_menu_select(ui_widget_t *w, uint8_t selected);
+
+/**
+ *	@brief initialize a rectangle that can be switched on and off
+ */
+void ui_blink_init(ui_widget_t *w, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+
+/**
+ *	@brief light or blank the rectangle, marks it dirty if different
+ */
+void ui_blink_set(ui_widget_t *w, bool on);
+
+/**
+ *	@brief invert the rectangle
+ */
+void ui_blink_toggle(ui_widget_t *w);
+
+/**
+ *	@brief show or hide a widget, marks it dirty if different
+ */
+void ui_set_visible(ui_widget_t *w, bool visible);
+
+/**
+ *	@brief clear the display and mark every widget of a screen dirty
+ *
+ *	Call when switching screens; the next ui_render() paints the whole screen.
+ */
+void ui_screen_show(ssd1309_t *p, const ui_screen_t *s);
+
+/**
+ *	@brief repaint the dirty widgets of a screen into the frame buffer
+ *
+ *	@param[in] p : display to draw into
+ *	@param[in] s : screen currently shown
+ *
+ *	@return true if anything was repainted and the display needs a flush
+ */
+bool ui_render(ssd1309_t *p, const ui_screen_t *s);
+
+#endif
@@ -6,19 +6,28 @@
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
 #include "hardware/sync.h"
+#include "hardware/irq.h"
+#ifdef DISPLAY_MULTICORE
+#include "pico/multicore.h"
+#endif
 
 #include <RTClib.h>
+#include <ClockService.h>
+#include <AlarmClock.h>
+#include <DisplayPipeline.h>
 extern "C"
 {
 #include "ssd1309.h"
 #include "test_image.h"
+#include "ui.h"
 }
 #include "DFRobotDFPlayerMini.h"
 
 #define RTC_SDA_PIN 26
 #define RTC_SCL_PIN 27
 #define RTC_INT_PIN 22
-#define RTC_BAUDRATE 100 * 1000 // 100 kHz
+#define RTC_BAUDRATE 400 * 1000 // 400 kHz, rtc.begin() falls back to 100 kHz if the bus is unreliable
+#define RTC_RESYNC_S 3600        // Seconds between reads of the RTC by the software clock
 
 #define DISP_CLK_PIN 2
 #define DISP_DIN_PIN 3
@@ -27,7 +36,7 @@ extern "C"
 #define DISP_RST_PIN 7
 #define DISP_BAUDRATE 10 * 1000 * 1000 // 10 MHz
 #define DISP_WIDTH 128
-#define DISP_HEIGHT 64
+#define DISP_HEIGHT SCREEN_HEIGHT
 
 #define DFPLAYER_TX_PIN 12
 #define DFPLAYER_RX_PIN 13
@@ -37,68 +46,86 @@ extern "C"
 #define BTN_DOWN_PIN 19
 #define BTN_SELECT_PIN 18
 
-#define VOLUME_BAR_TIMEOUT_S 2
-#define DISPLAY_TIMEOUT_S 20
-#define BUTTON_DEBOUNCE_MS 200
+#define TICK_MS 1000
+
+#ifdef DISPLAY_MULTICORE
+#define DISPLAY_ON_CORE1 true
+#else
+#define DISPLAY_ON_CORE1 false
+#endif
 
 i2c_inst_t *_i2c1 = i2c1;
 spi_inst_t *_spi0 = spi0;
 uart_inst_t *_uart0 = uart0;
 
 RTC_DS3231 rtc;
+ClockService clock_service;
 ssd1309_t display;
+ssd1309_image_t splash_image;
 DFRobotDFPlayerMini player;
 
-enum State
-{
-    STATE_CLOCK,        // Main clock display
-    STATE_MENU,         // Menu mode
-    STATE_SET_ALARM,    // Setting alarm time
-    STATE_SET_TIME,     // Setting clock time
-    STATE_ALARM_RINGING // Alarm is ringing
-};
-enum MenuOption
-{
-    MENU_SET_ALARM,
-    MENU_SET_TIME,
-    MENU_EXIT,
-    MENU_COUNT
-};
-enum TimeSetting
+DateTime DEFAULT_DATETIME = DateTime(2000, 1, 1, 0, 0, 0); // 2000-01-01 00:00:00
+
+EventFlags events;
+DisplayPipeline pipeline;
+volatile uint32_t last_irq_us = 0; // time_us_32() of the latest GPIO interrupt, 32 bits so it reads in one go
+repeating_timer_t tick_timer;
+
+void reportRTCBus();
+
+/**
+ * @brief The alarm clock's view of the RTC, player, software clock and display
+ */
+class MainPlatform : public AlarmClockPlatform
 {
-    TIME_HOUR,
-    TIME_MINUTE,
-    // TIME_SECOND,
-    // TIME_DAY,
-    // TIME_MONTH,
-    // TIME_YEAR
-};
+public:
+    uint64_t timeUs() override { return time_us_64(); }
+    DateTime now() override { return clock_service.now(); }
 
-const char *DAY_NAMES[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
-const char *MONTH_NAMES[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
-                             "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-DateTime DEFAULT_DATETIME = DateTime(2000, 1, 1, 0, 0, 0); // 2000-01-01 00:00:00
+    void updateTime() override
+    {
+        clock_service.update();
+        reportRTCBus();
+    }
+
+    void adjustTime(const DateTime &dt) override { clock_service.adjust(dt); }
+
+    void programAlarm(const DateTime &dt) override
+    {
+        rtc.disableAlarm(1);
+        rtc.clearAlarm(1);
+        rtc.setAlarm1(dt, DS3231_A1_Hour);
+    }
+
+    void clearAlarm() override { rtc.clearAlarm(1); }
+    void playAlarm() override { player.play(1); }
+    void stopAlarm() override { player.stop(); }
+    void volumeUp() override { player.volumeUp(); }
+    void volumeDown() override { player.volumeDown(); }
+
+    bool playerFinished() override
+    {
+        bool finished = false;
+        while (player.available())
+        {
+            uint8_t type = player.readType();
+            player.read();
+            if (type == DFPlayerPlayFinished)
+            {
+                finished = true;
+            }
+        }
+        // Unmask what playerRxHandler() masked
+        uart_set_irq_enables(_uart0, true, false);
+        return finished;
+    }
+
+    void displayCommand(DisplayCommand cmd, uint8_t a, uint8_t b) override { pipeline.command(cmd, a, b); }
+    void noteInput() override { pipeline.noteInput(last_irq_us); }
+};
 
-State current_state = STATE_CLOCK;
-MenuOption current_menu_option = MENU_SET_ALARM;
-TimeSetting edit_time_field = TIME_HOUR;
-volatile bool rtc_interrupt_fired = false;
-volatile bool button_up_pressed = false;
-volatile bool button_down_pressed = false;
-volatile bool button_select_pressed = false;
-bool display_dirty = false; // Flag to indicate that display needs to be updated
-bool display_on = true;
-bool player_on = true;
-bool alarm_enabled = false;
-uint8_t alarm_hour = 7;
-uint8_t alarm_minute = 0;
-uint8_t time_setting_hour = 7;
-uint8_t time_setting_minute = 0;
-uint8_t current_volume = 15;
-uint64_t last_activity_time = 0;
-uint64_t volume_bar_start_time = 0;
-bool volume_bar_visible = false;
-DateTime current_time = DEFAULT_DATETIME;
+MainPlatform platform;
+AlarmClock app(platform);
 
 bool initDisplay()
 {
@@ -112,8 +139,15 @@ bool initDisplay()
         printf("Failed to initialize display!\n");
         return false;
     }
+    if (!ssd1309_set_double_buffer(&display, true))
+    {
+        printf("Failed to allocate display front buffer, using single buffer.\n");
+    }
     ssd1309_clear(&display);
-    ssd1309_bmp_show_image(&display, image_data, image_size);
+    if (ssd1309_image_from_bmp(&splash_image, image_data, image_size))
+    {
+        ssd1309_draw_image(&display, &splash_image, 0, 0);
+    }
     ssd1309_show(&display);
     return true;
 }
@@ -129,7 +163,7 @@ bool initRTC()
     gpio_set_dir(RTC_INT_PIN, GPIO_IN);
     gpio_pull_up(RTC_INT_PIN);
 
-    if (!rtc.begin(_i2c1))
+    if (!rtc.begin(_i2c1, 0x68, RTC_SDA_PIN, RTC_SCL_PIN, RTC_BAUDRATE))
     {
         printf("Failed to initialize RTC!\n");
         ssd1309_clear(&display);
@@ -138,10 +172,20 @@ bool initRTC()
         return false;
     }
 
+    printf("RTC bus at %lu kHz\n", (unsigned long)(rtc.baudrate() / 1000));
+
     // Adjust RTC time to compile time
     // rtc.adjust(DateTime(__DATE__, __TIME__));
 
-    if (rtc.lostPower())
+    // Everything needed at boot in one transaction
+    DS3231Snapshot snap;
+    if (!rtc.snapshot(snap))
+    {
+        printf("Failed to read RTC!\n");
+        return false;
+    }
+
+    if (snap.lostPower())
     {
         printf("RTC lost power, setting time to %04d-%02d-%02d %02d:%02d:%02d.\n",
                DEFAULT_DATETIME.year(), DEFAULT_DATETIME.month(), DEFAULT_DATETIME.day(),
@@ -154,12 +198,15 @@ bool initRTC()
     }
 
     // get alarm if set
-    if (rtc.getAlarmEnabled(1))
+    if (snap.alarmEnabled(1))
+    {
+        app.restoreAlarm(snap.alarm1.hour(), snap.alarm1.minute());
+    }
+
+    // From here on the time is counted locally and only read back from the RTC to resync
+    if (!clock_service.begin(&rtc, RTC_RESYNC_S))
     {
-        DateTime alarm_time = rtc.getAlarm1();
-        alarm_hour = alarm_time.hour();
-        alarm_minute = alarm_time.minute();
-        alarm_enabled = true;
+        printf("Failed to sync clock to RTC!\n");
     }
 
     return true;
@@ -185,7 +232,7 @@ bool initPlayer()
         ssd1309_show(&display);
         return false;
     }
-    player.volume(current_volume);
+    player.volume(app.volume());
     return true;
 }
 
@@ -203,498 +250,239 @@ void initButtons()
     gpio_set_dir(BTN_SELECT_PIN, GPIO_IN);
     gpio_pull_up(BTN_SELECT_PIN);
 }
-
-void interruptHandler(uint gpio, uint32_t events)
+void interruptHandler(uint gpio, uint32_t events_mask)
 {
+    last_irq_us = time_us_32();
     switch (gpio)
     {
     case RTC_INT_PIN:
-        rtc_interrupt_fired = true;
+        events.post(EVENT_ALARM);
         break;
     case BTN_UP_PIN:
-        button_up_pressed = true;
+        events.post(EVENT_BUTTON_UP);
         break;
     case BTN_DOWN_PIN:
-        button_down_pressed = true;
+        events.post(EVENT_BUTTON_DOWN);
         break;
     case BTN_SELECT_PIN:
-        button_select_pressed = true;
+        events.post(EVENT_BUTTON_SELECT);
         break;
     }
 }
 
-void initInterrupts()
+bool tickCallback(repeating_timer_t *timer)
 {
-    gpio_set_irq_enabled_with_callback(RTC_INT_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
-    gpio_set_irq_enabled_with_callback(BTN_UP_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
-    gpio_set_irq_enabled_with_callback(BTN_DOWN_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
-    gpio_set_irq_enabled_with_callback(BTN_SELECT_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
+    events.post(EVENT_TICK);
+    return true;
 }
 
-void powerDownPeripherals()
+void playerRxHandler()
 {
-    if (display_on == true)
-    {
-        ssd1309_poweroff(&display);
-        display_on = false;
-    }
-    if (player_on == true)
-    {
-        // Flush UART buffer
-        // while (uart_is_readable(_uart0))
-        // {
-        //     uart_getc(_uart0);
-        // }
-        // player.sleep();
-        // player_on = false;
-    }
+    // Masked until the main loop has read the data, the RX interrupt stays
+    // asserted while the FIFO holds bytes
+    uart_set_irq_enables(_uart0, false, false);
+    events.post(EVENT_PLAYER_RX);
 }
 
-void powerUpPeripherals()
+void initInterrupts()
 {
-    if (display_on == false)
-    {
-        ssd1309_poweron(&display);
-        display_on = true;
-    }
-    if (player_on == false)
-    {
-        // Flush UART buffer
-        // while (uart_is_readable(_uart0))
-        // {
-        //     uart_getc(_uart0);
-        // }
-        // player.start();
-        // sleep_ms(1000);
-        // player.volume(current_volume);
-        // player_on = true;
-    }
-}
+    gpio_set_irq_enabled_with_callback(RTC_INT_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
+    gpio_set_irq_enabled_with_callback(BTN_UP_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
+    gpio_set_irq_enabled_with_callback(BTN_DOWN_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
+    gpio_set_irq_enabled_with_callback(BTN_SELECT_PIN, GPIO_IRQ_EDGE_FALL, true, &interruptHandler);
 
-void drawClock(DateTime &now)
-{
-    // Draw time
-    char time_str[16];
-    snprintf(time_str, sizeof(time_str), "%02d:%02d", now.hour(), now.minute());
-    ssd1309_draw_string(&display, 20, 24, 3, time_str);
-
-    // Draw date
-    char date_str[24];
-    snprintf(date_str, sizeof(date_str), "%s %d %s",
-             DAY_NAMES[now.dayOfTheWeek()],
-             now.day(),
-             MONTH_NAMES[now.month() - 1]);
-    ssd1309_draw_string(&display, 20, 50, 1, date_str);
-
-    // Show alarm indicator if enabled
-    if (alarm_enabled)
-    {
-        char alarm_str[16];
-        snprintf(alarm_str, sizeof(alarm_str), "<> %02d:%02d", alarm_hour, alarm_minute);
-        ssd1309_draw_string(&display, 80, 0, 1, alarm_str);
-    }
+    add_repeating_timer_ms(-TICK_MS, tickCallback, NULL, &tick_timer);
 
-    display_dirty = true;
+    irq_set_exclusive_handler(UART0_IRQ, playerRxHandler);
+    irq_set_enabled(UART0_IRQ, true);
+    uart_set_irq_enables(_uart0, true, false);
 }
 
-void drawAlarmIndicator()
+#ifdef DISPLAY_MULTICORE
+void core1Main()
 {
-    // Flashing indicator
-    static bool flash = false;
-    flash = !flash;
-    if (flash)
-    {
-        ssd1309_draw_square(&display, 20, 13, 87, 5);
-    }
-    else
-    {
-        ssd1309_clear_square(&display, 20, 13, 87, 5);
-    }
-    display_dirty = true;
+    pipeline.serve();
 }
+#endif
 
-void drawMenu()
-{
-    // Draw title
-    ssd1309_draw_string(&display, 50, 0, 1, "MENU");
+#ifdef DISPLAY_BENCHMARK
+#include "splash_anim.h"
 
-    const char *menu_items[] = {
-        "Set Alarm",
-        "Set Time",
-        "Exit"};
+#define BENCHMARK_ITERATIONS 200
 
-    // Draw menu options
-    for (int i = 0; i < MENU_COUNT; i++)
-    {
-        int y = 15 + (i * 12);
-        if (i == current_menu_option)
-        {
-            // Draw selection indicator
-            ssd1309_draw_string(&display, 5, y, 1, ">");
-        }
-        ssd1309_draw_string(&display, 15, y, 1, menu_items[i]);
-    }
+ssd1309_anim_t bench_anim;
 
-    display_dirty = true;
+void benchClockFrame()
+{
+    ui_screen_show(&display, app.clockScreen());
+    app.updateClock(DEFAULT_DATETIME);
+    ui_render(&display, app.clockScreen());
 }
 
-void drawSetAlarm()
+void benchMenuFrame()
 {
-    // Draw title
-    ssd1309_draw_string(&display, 60, 0, 1, "Set Alarm");
-
-    // Draw hour and minute
-    char alarm_str[16];
-    snprintf(alarm_str, sizeof(alarm_str), "%02d:%02d", alarm_hour, alarm_minute);
-    ssd1309_draw_string(&display, 20, 24, 3, alarm_str);
-
-    // Draw selection indicator
-    if (edit_time_field == TIME_HOUR)
-    {
-        ssd1309_draw_square(&display, 20, 50, 33, 2);
-    }
-    else if (edit_time_field == TIME_MINUTE)
-    {
-        ssd1309_draw_square(&display, 75, 50, 33, 2);
-    }
-
-    display_dirty = true;
+    ui_screen_show(&display, app.menuScreen());
+    app.selectMenu(app.menuOption());
+    ui_render(&display, app.menuScreen());
 }
 
-void drawSetTime()
+void benchMenuStep()
 {
-    // TODO: SET DATE
-
-    // Draw title
-    ssd1309_draw_string(&display, 60, 0, 1, "Set Time");
-
-    // Draw hour and minute
-    char time_str[16];
-    snprintf(time_str, sizeof(time_str), "%02d:%02d", time_setting_hour, time_setting_minute);
-    ssd1309_draw_string(&display, 20, 24, 3, time_str);
-
-    // Draw selection indicator
-    if (edit_time_field == TIME_HOUR)
-    {
-        ssd1309_draw_square(&display, 20, 50, 33, 2);
-    }
-    else if (edit_time_field == TIME_MINUTE)
-    {
-        ssd1309_draw_square(&display, 75, 50, 33, 2);
-    }
-
-    display_dirty = true;
+    app.selectMenu((MenuOption)((app.menuOption() + 1) % MENU_COUNT));
+    ui_render(&display, app.menuScreen());
 }
 
-void drawVolumeIndicator()
+void benchBmpBlit()
 {
-    int bar_width = 40;
-    int bar_height = 5;
-    // Clear volume bar
-    ssd1309_clear_square(&display, 0, 0, bar_width, bar_height);
-    // Draw volume bar
-    ssd1309_draw_empty_square(&display, 0, 0, bar_width, bar_height);
-    // Fill volume bar
-    double fill_width = (double(bar_width) / double(30)) * double(current_volume);
-    fill_width = static_cast<int>(fill_width);
-    ssd1309_draw_square(&display, 1, 1, fill_width, bar_height - 1);
-
-    // Set timestamp for auto-hide
-    volume_bar_start_time = time_us_64();
-    volume_bar_visible = true;
-
-    display_dirty = true;
+    ssd1309_clear(&display);
+    ssd1309_bmp_show_image(&display, image_data, image_size);
 }
 
-void programAlarm(const DateTime &alarm_time)
+void benchImageBlit()
 {
-    rtc.disableAlarm(1);
-    rtc.clearAlarm(1);
-    rtc.setAlarm1(alarm_time, DS3231_A1_Hour);
-    alarm_enabled = true;
+    ssd1309_clear(&display);
+    ssd1309_draw_image(&display, &splash_image, 0, 0);
 }
 
-// void snoozeAlarm()
-// {
-//     DateTime current_time = rtc.now();
-//     DateTime snooze_time = current_time + TimeSpan(0, 0, 5, 0); // days, hours, minutes, seconds
-//     programAlarm(snooze_time);
-// }
-
-void resetActivity()
+void benchImageBlitOffset()
 {
-
-    last_activity_time = time_us_64();
-    powerUpPeripherals();
+    ssd1309_clear(&display);
+    ssd1309_draw_image(&display, &splash_image, 5, 3);
 }
 
-void handleAlarmFired()
+void benchAnimFrame()
 {
-    resetActivity();
-    current_state = STATE_ALARM_RINGING;
-    player.play(1);
-    rtc.clearAlarm(1);
+    ssd1309_anim_draw_frame(&display, &bench_anim, 0, 0);
 }
 
-void handleButtonUp()
+void benchRect8() { ssd1309_draw_square(&display, 3, 3, 8, 8); }
+void benchRect32() { ssd1309_draw_square(&display, 3, 3, 32, 16); }
+void benchRectFull() { ssd1309_draw_square(&display, 0, 0, DISP_WIDTH, DISP_HEIGHT); }
+void benchLineH() { ssd1309_draw_line(&display, 0, 10, DISP_WIDTH - 1, 10); }
+void benchLineV() { ssd1309_draw_line(&display, 10, 0, 10, DISP_HEIGHT - 1); }
+void benchLineDiag() { ssd1309_draw_line(&display, 0, 0, DISP_WIDTH - 1, DISP_HEIGHT - 1); }
+void benchEmptySquare() { ssd1309_draw_empty_square(&display, 0, 0, 40, 5); }
+
+/**
+ * @brief Time a drawing operation and the flush of its result
+ *
+ * Starts from a blank panel so the flush size reflects what the operation
+ * changed.
+ */
+void runBenchmark(const char *name, void (*draw)())
 {
-    // Debounce
-    static uint64_t last_handled_time = 0;
-    uint64_t now = time_us_64();
-    if (now - last_handled_time < BUTTON_DEBOUNCE_MS * 1000)
-    {
-        return;
-    }
-    last_handled_time = now;
+    ssd1309_clear(&display);
+    ssd1309_show(&display);
 
-    if (!display_on)
+    uint64_t start = time_us_64();
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
     {
-        // Only wake up, don't execute button action
-        resetActivity();
-        return;
+        draw();
     }
-    resetActivity();
+    uint64_t draw_ns = (time_us_64() - start) * 1000 / BENCHMARK_ITERATIONS;
 
-    switch (current_state)
-    {
-    case STATE_CLOCK:
-        if (current_volume < 30)
-        {
-            player.volumeUp();
-            current_volume++;
-        }
-        drawVolumeIndicator();
-        break;
+    start = time_us_64();
+    ssd1309_show_partial(&display);
+    uint64_t flush_us = time_us_64() - start;
 
-    case STATE_MENU:
-        // Move up in menu
-        current_menu_option = (MenuOption)((current_menu_option - 1 + MENU_COUNT) % MENU_COUNT);
-        ssd1309_clear(&display);
-        drawMenu();
-        break;
-
-    case STATE_SET_TIME:
-        // Increment current time setting field
-        if (edit_time_field == TIME_HOUR)
-        {
-            time_setting_hour = (time_setting_hour + 1 + 24) % 24;
-        }
-        else if (edit_time_field == TIME_MINUTE)
-        {
-            time_setting_minute = (time_setting_minute + 1 + 60) % 60;
-        }
-        ssd1309_clear(&display);
-        drawSetTime();
-        break;
-
-    case STATE_SET_ALARM:
-        // Increment current alarm setting field
-        if (edit_time_field == TIME_HOUR)
-        {
-            alarm_hour = (alarm_hour + 1 + 24) % 24;
-        }
-        else if (edit_time_field == TIME_MINUTE)
-        {
-            alarm_minute = (alarm_minute + 1 + 60) % 60;
-        }
-        ssd1309_clear(&display);
-        drawSetAlarm();
-        break;
-
-    case STATE_ALARM_RINGING:
-        // Stop alarm
-        player.stop();
-        rtc.clearAlarm(1);
-        current_state = STATE_CLOCK;
-        ssd1309_clear(&display);
-        current_time = rtc.now();
-        drawClock(current_time);
-        break;
-    }
+    printf("%-14s %8llu ns/op  flush %5llu us  %5u bytes  %2u cs  %2u xfers\n",
+           name, (unsigned long long)draw_ns, (unsigned long long)flush_us,
+           (unsigned)display.stats.bytes, (unsigned)display.stats.cs_toggles,
+           (unsigned)display.stats.transactions);
 }
 
-void handleButtonDown()
+/**
+ * @brief Print draw and flush cost of typical frames and primitives
+ */
+void runDisplayBenchmarks()
 {
-    // Debounce
-    static uint64_t last_handled_time = 0;
-    uint64_t now = time_us_64();
-    if (now - last_handled_time < BUTTON_DEBOUNCE_MS * 1000)
-    {
-        return;
-    }
-    last_handled_time = now;
+    printf("--- display benchmark (%d iterations) ---\n", BENCHMARK_ITERATIONS);
+    runBenchmark("clock frame", benchClockFrame);
+    runBenchmark("menu frame", benchMenuFrame);
+    runBenchmark("menu step", benchMenuStep);
+    runBenchmark("bmp blit", benchBmpBlit);
+    runBenchmark("image blit", benchImageBlit);
+    runBenchmark("image +5,+3", benchImageBlitOffset);
+    ssd1309_anim_init(&bench_anim, splash_anim);
+    runBenchmark("anim frame", benchAnimFrame);
+    printf("anim flash: %u bytes/frame\n", (unsigned)(sizeof(splash_anim) / bench_anim.frames));
+    runBenchmark("rect 8x8", benchRect8);
+    runBenchmark("rect 32x16", benchRect32);
+    runBenchmark("rect 128x64", benchRectFull);
+    runBenchmark("line h 128", benchLineH);
+    runBenchmark("line v 64", benchLineV);
+    runBenchmark("line diag", benchLineDiag);
+    runBenchmark("empty square", benchEmptySquare);
+
+    // Put back what the frames above changed and repaint the clock
+    app.selectMenu(MENU_SET_ALARM);
+    app.updateClock(clock_service.now());
+    ui_screen_show(&display, app.screen());
+}
 
-    if (!display_on)
+/**
+ * @brief Log the input latency whenever a new worst case comes up
+ */
+void reportLatency()
+{
+    static uint32_t last_worst_us = 0;
+    InputLatency latency = pipeline.latency();
+    if (latency.worst_us == last_worst_us)
     {
-        // Only wake up, don't execute button action
-        resetActivity();
         return;
     }
-    resetActivity();
-
-    switch (current_state)
-    {
-    case STATE_CLOCK:
-        if (current_volume > 0)
-        {
-            player.volumeDown();
-            current_volume--;
-        }
-        drawVolumeIndicator();
-        break;
-
-    case STATE_MENU:
-        // Move down in menu
-        current_menu_option = (MenuOption)((current_menu_option + 1 + MENU_COUNT) % MENU_COUNT);
-        ssd1309_clear(&display);
-        drawMenu();
-        break;
-
-    case STATE_SET_ALARM:
-        // Increment current alarm setting field
-        if (edit_time_field == TIME_HOUR)
-        {
-            alarm_hour = (alarm_hour - 1 + 24) % 24;
-        }
-        else if (edit_time_field == TIME_MINUTE)
-        {
-            alarm_minute = (alarm_minute - 1 + 60) % 60;
-        }
-        ssd1309_clear(&display);
-        drawSetAlarm();
-        break;
+    last_worst_us = latency.worst_us;
 
-    case STATE_SET_TIME:
-        // Increment current time setting field
-        if (edit_time_field == TIME_HOUR)
-        {
-            time_setting_hour = (time_setting_hour - 1 + 24) % 24;
-        }
-        else if (edit_time_field == TIME_MINUTE)
-        {
-            time_setting_minute = (time_setting_minute - 1 + 60) % 60;
-        }
-        ssd1309_clear(&display);
-        drawSetTime();
-        break;
-
-    case STATE_ALARM_RINGING:
-        // Snooze for 5 minutes
-        // snoozeAlarm(5);
-        break;
-    }
+    printf("Input latency: worst %lu us, mean %lu us over %lu inputs\n",
+           (unsigned long)latency.worst_us, (unsigned long)(latency.total_us / latency.count),
+           (unsigned long)latency.count);
 }
+#endif
 
-void handleButtonSelect()
+/**
+ * @brief Log the RTC bus counters whenever a transaction failed since the last report
+ */
+void reportRTCBus()
 {
-    // Debounce
-    static uint64_t last_handled_time = 0;
-    uint64_t now = time_us_64();
-    if (now - last_handled_time < BUTTON_DEBOUNCE_MS * 1000)
+    static uint32_t last_failures = 0;
+    I2CStats stats = rtc.busStats();
+    uint32_t failures = stats.naks + stats.timeouts + stats.errors;
+    if (failures == last_failures)
     {
         return;
     }
-    last_handled_time = now;
+    last_failures = failures;
 
-    if (!display_on)
-    {
-        // Only wake up, don't execute button action
-        resetActivity();
-        return;
-    }
-    resetActivity();
+    printf("RTC bus: %lu transactions, %lu NAKs, %lu timeouts, %lu errors, %lu retries\n",
+           (unsigned long)stats.transactions, (unsigned long)stats.naks,
+           (unsigned long)stats.timeouts, (unsigned long)stats.errors,
+           (unsigned long)stats.retries);
+}
 
-    switch (current_state)
+/**
+ * @brief Sleep until an interrupt arrives or wake_us (time since boot) passes
+ *
+ * Interrupts are masked while checking for work so one arriving in between
+ * still wakes the core. wake_us of 0 means no deadline.
+ */
+void sleepUntilEvent(uint64_t wake_us)
+{
+    if (wake_us)
     {
-    case STATE_CLOCK:
-        // Enter menu
-        current_state = STATE_MENU;
-        current_menu_option = MENU_SET_ALARM;
-        ssd1309_clear(&display);
-        drawMenu();
-        break;
-
-    case STATE_MENU:
-        // Execute menu item
-        switch (current_menu_option)
-        {
-        case MENU_SET_ALARM:
-            current_state = STATE_SET_ALARM;
-            edit_time_field = TIME_HOUR;
-            ssd1309_clear(&display);
-            drawSetAlarm();
-            break;
-
-        case MENU_SET_TIME:
-            current_time = rtc.now();
-            time_setting_hour = current_time.hour();
-            time_setting_minute = current_time.minute();
-            current_state = STATE_SET_TIME;
-            edit_time_field = TIME_HOUR;
-            ssd1309_clear(&display);
-            drawSetTime();
-            break;
-
-        case MENU_EXIT:
-            current_state = STATE_CLOCK;
-            ssd1309_clear(&display);
-            current_time = rtc.now();
-            drawClock(current_time);
-            break;
-
-        default:
-            break;
-        }
-        break;
-
-    case STATE_SET_ALARM:
-        if (edit_time_field == TIME_HOUR)
-        {
-            // Move to next field
-            edit_time_field = TIME_MINUTE;
-            ssd1309_clear(&display);
-            drawSetAlarm();
-        }
-        else if (edit_time_field == TIME_MINUTE)
-        {
-            // Save and exit
-            programAlarm(DateTime(2000, 1, 1, alarm_hour, alarm_minute, 0));
-            current_state = STATE_CLOCK;
-            current_time = rtc.now();
-            ssd1309_clear(&display);
-            drawClock(current_time);
-        }
-        break;
-
-    case STATE_SET_TIME:
-        if (edit_time_field == TIME_HOUR)
-        {
-            // Move to next field
-            edit_time_field = TIME_MINUTE;
-            ssd1309_clear(&display);
-            drawSetTime();
-        }
-        else if (edit_time_field == TIME_MINUTE)
+        if (events.empty())
         {
-            // Save and exit
-            rtc.adjust(DateTime(current_time.year(), current_time.month(), current_time.day(), time_setting_hour, time_setting_minute, 0));
-            current_state = STATE_CLOCK;
-            current_time = rtc.now();
-            ssd1309_clear(&display);
-            drawClock(current_time);
+            best_effort_wfe_or_timeout(from_us_since_boot(wake_us));
         }
-        break;
+        return;
+    }
 
-    case STATE_ALARM_RINGING:
-        // Stop alarm completely
-        player.stop();
-        rtc.clearAlarm(1);
-        current_state = STATE_CLOCK;
-        current_time = rtc.now();
-        ssd1309_clear(&display);
-        drawClock(current_time);
-        break;
+    uint32_t irq_state = save_and_disable_interrupts();
+    // A flush held back by a busy DMA transfer is retried once it completes
+    if (events.empty() && !pipeline.flushPending())
+    {
+        __wfi();
     }
+    restore_interrupts(irq_state);
 }
 
 int main()
@@ -703,6 +491,9 @@ int main()
     stdio_init_all();
     sleep_ms(5000); // Wait for USB to initialize
 
+    // Before anything can send display commands
+    pipeline.begin(&display, &app, DISPLAY_ON_CORE1);
+
     if (!initDisplay())
     {
         return -1;
@@ -717,103 +508,31 @@ int main()
     }
     initButtons();
     initInterrupts();
+    app.begin();
 
-    ssd1309_clear(&display);
-    ssd1309_show(&display);
+#ifdef DISPLAY_BENCHMARK
+    runDisplayBenchmarks();
+#endif
 
-    last_activity_time = time_us_64();
+#ifdef DISPLAY_MULTICORE
+    // Hand the display over to core 1
+    multicore_launch_core1(core1Main);
+#endif
 
     // --- Main Loop ---
     while (true)
     {
-        // Handle interrupts
-        if (rtc_interrupt_fired)
-        {
-            rtc_interrupt_fired = false;
-            handleAlarmFired();
-        }
-        if (button_up_pressed)
-        {
-            button_up_pressed = false;
-            handleButtonUp();
-        }
-        if (button_down_pressed)
-        {
-            button_down_pressed = false;
-            handleButtonDown();
-        }
-        if (button_select_pressed)
-        {
-            button_select_pressed = false;
-            handleButtonSelect();
-        }
-
-        // Handle clock state
-        static DateTime last_time = DEFAULT_DATETIME;
-        current_time = rtc.now();
-        if ((current_state == STATE_CLOCK || current_state == STATE_ALARM_RINGING) &&
-            current_time.minute() != last_time.minute())
-        {
-            last_time = current_time;
-            ssd1309_clear(&display);
-            drawClock(current_time);
-        }
-
-        // Handle alarm state
-        if (current_state == STATE_ALARM_RINGING)
-        {
-            // Flashing alarm indicator
-            static uint64_t last_flash = 0;
-            if (time_us_64() - last_flash > 500000) // 500ms
-            {
-                last_flash = time_us_64();
-                drawAlarmIndicator();
-            }
-
-            // Loop the alarm
-            if (player.available())
-            {
-                uint8_t type = player.readType();
-                uint16_t value = player.read();
-
-                if (type == DFPlayerPlayFinished)
-                {
-                    player.play(1);
-                }
-            }
-        }
-
-        // Volume bar timeout
-        if (volume_bar_visible &&
-            time_us_64() - volume_bar_start_time > VOLUME_BAR_TIMEOUT_S * 1000000ULL)
-        {
-            ssd1309_clear_square(&display, 0, 0, 41, 6);
-            volume_bar_visible = false;
-            display_dirty = true;
-        }
-
-        // Update display
-        if (display_dirty)
-        {
-            ssd1309_show(&display);
-            display_dirty = false;
-        }
-
-        // Sleep
-        if (current_state != STATE_ALARM_RINGING &&
-            display_on &&
-            time_us_64() - last_activity_time > (DISPLAY_TIMEOUT_S * 1000000ULL))
-        {
-            current_state = STATE_CLOCK;
-            // ssd1309_clear(&display);
-            // ssd1309_show(&display);
-            powerDownPeripherals();
-            __wfi();
-        }
-        // else
-        // {
-        //     sleep_ms(50);
-        // }
+        // Handle events posted by interrupts, then timeouts and animations
+        app.dispatch(events.take());
+        uint64_t wake_us = app.poll();
+#ifdef DISPLAY_BENCHMARK
+        reportLatency();
+#endif
+
+        // Core 1 renders the widgets while this core sleeps
+        pipeline.release();
+        sleepUntilEvent(wake_us);
+        pipeline.acquire();
     }
     return 0;
 }
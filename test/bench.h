@@ -0,0 +1,49 @@
+/**
+ * @file bench.h
+ *
+ * timing helper for the host benchmarks
+ *
+ * Host timings only compare implementations against each other; they do
+ * not predict the cycle counts on the RP2350. Every case runs in several
+ * rounds and the fastest round is reported, which keeps the numbers
+ * repeatable on a busy machine.
+ */
+
+#ifndef _inc_bench
+#define _inc_bench
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_ROUNDS 7
+#define BENCH_ITERATIONS 2000
+
+static inline uint64_t bench_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Time an operation
+ *
+ * @param op operation to run
+ * @param iterations calls per round
+ * @return nanoseconds per call in the fastest round
+ */
+static inline uint64_t bench_ns(void (*op)(void), int iterations)
+{
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        uint64_t start = bench_clock_ns();
+        for (int i = 0; i < iterations; i++)
+            op();
+        uint64_t ns = (bench_clock_ns() - start) / iterations;
+        if (ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file bench_anim.c
+ *
+ * decode time and flash cost per frame of the compressed animation format,
+ * against decoding a BMP per frame and blitting a pre-decoded image
+ *
+ * The animation is a block sliding over test_image.bmp, see
+ * tools/make_frames.py.
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test_anim.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+#define BMP_MAX 2048
+
+static ssd1309_t display;
+static ssd1309_anim_t anim;
+static uint8_t bmp[BMP_MAX];
+static long bmp_size;
+static ssd1309_image_t image;
+
+static void decode_anim(void)
+{
+    ssd1309_anim_draw_frame(&display, &anim, 0, 0);
+}
+
+static void decode_bmp(void)
+{
+    ssd1309_clear(&display);
+    ssd1309_bmp_show_image(&display, bmp, bmp_size);
+}
+
+static void blit_image(void)
+{
+    ssd1309_clear(&display);
+    ssd1309_draw_image(&display, &image, 0, 0);
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    if (!ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7))
+        return 1;
+
+    FILE *f = fopen(ANIM_FRAMES_DIR "/frame1.bmp", "rb");
+    if (!f)
+        return 1;
+    bmp_size = (long)fread(bmp, 1, sizeof(bmp), f);
+    fclose(f);
+    if (!ssd1309_image_from_bmp(&image, bmp, bmp_size))
+        return 1;
+
+    // Size of each encoded frame
+    ssd1309_anim_init(&anim, test_anim);
+    size_t key_bytes = 0, delta_min = SIZE_MAX, delta_max = 0;
+    for (int i = 0; i < anim.frames; i++)
+    {
+        const uint8_t *start = anim.next;
+        ssd1309_anim_draw_frame(&display, &anim, 0, 0);
+        size_t bytes = anim.next - start;
+        if (i == 0)
+            key_bytes = bytes;
+        else
+        {
+            delta_min = bytes < delta_min ? bytes : delta_min;
+            delta_max = bytes > delta_max ? bytes : delta_max;
+        }
+    }
+
+    printf("--- animation, %d frames of %dx%d (best of %d rounds of %d) ---\n", anim.frames, WIDTH, HEIGHT,
+           BENCH_ROUNDS, BENCH_ITERATIONS);
+    printf("%-16s %9s  %s\n", "format", "decode", "flash per frame");
+    // The rounds cycle through all frames, so this is the average over key and delta frames
+    ssd1309_anim_init(&anim, test_anim);
+    printf("%-16s %6llu ns  %zu bytes avg (keyframe %zu, deltas %zu-%zu)\n", "rle/xor anim",
+           (unsigned long long)bench_ns(decode_anim, BENCH_ITERATIONS), sizeof(test_anim) / anim.frames,
+           key_bytes, delta_min, delta_max);
+    printf("%-16s %6llu ns  %ld bytes\n", "bmp decode", (unsigned long long)bench_ns(decode_bmp, BENCH_ITERATIONS),
+           bmp_size);
+    printf("%-16s %6llu ns  %u bytes\n", "image blit", (unsigned long long)bench_ns(blit_image, BENCH_ITERATIONS),
+           (unsigned)(image.width * image.pages));
+
+    ssd1309_image_free(&image);
+    ssd1309_deinit(&display);
+    return 0;
+}
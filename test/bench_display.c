@@ -0,0 +1,180 @@
+/**
+ * @file bench_display.c
+ *
+ * drawing cost of typical frames and primitives, and the size of the flush
+ * that follows, on the host against the stub SPI bus
+ *
+ * The byte, transaction and CS counts are exact; the wire time is what
+ * those bytes take at the 10 MHz the firmware clocks the panel with. The
+ * flush is measured blocking and again through DMA, which sends the same
+ * windows with one transfer per row or full width band.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "splash_anim.h"
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test_image.h"
+#include "ui.h"
+
+#define DISP_CS_PIN 5
+#define DISP_DC_PIN 6
+#define DISP_RST_PIN 7
+#define DISP_WIDTH 128
+#define DISP_HEIGHT 64
+#define DISP_NS_PER_BYTE 800 // 10 MHz
+
+static ssd1309_t display;
+static ssd1309_image_t splash_image;
+static ssd1309_anim_t bench_anim;
+
+// Same layout as the clock and menu screens of the firmware
+static ui_widget_t clock_time, clock_date, clock_alarm;
+static ui_widget_t *const clock_widgets[] = {&clock_time, &clock_date, &clock_alarm};
+static const ui_screen_t clock_screen = {clock_widgets, 3};
+
+static const char *const menu_items[] = {"Set Alarm", "Set Time", "Exit"};
+static ui_widget_t menu_title, menu_list;
+static ui_widget_t *const menu_widgets[] = {&menu_title, &menu_list};
+static const ui_screen_t menu_screen = {menu_widgets, 2};
+static uint8_t menu_option;
+
+static void bench_clock_frame(void)
+{
+    ui_screen_show(&display, &clock_screen);
+    ui_digits_set(&clock_time, 7, 5);
+    ui_label_set(&clock_date, "Sat 3 Feb");
+    ui_label_set(&clock_alarm, "<> 06:45");
+    ui_render(&display, &clock_screen);
+}
+
+static void bench_menu_frame(void)
+{
+    ui_screen_show(&display, &menu_screen);
+    ui_menu_select(&menu_list, 0);
+    ui_render(&display, &menu_screen);
+}
+
+static void bench_menu_step(void)
+{
+    menu_option = (menu_option + 1) % 3;
+    ui_menu_select(&menu_list, menu_option);
+    ui_render(&display, &menu_screen);
+}
+
+static void bench_bmp_blit(void)
+{
+    ssd1309_clear(&display);
+    ssd1309_bmp_show_image(&display, image_data, image_size);
+}
+
+static void bench_image_blit(void)
+{
+    ssd1309_clear(&display);
+    ssd1309_draw_image(&display, &splash_image, 0, 0);
+}
+
+static void bench_image_blit_offset(void)
+{
+    ssd1309_clear(&display);
+    ssd1309_draw_image(&display, &splash_image, 5, 3);
+}
+
+static void bench_anim_frame(void)
+{
+    ssd1309_anim_draw_frame(&display, &bench_anim, 0, 0);
+}
+
+static void bench_text(void)
+{
+    ssd1309_clear_square(&display, 0, 0, DISP_WIDTH, 24);
+    ssd1309_draw_string(&display, 0, 0, 1, "Sat 3 Feb 2024");
+    ssd1309_draw_string(&display, 0, 8, 2, "07:05:00");
+}
+
+static void bench_rect8(void) { ssd1309_draw_square(&display, 3, 3, 8, 8); }
+static void bench_rect32(void) { ssd1309_draw_square(&display, 3, 3, 32, 16); }
+static void bench_rect_full(void) { ssd1309_draw_square(&display, 0, 0, DISP_WIDTH, DISP_HEIGHT); }
+static void bench_line_h(void) { ssd1309_draw_line(&display, 0, 10, DISP_WIDTH - 1, 10); }
+static void bench_line_v(void) { ssd1309_draw_line(&display, 10, 0, 10, DISP_HEIGHT - 1); }
+static void bench_line_diag(void) { ssd1309_draw_line(&display, 0, 0, DISP_WIDTH - 1, DISP_HEIGHT - 1); }
+static void bench_empty_square(void) { ssd1309_draw_empty_square(&display, 0, 0, 40, 5); }
+
+/**
+ * @brief Time a drawing operation and measure the flush of its result
+ *
+ * Starts from a blank panel so the flush size reflects what the operation
+ * changed.
+ */
+static void run(const char *name, void (*draw)(void))
+{
+    ssd1309_clear(&display);
+    ssd1309_show(&display);
+
+    uint64_t draw_ns = bench_ns(draw, BENCH_ITERATIONS);
+
+    // The same dirty regions go out once blocking and once by DMA
+    uint8_t dirty_x0[SSD1309_MAX_PAGES], dirty_x1[SSD1309_MAX_PAGES];
+    memcpy(dirty_x0, display.dirty_x0, sizeof(dirty_x0));
+    memcpy(dirty_x1, display.dirty_x1, sizeof(dirty_x1));
+
+    stub_spi_clear();
+    ssd1309_show_partial(&display);
+    ssd1309_stats_t partial = display.stats;
+    size_t partial_total = stub_spi.total;
+
+    memcpy(display.dirty_x0, dirty_x0, sizeof(dirty_x0));
+    memcpy(display.dirty_x1, dirty_x1, sizeof(dirty_x1));
+    stub_spi_clear();
+    ssd1309_show_async(&display, NULL, NULL);
+    ssd1309_wait(&display);
+
+    printf("%-14s %8llu ns/op  flush %5u bytes %2u cs %2u xfers %6u us wire  async %5u bytes %2u xfers\n",
+           name, (unsigned long long)draw_ns, (unsigned)partial.bytes,
+           (unsigned)partial.cs_toggles, (unsigned)partial.transactions,
+           (unsigned)(partial_total * DISP_NS_PER_BYTE / 1000),
+           (unsigned)display.stats.bytes, (unsigned)display.stats.transactions);
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(DISP_CS_PIN, DISP_DC_PIN, 0);
+    if (!ssd1309_init(&display, DISP_WIDTH, DISP_HEIGHT, spi0, DISP_CS_PIN, DISP_DC_PIN, DISP_RST_PIN))
+        return 1;
+    if (!ssd1309_image_from_bmp(&splash_image, image_data, image_size))
+        return 1;
+
+    ui_digits_init(&clock_time, 20, 24, 3);
+    ui_label_init(&clock_date, 20, 50, 16, 1);
+    ui_label_init(&clock_alarm, 80, 0, 8, 1);
+    ui_label_init(&menu_title, 50, 0, 4, 1);
+    ui_label_set(&menu_title, "MENU");
+    ui_menu_init(&menu_list, 5, 15, 80, menu_items, 3, 12);
+
+    printf("--- display benchmark (best of %d rounds of %d) ---\n", BENCH_ROUNDS, BENCH_ITERATIONS);
+    run("clock frame", bench_clock_frame);
+    run("menu frame", bench_menu_frame);
+    run("menu step", bench_menu_step);
+    run("text", bench_text);
+    run("bmp blit", bench_bmp_blit);
+    run("image blit", bench_image_blit);
+    run("image +5,+3", bench_image_blit_offset);
+    ssd1309_anim_init(&bench_anim, splash_anim);
+    run("anim frame", bench_anim_frame);
+    printf("anim flash: %u bytes/frame\n", (unsigned)(sizeof(splash_anim) / bench_anim.frames));
+    run("rect 8x8", bench_rect8);
+    run("rect 32x16", bench_rect32);
+    run("rect 128x64", bench_rect_full);
+    run("line h 128", bench_line_h);
+    run("line v 64", bench_line_v);
+    run("line diag", bench_line_diag);
+    run("empty square", bench_empty_square);
+
+    ssd1309_image_free(&splash_image);
+    ssd1309_deinit(&display);
+    return 0;
+}
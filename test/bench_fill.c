@@ -0,0 +1,70 @@
+/**
+ * @file bench_fill.c
+ *
+ * rectangle fill: the original per-pixel loop against the byte-wise page
+ * operations of ssd1309_draw_square()
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "reference.h"
+#include "ssd1309.h"
+#include "stubs.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+
+static ssd1309_t display;
+static ref_canvas_t canvas;
+
+typedef struct
+{
+    const char *name;
+    uint32_t x, y, w, h;
+} rect_case_t;
+
+static const rect_case_t cases[] = {
+    {"3x3 (font px)", 21, 25, 3, 3},
+    {"8x8 aligned", 8, 8, 8, 8},
+    {"8x8 unaligned", 3, 3, 8, 8},
+    {"32x16", 3, 3, 32, 16},
+    {"128x64", 0, 0, WIDTH, HEIGHT},
+};
+
+static const rect_case_t *current;
+
+static void per_pixel(void)
+{
+    ref_fill_rect(&canvas, current->x, current->y, current->w, current->h, true);
+}
+
+static void byte_wise(void)
+{
+    ssd1309_draw_square(&display, current->x, current->y, current->w, current->h);
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    if (!ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7))
+        return 1;
+    canvas.buffer = display.buffer;
+    canvas.width = WIDTH;
+    canvas.height = HEIGHT;
+
+    printf("--- rectangle fill (best of %d rounds of %d) ---\n", BENCH_ROUNDS, BENCH_ITERATIONS);
+    printf("%-14s %12s %12s %8s\n", "case", "per-pixel", "byte-wise", "speedup");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        current = &cases[i];
+        uint64_t slow = bench_ns(per_pixel, BENCH_ITERATIONS);
+        uint64_t fast = bench_ns(byte_wise, BENCH_ITERATIONS);
+        printf("%-14s %9llu ns %9llu ns %7.1fx\n", current->name, (unsigned long long)slow,
+               (unsigned long long)fast, fast ? (double)slow / fast : 0.0);
+    }
+
+    ssd1309_deinit(&display);
+    return 0;
+}
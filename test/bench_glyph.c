@@ -0,0 +1,93 @@
+/**
+ * @file bench_glyph.c
+ *
+ * scaled text: one square per font pixel, drawn per pixel as originally
+ * and byte-wise as the driver still does for glyphs too large to cache,
+ * against blitting cached pre-scaled glyphs
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "reference.h"
+#include "ssd1309.h"
+#include "ssd1309_fonts.h"
+#include "stubs.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+
+static ssd1309_t display;
+static ref_canvas_t canvas;
+
+typedef struct
+{
+    const char *name;
+    const char *text;
+    uint32_t x, y, scale;
+} text_case_t;
+
+static const text_case_t cases[] = {
+    {"HH:MM x3", "07:05", 20, 24, 3},
+    {"HH:MM x3 +1", "07:05", 20, 25, 3},
+    {"label x2", "Sat 3 Feb", 0, 8, 2},
+};
+
+static const text_case_t *current;
+
+static void per_pixel(void)
+{
+    uint32_t x = current->x;
+    for (const char *s = current->text; *s; s++)
+        x += ref_draw_glyph(&canvas, x, current->y, current->scale, &ssd1309_font_8x5, *s);
+}
+
+static void squares(void)
+{
+    const ssd1309_font_t *font = &ssd1309_font_8x5;
+    uint32_t scale = current->scale;
+    uint32_t x = current->x;
+
+    for (const char *s = current->text; *s; s++)
+    {
+        uint32_t index = (uint8_t)*s - font->first;
+        const uint8_t *src = font->data + font->offsets[index];
+        uint32_t width = font->widths[index];
+        for (uint32_t w = 0; w < width; ++w, src += font->pages)
+            for (uint32_t row = 0; row < font->pages * 8u; ++row)
+                if ((src[row >> 3] >> (row & 7)) & 1)
+                    ssd1309_draw_square(&display, x + w * scale, current->y + row * scale, scale, scale);
+        x += (width + font->spacing) * scale;
+    }
+}
+
+static void cached(void)
+{
+    ssd1309_draw_text(&display, current->x, current->y, current->scale, &ssd1309_font_8x5, current->text);
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    if (!ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7))
+        return 1;
+    canvas.buffer = display.buffer;
+    canvas.width = WIDTH;
+    canvas.height = HEIGHT;
+
+    printf("--- scaled text (best of %d rounds of %d) ---\n", BENCH_ROUNDS, BENCH_ITERATIONS);
+    printf("%-12s %12s %12s %12s %8s\n", "case", "per-pixel", "squares", "cached", "speedup");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        current = &cases[i];
+        uint64_t slow = bench_ns(per_pixel, BENCH_ITERATIONS);
+        uint64_t uncached = bench_ns(squares, BENCH_ITERATIONS);
+        uint64_t fast = bench_ns(cached, BENCH_ITERATIONS);
+        printf("%-12s %9llu ns %9llu ns %9llu ns %7.1fx\n", current->name, (unsigned long long)slow,
+               (unsigned long long)uncached, (unsigned long long)fast, fast ? (double)uncached / fast : 0.0);
+    }
+
+    ssd1309_deinit(&display);
+    return 0;
+}
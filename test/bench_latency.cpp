@@ -0,0 +1,138 @@
+/**
+ * @file bench_latency.cpp
+ *
+ * input latency of the display pipeline on one core and on two, for a
+ * scripted run of presses, some landing right after a tick or a screen
+ * change while that frame is still on the wire
+ *
+ * This is a host model, not a measurement on the RP2350: the clock only
+ * moves with SPI wire time at the 10 MHz the firmware clocks the panel
+ * with, and drawing takes no time. Latency runs from the press interrupt
+ * until the frame showing it starts flushing, as counted by the pipeline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fake_platform.h"
+#include "stubs.h"
+
+#define DISP_CS_PIN 5
+#define DISP_DC_PIN 6
+#define DISP_RST_PIN 7
+#define DISP_WIDTH 128
+#define DISP_NS_PER_BYTE 800 // 10 MHz
+
+/**
+ * @brief Platform that stamps inputs with the time of their interrupt
+ */
+class BenchPlatform : public FakePlatform
+{
+public:
+    uint32_t irq_us = 0; ///< Time the current event was raised
+
+    void noteInput() override
+    {
+        inputs++;
+        pipeline->noteInput(irq_us);
+    }
+};
+
+struct Step
+{
+    uint32_t after_us; ///< Since the previous step was raised
+    Event event;
+};
+
+static const Step script[] = {
+    {0, EVENT_TICK},
+    {100, EVENT_BUTTON_UP}, // Volume bar over the new time
+    {250000, EVENT_BUTTON_SELECT},
+    {200, EVENT_BUTTON_DOWN}, // Right after the menu replaced the clock
+    {250000, EVENT_BUTTON_DOWN},
+    {250000, EVENT_BUTTON_SELECT},
+    {300, EVENT_BUTTON_UP}, // Right after the clock came back
+    {1000000, EVENT_TICK},
+    {50, EVENT_BUTTON_DOWN},
+    {250000, EVENT_BUTTON_UP}, // Idle panel
+};
+
+static ssd1309_t display;
+static BenchPlatform *platform;
+static AlarmClock *app;
+static DisplayPipeline *pipeline;
+
+/**
+ * @brief One main loop iteration, then core 1 or the DMA interrupt
+ *
+ * Core 0 sleeps until the next event or, on one core, until the flush
+ * that held back a frame completes.
+ */
+static void loop(uint32_t events)
+{
+    platform->us = time_us_64();
+    app->dispatch(events);
+    app->poll();
+    pipeline->release();
+    stub_core_num = 1;
+    pipeline->runQueued();
+    stub_core_num = 0;
+    pipeline->acquire();
+
+    ssd1309_wait(&display);
+    if (pipeline->flushPending())
+        loop(0);
+}
+
+static void run(const char *name, bool multicore)
+{
+    stub_reset();
+    stub_spi_attach(DISP_CS_PIN, DISP_DC_PIN, 0);
+    stub_spi_ns_per_byte = DISP_NS_PER_BYTE;
+    if (!ssd1309_init(&display, DISP_WIDTH, SCREEN_HEIGHT, spi0, DISP_CS_PIN, DISP_DC_PIN, DISP_RST_PIN))
+        exit(1);
+
+    platform = new BenchPlatform();
+    app = new AlarmClock(*platform);
+    pipeline = new DisplayPipeline();
+    pipeline->begin(&display, app, multicore);
+    platform->pipeline = pipeline;
+    stub_advance_us(platform->us);
+    app->begin();
+    loop(0);
+
+    printf("%-10s", name);
+    uint64_t raised_us = time_us_64();
+    uint32_t served = 0;
+    for (const Step &step : script)
+    {
+        raised_us += step.after_us;
+        if (time_us_64() < raised_us)
+            stub_advance_us(raised_us - time_us_64());
+
+        platform->irq_us = (uint32_t)raised_us;
+        loop(eventBit(step.event));
+        if (pipeline->latency().count != served)
+        {
+            served = pipeline->latency().count;
+            printf(" %5u", (unsigned)pipeline->latency().last_us);
+        }
+    }
+
+    InputLatency latency = pipeline->latency();
+    printf("  | worst %5u us  mean %5u us  %u presses\n", (unsigned)latency.worst_us,
+           (unsigned)(latency.total_us / latency.count), (unsigned)latency.count);
+
+    delete pipeline;
+    delete app;
+    delete platform;
+    ssd1309_deinit(&display);
+}
+
+int main()
+{
+    printf("--- input latency, host model: SPI wire time only, us per press ---\n");
+    run("one core", false);
+    run("two cores", true);
+    return 0;
+}
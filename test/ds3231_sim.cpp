@@ -0,0 +1,112 @@
+// DS3231 register file behind the stub I2C controller, see ds3231_sim.h.
+
+#include <string.h>
+
+#include "ds3231_sim.h"
+
+#define STATUS_FLAGS 0x83 // OSF, A2F, A1F: cleared by writing 0
+#define STATUS_BSY 0x04
+
+ds3231_sim_t ds3231_sim;
+
+static bool addressed;
+
+void ds3231_sim_reset(ds3231_sim_t *sim)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->regs[3] = 1; // day of the week
+    sim->regs[4] = 1; // date
+    sim->regs[5] = 1; // month
+    sim->regs[DS3231_SIM_CONTROL] = 0x1C;
+    sim->regs[DS3231_SIM_STATUS] = 0x88;
+    sim->regs[0x11] = 25; // 25.00 degrees
+}
+
+void ds3231_sim_write(ds3231_sim_t *sim, uint8_t reg, uint8_t value)
+{
+    uint8_t old = sim->regs[reg];
+
+    switch (reg)
+    {
+    case DS3231_SIM_STATUS:
+        sim->regs[reg] = (old & value & STATUS_FLAGS) | (old & STATUS_BSY) | (value & ~(STATUS_FLAGS | STATUS_BSY));
+        break;
+    case 0x11:
+    case 0x12:
+        break;
+    default:
+        sim->regs[reg] = value;
+        break;
+    }
+}
+
+void ds3231_sim_clear_counts(ds3231_sim_t *sim)
+{
+    sim->transactions = 0;
+    memset(sim->reads, 0, sizeof(sim->reads));
+    memset(sim->writes, 0, sizeof(sim->writes));
+}
+
+static bool sim_start(uint8_t addr, bool read)
+{
+    if (addr != DS3231_SIM_ADDRESS)
+        return false;
+    if (ds3231_sim.nak_above && stub_i2c_baudrate > ds3231_sim.nak_above)
+        return false;
+    if (ds3231_sim.naks)
+    {
+        ds3231_sim.naks--;
+        return false;
+    }
+    addressed = true;
+    ds3231_sim.set_pointer = !read;
+    return true;
+}
+
+static bool sim_write(uint8_t byte)
+{
+    ds3231_sim_t *sim = &ds3231_sim;
+
+    if (sim->set_pointer)
+    {
+        sim->set_pointer = false;
+        // The pointer only holds a valid register, other values are NAKed
+        if (byte >= DS3231_SIM_REGISTERS)
+            return false;
+        sim->pointer = byte;
+        return true;
+    }
+
+    sim->writes[sim->pointer]++;
+    ds3231_sim_write(sim, sim->pointer, byte);
+    sim->pointer = (sim->pointer + 1) % DS3231_SIM_REGISTERS;
+    return true;
+}
+
+static uint8_t sim_read(void)
+{
+    ds3231_sim_t *sim = &ds3231_sim;
+    uint8_t byte = sim->regs[sim->pointer];
+
+    sim->reads[sim->pointer]++;
+    sim->pointer = (sim->pointer + 1) % DS3231_SIM_REGISTERS;
+    if (sim->corrupt_above && stub_i2c_baudrate > sim->corrupt_above)
+        byte ^= 0x10;
+    return byte;
+}
+
+static void sim_stop(void)
+{
+    if (addressed)
+        ds3231_sim.transactions++;
+    addressed = false;
+}
+
+const stub_i2c_target_t ds3231_sim_target = {sim_start, sim_write, sim_read, sim_stop};
+
+void ds3231_sim_attach(uint sda_pin, uint scl_pin)
+{
+    ds3231_sim_reset(&ds3231_sim);
+    addressed = false;
+    stub_i2c_attach(&ds3231_sim_target, sda_pin, scl_pin);
+}
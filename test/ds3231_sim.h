@@ -0,0 +1,62 @@
+/**
+ * @file ds3231_sim.h
+ *
+ * DS3231 register file on the simulated I2C bus
+ *
+ * The first byte of a write sets the register pointer, and further bytes
+ * are written or read from it with auto-increment, wrapping after the last
+ * register as on the chip. Writing STATUS follows the datasheet: OSF, A1F
+ * and A2F are only cleared by writing 0, and BSY is read-only, as are the
+ * temperature registers. The time does not tick on its own.
+ */
+
+#ifndef _inc_ds3231_sim
+#define _inc_ds3231_sim
+#include "stubs.h"
+
+#define DS3231_SIM_ADDRESS 0x68
+#define DS3231_SIM_REGISTERS 19
+#define DS3231_SIM_CONTROL 0x0E
+#define DS3231_SIM_STATUS 0x0F
+#define DS3231_SIM_AGING 0x10
+
+/**
+ * @brief State of the simulated chip
+ */
+typedef struct
+{
+    uint8_t regs[DS3231_SIM_REGISTERS]; /**< register file */
+    uint8_t pointer;                    /**< register pointer */
+    bool set_pointer;                   /**< next byte written sets the pointer */
+    uint32_t naks;                      /**< addressings left to NAK, as if the chip were busy */
+    uint32_t nak_above;                 /**< NAK every addressing while the bus runs faster, 0 for never */
+    uint32_t corrupt_above;             /**< flip a bit in every byte read while the bus runs faster, 0 for never */
+    uint32_t transactions;              /**< STOPs after the chip was addressed */
+    uint32_t reads[DS3231_SIM_REGISTERS];  /**< bytes read from each register */
+    uint32_t writes[DS3231_SIM_REGISTERS]; /**< bytes written to each register */
+} ds3231_sim_t;
+
+extern ds3231_sim_t ds3231_sim;
+extern const stub_i2c_target_t ds3231_sim_target;
+
+/**
+ * @brief Power-on state: 2000-01-01 00:00:00, CONTROL 0x1C, STATUS 0x88 (OSF and EN32kHz set)
+ */
+void ds3231_sim_reset(ds3231_sim_t *sim);
+
+/**
+ * @brief Reset ds3231_sim and connect it to the bus
+ */
+void ds3231_sim_attach(uint sda_pin, uint scl_pin);
+
+/**
+ * @brief Write a register with the chip's rules, as a transfer over the bus would
+ */
+void ds3231_sim_write(ds3231_sim_t *sim, uint8_t reg, uint8_t value);
+
+/**
+ * @brief Zero the transaction and access counters
+ */
+void ds3231_sim_clear_counts(ds3231_sim_t *sim);
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file fake_platform.h
+ *
+ * alarm clock platform for the host tests: time only moves when a test
+ * moves it, the date is fixed at 2024-02-03 07:05 plus that time, and every
+ * request to the hardware is counted. Given a display, it draws the
+ * screens the way the firmware does on a single core; given a pipeline,
+ * it hands the display commands and inputs to that instead.
+ */
+
+#ifndef _inc_fake_platform
+#define _inc_fake_platform
+#include <AlarmClock.h>
+#include <DisplayPipeline.h>
+
+#define US_PER_MS 1000ULL
+#define US_PER_S 1000000ULL
+
+/**
+ * @brief Platform that counts what the clock asks of the hardware
+ */
+class FakePlatform : public AlarmClockPlatform
+{
+public:
+    uint64_t us = 1 * US_PER_S;
+    uint32_t base = DateTime(2024, 2, 3, 7, 5, 0).unixtime(); ///< Time at us == 0
+    bool finished = false;                                      ///< Next playerFinished() result
+
+    int plays = 0, stops = 0, clears = 0, ups = 0, downs = 0, updates = 0, inputs = 0;
+    int programmed = 0, adjusted = 0;
+    DateTime alarm, adjusted_to;
+    int commands[DISPLAY_POWER + 1] = {};
+    uint8_t last_a[DISPLAY_POWER + 1] = {};
+    uint8_t last_b[DISPLAY_POWER + 1] = {};
+
+    ssd1309_t *display = nullptr;    ///< Screens are drawn here if set
+    const AlarmClock *app = nullptr; ///< Clock whose screens are drawn
+    DisplayPipeline *pipeline = nullptr; ///< Runs the display commands if set
+
+    uint64_t timeUs() override { return us; }
+    DateTime now() override { return DateTime(base + (uint32_t)(us / US_PER_S)); }
+    void updateTime() override { updates++; }
+    void adjustTime(const DateTime &dt) override
+    {
+        adjusted++;
+        adjusted_to = dt;
+    }
+    void programAlarm(const DateTime &dt) override
+    {
+        programmed++;
+        alarm = dt;
+    }
+    void clearAlarm() override { clears++; }
+    void playAlarm() override { plays++; }
+    void stopAlarm() override { stops++; }
+    void volumeUp() override { ups++; }
+    void volumeDown() override { downs++; }
+    bool playerFinished() override { return finished; }
+    void displayCommand(DisplayCommand cmd, uint8_t a, uint8_t b) override
+    {
+        commands[cmd]++;
+        last_a[cmd] = a;
+        last_b[cmd] = b;
+        if (pipeline)
+            pipeline->command(cmd, a, b);
+        if (!display)
+            return;
+        if (cmd == DISPLAY_SHOW_SCREEN)
+            ui_screen_show(display, app->screen());
+        else if (cmd == DISPLAY_RENDER)
+            ui_render(display, app->screen());
+    }
+    void noteInput() override
+    {
+        inputs++;
+        if (pipeline)
+            pipeline->noteInput(time_us_32());
+    }
+};
+
+#endif
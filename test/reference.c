@@ -0,0 +1,56 @@
+#include "reference.h"
+
+void ref_set_pixel(ref_canvas_t *c, uint32_t x, uint32_t y, bool on)
+{
+    if (x >= c->width || y >= c->height)
+        return;
+
+    if (on)
+        c->buffer[x + c->width * (y >> 3)] |= 0x1 << (y & 0x07);
+    else
+        c->buffer[x + c->width * (y >> 3)] &= ~(0x1 << (y & 0x07));
+}
+
+bool ref_get_pixel(const uint8_t *buffer, uint32_t width, uint32_t x, uint32_t y)
+{
+    return buffer[x + width * (y >> 3)] & (0x1 << (y & 0x07));
+}
+
+void ref_fill_rect(ref_canvas_t *c, uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool on)
+{
+    for (uint32_t i = 0; i < width; ++i)
+        for (uint32_t j = 0; j < height; ++j)
+            ref_set_pixel(c, x + i, y + j, on);
+}
+
+uint32_t ref_draw_glyph(ref_canvas_t *c, uint32_t x, uint32_t y, uint32_t scale, const ssd1309_font_t *font, char ch)
+{
+    uint8_t uc = (uint8_t)ch;
+    if (uc < font->first || uc > font->last)
+        return 0;
+
+    uint32_t index = uc - font->first;
+    const uint8_t *src = font->data + font->offsets[index];
+    uint32_t width = font->widths[index];
+
+    for (uint32_t w = 0; w < width; ++w, src += font->pages)
+        for (uint32_t row = 0; row < font->pages * 8u; ++row)
+            if ((src[row >> 3] >> (row & 7)) & 1)
+                ref_fill_rect(c, x + w * scale, y + row * scale, scale, scale, true);
+
+    return (width + font->spacing) * scale;
+}
+
+void ref_draw_char_with_font(ref_canvas_t *c, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, char ch)
+{
+    if (ch < font[3] || ch > font[4])
+        return;
+
+    uint32_t parts_per_line = (font[0] >> 3) + ((font[0] & 7) > 0);
+    const uint8_t *src = font + 5 + (ch - font[3]) * font[1] * parts_per_line;
+
+    for (uint32_t w = 0; w < font[1]; ++w, src += parts_per_line)
+        for (uint32_t row = 0; row < parts_per_line * 8u; ++row)
+            if ((src[row >> 3] >> (row & 7)) & 1)
+                ref_fill_rect(c, x + w * scale, y + row * scale, scale, scale, true);
+}
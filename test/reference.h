@@ -0,0 +1,45 @@
+/**
+ * @file reference.h
+ *
+ * straightforward per-pixel versions of the drawing primitives, used as
+ * the oracle in tests and as the baseline in benchmarks
+ *
+ * They draw into a bare page-ordered buffer with the display's layout:
+ * pixel (x, y) is bit y % 8 of byte x + width * (y / 8).
+ */
+
+#ifndef _inc_reference
+#define _inc_reference
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ssd1309.h"
+
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t width;
+    uint32_t height;
+} ref_canvas_t;
+
+void ref_set_pixel(ref_canvas_t *c, uint32_t x, uint32_t y, bool on);
+bool ref_get_pixel(const uint8_t *buffer, uint32_t width, uint32_t x, uint32_t y);
+
+/**
+ * @brief Fill or clear a rectangle one pixel at a time, like the original driver
+ */
+void ref_fill_rect(ref_canvas_t *c, uint32_t x, uint32_t y, uint32_t width, uint32_t height, bool on);
+
+/**
+ * @brief Draw a compiled font glyph as one scale x scale square per font pixel
+ *
+ * @return horizontal advance, like ssd1309_draw_glyph()
+ */
+uint32_t ref_draw_glyph(ref_canvas_t *c, uint32_t x, uint32_t y, uint32_t scale, const ssd1309_font_t *font, char ch);
+
+/**
+ * @brief Draw a glyph of a raw font header (font.h format) the same way
+ */
+void ref_draw_char_with_font(ref_canvas_t *c, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, char ch);
+
+#endif
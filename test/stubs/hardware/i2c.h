@@ -0,0 +1,87 @@
+/**
+ * @file i2c.h
+ *
+ * host stand-in for the I2C controller
+ *
+ * The registers the RTC library touches are objects whose reads and writes
+ * run the controller model in i2c.cpp, so the interrupt driven engine runs
+ * unchanged against a simulated target (see stub_i2c_attach()). C++ only,
+ * like its users.
+ */
+
+#ifndef _inc_stub_hardware_i2c
+#define _inc_stub_hardware_i2c
+#include <pico/stdlib.h>
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t *i2c0;
+extern i2c_inst_t *i2c1;
+
+enum stub_i2c_reg
+{
+    STUB_I2C_TAR,
+    STUB_I2C_DATA_CMD,
+    STUB_I2C_INTR_STAT,
+    STUB_I2C_INTR_MASK,
+    STUB_I2C_RAW_INTR_STAT,
+    STUB_I2C_CLR_TX_ABRT,
+    STUB_I2C_CLR_STOP_DET,
+    STUB_I2C_ENABLE,
+    STUB_I2C_TX_ABRT_SOURCE,
+};
+
+uint32_t stub_i2c_reg_read(i2c_inst_t *i2c, stub_i2c_reg reg);
+void stub_i2c_reg_write(i2c_inst_t *i2c, stub_i2c_reg reg, uint32_t value);
+
+/**
+ * @brief One controller register, accessed through the model
+ */
+struct stub_i2c_reg_t
+{
+    i2c_inst_t *i2c;
+    stub_i2c_reg reg;
+
+    operator uint32_t() const volatile { return stub_i2c_reg_read(i2c, reg); }
+    void operator=(uint32_t value) volatile { stub_i2c_reg_write(i2c, reg, value); }
+    void operator&=(uint32_t value) volatile { *this = *this & value; }
+    void operator|=(uint32_t value) volatile { *this = *this | value; }
+};
+
+typedef struct
+{
+    volatile stub_i2c_reg_t tar;
+    volatile stub_i2c_reg_t data_cmd;
+    volatile stub_i2c_reg_t intr_stat;
+    volatile stub_i2c_reg_t intr_mask;
+    volatile stub_i2c_reg_t raw_intr_stat;
+    volatile stub_i2c_reg_t clr_tx_abrt;
+    volatile stub_i2c_reg_t clr_stop_det;
+    volatile stub_i2c_reg_t enable;
+    volatile stub_i2c_reg_t tx_abrt_source;
+} i2c_hw_t;
+
+#define I2C_IC_INTR_MASK_M_RX_FULL_BITS 0x004u
+#define I2C_IC_INTR_MASK_M_TX_EMPTY_BITS 0x010u
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS 0x040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS 0x200u
+#define I2C_IC_INTR_STAT_R_RX_FULL_BITS 0x004u
+#define I2C_IC_INTR_STAT_R_TX_EMPTY_BITS 0x010u
+#define I2C_IC_INTR_STAT_R_TX_ABRT_BITS 0x040u
+#define I2C_IC_INTR_STAT_R_STOP_DET_BITS 0x200u
+#define I2C_IC_DATA_CMD_CMD_BITS 0x100u
+#define I2C_IC_DATA_CMD_STOP_BITS 0x200u
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x400u
+#define I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS 0x001u
+#define I2C_IC_TX_ABRT_SOURCE_ABRT_10ADDR1_NOACK_BITS 0x002u
+#define I2C_IC_TX_ABRT_SOURCE_ABRT_10ADDR2_NOACK_BITS 0x004u
+#define I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS 0x008u
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate);
+uint i2c_get_index(i2c_inst_t *i2c);
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c);
+size_t i2c_get_write_available(i2c_inst_t *i2c);
+size_t i2c_get_read_available(i2c_inst_t *i2c);
+
+#endif
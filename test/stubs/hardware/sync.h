@@ -0,0 +1,7 @@
+#ifndef _inc_stub_hardware_sync
+#define _inc_stub_hardware_sync
+#include <pico/stdlib.h>
+
+// save_and_disable_interrupts() and restore_interrupts() live in pico/stdlib.h
+
+#endif
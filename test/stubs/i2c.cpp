@@ -0,0 +1,278 @@
+// Controller model behind the hardware/i2c.h stub: commands pushed to
+// DATA_CMD run against the attached target at once, so the TX FIFO is
+// always empty and a transfer finishes as soon as its last command is in.
+// Like the real controller, an abort flushes the commands that follow until
+// TX_ABRT is cleared, and every transfer ends with a STOP.
+
+#include <string.h>
+
+#include <hardware/i2c.h>
+#include <hardware/irq.h>
+
+#include "stubs.h"
+
+#define STUB_I2C_FIFO_DEPTH 16
+
+typedef struct
+{
+    uint32_t tar;
+    uint32_t intr_mask;
+    uint32_t enable;
+    uint32_t abort_source;
+    bool in_transfer; ///< START sent, STOP not yet
+    bool aborted;
+    bool stop_det;
+    uint8_t rx[STUB_I2C_FIFO_DEPTH];
+    size_t rx_head;
+    size_t rx_len;
+} stub_i2c_controller_t;
+
+struct i2c_inst
+{
+    i2c_hw_t hw;
+    stub_i2c_controller_t c;
+};
+
+static i2c_inst stub_i2c_inst[2];
+i2c_inst_t *i2c0 = &stub_i2c_inst[0];
+i2c_inst_t *i2c1 = &stub_i2c_inst[1];
+
+uint32_t stub_i2c_baudrate;
+uint32_t stub_i2c_stuck_pulses;
+size_t stub_i2c_rx_max;
+
+static const stub_i2c_target_t *stub_i2c_target;
+static int stub_i2c_sda = -1;
+static int stub_i2c_scl = -1;
+static bool stub_i2c_scl_low;
+
+static uint32_t stub_i2c_raw_status(const stub_i2c_controller_t *c)
+{
+    return (c->rx_len ? I2C_IC_INTR_STAT_R_RX_FULL_BITS : 0) | I2C_IC_INTR_STAT_R_TX_EMPTY_BITS |
+           (c->aborted ? I2C_IC_INTR_STAT_R_TX_ABRT_BITS : 0) | (c->stop_det ? I2C_IC_INTR_STAT_R_STOP_DET_BITS : 0);
+}
+
+/**
+ * @brief Time of one byte and its acknowledge on the bus
+ */
+static void stub_i2c_clock_byte(void)
+{
+    if (stub_i2c_baudrate)
+        stub_advance_ns(9000000000ull / stub_i2c_baudrate);
+}
+
+static void stub_i2c_stop(stub_i2c_controller_t *c)
+{
+    c->in_transfer = false;
+    c->stop_det = true;
+    if (stub_i2c_target)
+        stub_i2c_target->stop();
+}
+
+static void stub_i2c_abort(stub_i2c_controller_t *c, uint32_t source)
+{
+    c->aborted = true;
+    c->abort_source = source;
+    stub_i2c_stop(c);
+}
+
+static void stub_i2c_command(stub_i2c_controller_t *c, uint32_t cmd)
+{
+    // Dropped while disabled, after an abort until it is cleared, and while a target holds the bus
+    if (!c->enable || c->aborted || stub_i2c_stuck_pulses)
+        return;
+
+    bool read = cmd & I2C_IC_DATA_CMD_CMD_BITS;
+    if (!c->in_transfer || (cmd & I2C_IC_DATA_CMD_RESTART_BITS))
+    {
+        c->in_transfer = true;
+        stub_i2c_clock_byte();
+        if (!stub_i2c_target || !stub_i2c_target->start((uint8_t)c->tar, read))
+        {
+            stub_i2c_abort(c, I2C_IC_TX_ABRT_SOURCE_ABRT_7B_ADDR_NOACK_BITS);
+            return;
+        }
+    }
+
+    stub_i2c_clock_byte();
+    if (read)
+    {
+        uint8_t byte = stub_i2c_target->read();
+        // A full FIFO drops the byte, which the depth record shows
+        size_t depth = c->rx_len + 1;
+        if (c->rx_len < STUB_I2C_FIFO_DEPTH)
+            c->rx[(c->rx_head + c->rx_len++) % STUB_I2C_FIFO_DEPTH] = byte;
+        if (depth > stub_i2c_rx_max)
+            stub_i2c_rx_max = depth;
+    }
+    else if (!stub_i2c_target->write((uint8_t)cmd))
+    {
+        stub_i2c_abort(c, I2C_IC_TX_ABRT_SOURCE_ABRT_TXDATA_NOACK_BITS);
+        return;
+    }
+
+    if (cmd & I2C_IC_DATA_CMD_STOP_BITS)
+        stub_i2c_stop(c);
+}
+
+uint32_t stub_i2c_reg_read(i2c_inst_t *i2c, stub_i2c_reg reg)
+{
+    stub_i2c_controller_t *c = &i2c->c;
+
+    switch (reg)
+    {
+    case STUB_I2C_TAR:
+        return c->tar;
+    case STUB_I2C_DATA_CMD:
+    {
+        if (!c->rx_len)
+            return 0;
+        uint8_t byte = c->rx[c->rx_head];
+        c->rx_head = (c->rx_head + 1) % STUB_I2C_FIFO_DEPTH;
+        c->rx_len--;
+        return byte;
+    }
+    case STUB_I2C_INTR_STAT:
+        return stub_i2c_raw_status(c) & c->intr_mask;
+    case STUB_I2C_INTR_MASK:
+        return c->intr_mask;
+    case STUB_I2C_RAW_INTR_STAT:
+        return stub_i2c_raw_status(c);
+    case STUB_I2C_CLR_TX_ABRT:
+        c->aborted = false;
+        c->abort_source = 0;
+        return 0;
+    case STUB_I2C_CLR_STOP_DET:
+        c->stop_det = false;
+        return 0;
+    case STUB_I2C_ENABLE:
+        return c->enable;
+    case STUB_I2C_TX_ABRT_SOURCE:
+        return c->abort_source;
+    }
+    return 0;
+}
+
+void stub_i2c_reg_write(i2c_inst_t *i2c, stub_i2c_reg reg, uint32_t value)
+{
+    stub_i2c_controller_t *c = &i2c->c;
+
+    switch (reg)
+    {
+    case STUB_I2C_TAR:
+        c->tar = value;
+        break;
+    case STUB_I2C_DATA_CMD:
+        stub_i2c_command(c, value);
+        break;
+    case STUB_I2C_INTR_MASK:
+        c->intr_mask = value;
+        break;
+    case STUB_I2C_ENABLE:
+        // Disabling flushes the FIFOs and clears the status
+        if (!value)
+        {
+            c->in_transfer = c->aborted = c->stop_det = false;
+            c->rx_len = 0;
+        }
+        c->enable = value;
+        break;
+    default:
+        break;
+    }
+
+    if (stub_i2c_raw_status(c) & c->intr_mask)
+        stub_irq_raise(i2c == i2c1 ? I2C1_IRQ : I2C0_IRQ);
+}
+
+/**
+ * @brief Count SCL pulses while stuck, and show the SDA level on the pin while it is an input
+ */
+static void stub_i2c_gpio_hook(uint gpio)
+{
+    if ((int)gpio == stub_i2c_scl)
+    {
+        bool low = stub_gpio_out[gpio];
+        if (low && !stub_i2c_scl_low && stub_i2c_stuck_pulses)
+            stub_i2c_stuck_pulses--;
+        stub_i2c_scl_low = low;
+    }
+    if (stub_i2c_sda >= 0 && !stub_gpio_out[stub_i2c_sda])
+        stub_gpio[stub_i2c_sda] = stub_i2c_stuck_pulses == 0;
+}
+
+void stub_i2c_attach(const stub_i2c_target_t *target, uint sda_pin, uint scl_pin)
+{
+    for (int i = 0; i < 2; ++i)
+        memset(&stub_i2c_inst[i].c, 0, sizeof(stub_i2c_inst[i].c));
+    stub_i2c_target = target;
+    stub_i2c_stuck_pulses = 0;
+    stub_i2c_rx_max = 0;
+    stub_i2c_sda = sda_pin;
+    stub_i2c_scl = scl_pin;
+    stub_i2c_scl_low = false;
+    stub_gpio_hook = stub_i2c_gpio_hook;
+    stub_gpio[sda_pin] = true;
+}
+
+void stub_i2c_poll(void)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        const stub_i2c_controller_t *c = &stub_i2c_inst[i].c;
+        if (stub_i2c_raw_status(c) & c->intr_mask)
+            stub_irq_raise(i ? I2C1_IRQ : I2C0_IRQ);
+    }
+}
+
+// ---------------------------------------------------------------- hardware_i2c
+
+static void stub_i2c_bind(volatile stub_i2c_reg_t &field, i2c_inst_t *i2c, stub_i2c_reg reg)
+{
+    field.i2c = i2c;
+    field.reg = reg;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    i2c->c.enable = 1;
+    return i2c_set_baudrate(i2c, baudrate);
+}
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate)
+{
+    (void)i2c;
+    stub_i2c_baudrate = baudrate;
+    return baudrate;
+}
+
+uint i2c_get_index(i2c_inst_t *i2c)
+{
+    return i2c == i2c1;
+}
+
+i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c)
+{
+    i2c_hw_t *hw = &i2c->hw;
+    stub_i2c_bind(hw->tar, i2c, STUB_I2C_TAR);
+    stub_i2c_bind(hw->data_cmd, i2c, STUB_I2C_DATA_CMD);
+    stub_i2c_bind(hw->intr_stat, i2c, STUB_I2C_INTR_STAT);
+    stub_i2c_bind(hw->intr_mask, i2c, STUB_I2C_INTR_MASK);
+    stub_i2c_bind(hw->raw_intr_stat, i2c, STUB_I2C_RAW_INTR_STAT);
+    stub_i2c_bind(hw->clr_tx_abrt, i2c, STUB_I2C_CLR_TX_ABRT);
+    stub_i2c_bind(hw->clr_stop_det, i2c, STUB_I2C_CLR_STOP_DET);
+    stub_i2c_bind(hw->enable, i2c, STUB_I2C_ENABLE);
+    stub_i2c_bind(hw->tx_abrt_source, i2c, STUB_I2C_TX_ABRT_SOURCE);
+    return hw;
+}
+
+size_t i2c_get_write_available(i2c_inst_t *i2c)
+{
+    (void)i2c;
+    return STUB_I2C_FIFO_DEPTH;
+}
+
+size_t i2c_get_read_available(i2c_inst_t *i2c)
+{
+    return i2c->c.rx_len;
+}
@@ -0,0 +1,3 @@
+#ifndef _inc_stub_pico_binary_info
+#define _inc_stub_pico_binary_info
+#endif
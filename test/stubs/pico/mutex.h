@@ -0,0 +1,26 @@
+#ifndef _inc_stub_pico_mutex
+#define _inc_stub_pico_mutex
+#include <pico/stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *	@brief non-recursive mutex owned by a core, as pico_sync's mutex
+ */
+typedef struct
+{
+	int8_t owner; /**< core holding it, -1 if free */
+} mutex_t;
+
+void mutex_init(mutex_t *mtx);
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out);
+void mutex_enter_blocking(mutex_t *mtx);
+void mutex_exit(mutex_t *mtx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _inc_stub_pico_util_queue
+#define _inc_stub_pico_util_queue
+#include <pico/stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *	@brief fixed-size FIFO of fixed-size elements, as pico_util's queue
+ */
+typedef struct
+{
+	uint8_t *data;	 /**< element_count + 1 slots */
+	uint element_size;
+	uint element_count;
+	uint rptr;
+	uint wptr;
+} queue_t;
+
+void queue_init(queue_t *q, uint element_size, uint element_count);
+void queue_free(queue_t *q);
+uint queue_get_level(queue_t *q);
+bool queue_is_empty(queue_t *q);
+bool queue_is_full(queue_t *q);
+bool queue_try_add(queue_t *q, const void *data);
+bool queue_try_remove(queue_t *q, void *data);
+void queue_add_blocking(queue_t *q, const void *data);
+void queue_remove_blocking(queue_t *q, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pico/stdlib.h>
+#include <pico/mutex.h>
+#include <pico/util/queue.h>
+#include <hardware/spi.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+
+#include "stubs.h"
+
+#define STUB_IRQ_HANDLERS 4 ///< shared handlers per interrupt
+
+struct spi_inst
+{
+    spi_hw_t hw;
+};
+
+typedef struct
+{
+    alarm_id_t id; /**< 0 if the slot is free */
+    uint64_t at_us;
+    alarm_callback_t callback;
+    void *user_data;
+} stub_alarm_t;
+
+typedef struct
+{
+    bool claimed;
+    bool irq0_enabled;
+    bool irq0_status;
+    const uint8_t *src; /**< transfer in flight, NULL if idle */
+    uint32_t count;
+    uint64_t start_ns;
+} stub_dma_channel_t;
+
+static struct spi_inst stub_spi_inst[2];
+spi_inst_t *spi0 = &stub_spi_inst[0];
+spi_inst_t *spi1 = &stub_spi_inst[1];
+
+stub_spi_bus_t stub_spi;
+bool stub_gpio[STUB_GPIO_COUNT];
+bool stub_gpio_out[STUB_GPIO_COUNT];
+void (*stub_gpio_hook)(uint gpio);
+uint32_t stub_spi_ns_per_byte;
+bool stub_dma_auto_complete = true;
+void (*stub_idle_hook)(void);
+uint stub_core_num;
+void (*stub_queue_full_hook)(queue_t *q);
+
+static int stub_cs_pin = -1;
+static int stub_dc_pin = -1;
+static uint64_t stub_time_ns;
+static stub_dma_channel_t stub_dma[NUM_DMA_CHANNELS];
+static irq_handler_t stub_irq_handlers[STUB_IRQ_COUNT][STUB_IRQ_HANDLERS];
+static bool stub_irq_enabled[STUB_IRQ_COUNT];
+static bool stub_irq_pending[STUB_IRQ_COUNT];
+static bool stub_irq_active[STUB_IRQ_COUNT];
+static bool stub_irqs_disabled;
+uint32_t stub_irq_entries[STUB_IRQ_COUNT];
+static stub_alarm_t stub_alarms[STUB_ALARM_COUNT];
+static alarm_id_t stub_alarm_next_id = 1;
+static bool stub_alarm_running;
+
+void stub_reset(void)
+{
+    stub_time_ns = 0;
+    memset(stub_gpio, 0, sizeof(stub_gpio));
+    memset(stub_gpio_out, 0, sizeof(stub_gpio_out));
+    stub_gpio_hook = NULL;
+    memset(stub_dma, 0, sizeof(stub_dma));
+    memset(stub_irq_pending, 0, sizeof(stub_irq_pending));
+    memset(stub_irq_entries, 0, sizeof(stub_irq_entries));
+    stub_irqs_disabled = false;
+    memset(stub_alarms, 0, sizeof(stub_alarms));
+    stub_alarm_next_id = 1;
+    stub_spi_ns_per_byte = 0;
+    stub_dma_auto_complete = true;
+    stub_idle_hook = NULL;
+    stub_core_num = 0;
+    stub_queue_full_hook = NULL;
+    stub_spi_attach(0, 0, 0);
+    stub_cs_pin = stub_dc_pin = -1;
+}
+
+void stub_spi_attach(uint cs_pin, uint dc_pin, size_t capacity)
+{
+    free(stub_spi.bytes);
+    free(stub_spi.dc);
+    memset(&stub_spi, 0, sizeof(stub_spi));
+    if (capacity)
+    {
+        stub_spi.bytes = malloc(capacity);
+        stub_spi.dc = malloc(capacity);
+        stub_spi.capacity = capacity;
+    }
+    stub_cs_pin = cs_pin;
+    stub_dc_pin = dc_pin;
+}
+
+void stub_spi_clear(void)
+{
+    stub_spi.len = 0;
+    stub_spi.total = 0;
+    stub_spi.unselected = 0;
+}
+
+static void stub_spi_put(const uint8_t *src, size_t len)
+{
+    bool selected = stub_cs_pin < 0 || !stub_gpio[stub_cs_pin];
+    bool dc = stub_dc_pin >= 0 && stub_gpio[stub_dc_pin];
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (stub_spi.len < stub_spi.capacity)
+        {
+            stub_spi.bytes[stub_spi.len] = src[i];
+            stub_spi.dc[stub_spi.len] = dc;
+            stub_spi.len++;
+        }
+    }
+    stub_spi.total += len;
+    if (!selected)
+        stub_spi.unselected += len;
+    stub_time_ns += (uint64_t)len * stub_spi_ns_per_byte;
+}
+
+void stub_advance_us(uint64_t us)
+{
+    stub_time_ns += us * 1000;
+}
+
+void stub_advance_ns(uint64_t ns)
+{
+    stub_time_ns += ns;
+}
+
+static void stub_irq_deliver(void)
+{
+    bool delivered = true;
+    while (delivered)
+    {
+        delivered = false;
+        for (uint num = 0; num < STUB_IRQ_COUNT && !stub_irqs_disabled; ++num)
+        {
+            // An interrupt raised by its own handler stays pending until the handler returns
+            if (!stub_irq_pending[num] || !stub_irq_enabled[num] || stub_irq_active[num])
+                continue;
+            stub_irq_pending[num] = false;
+            stub_irq_active[num] = true;
+            stub_irq_entries[num]++;
+            for (int i = 0; i < STUB_IRQ_HANDLERS; ++i)
+                if (stub_irq_handlers[num][i])
+                    stub_irq_handlers[num][i]();
+            stub_irq_active[num] = false;
+            delivered = true;
+        }
+    }
+}
+
+void stub_irq_raise(uint num)
+{
+    stub_irq_pending[num] = true;
+    stub_irq_deliver();
+}
+
+/**
+ * @brief Run the callbacks of due alarms, earliest first, like the timer interrupt
+ */
+static void stub_alarm_deliver(void)
+{
+    if (stub_irqs_disabled || stub_alarm_running)
+        return;
+
+    stub_alarm_running = true;
+    for (;;)
+    {
+        stub_alarm_t *due = NULL;
+        for (int i = 0; i < STUB_ALARM_COUNT; ++i)
+            if (stub_alarms[i].id && stub_alarms[i].at_us <= time_us_64() &&
+                (!due || stub_alarms[i].at_us < due->at_us))
+                due = &stub_alarms[i];
+        if (!due)
+            break;
+
+        alarm_id_t id = due->id;
+        int64_t reschedule = due->callback(id, due->user_data);
+        // The callback may have cancelled or reused the slot
+        if (due->id != id)
+            continue;
+        if (reschedule > 0)
+            due->at_us = time_us_64() + reschedule;
+        else if (reschedule < 0)
+            due->at_us -= reschedule;
+        else
+            due->id = 0;
+    }
+    stub_alarm_running = false;
+}
+
+bool stub_dma_busy(uint channel)
+{
+    return stub_dma[channel].src != NULL;
+}
+
+void stub_dma_complete(uint channel)
+{
+    stub_dma_channel_t *ch = &stub_dma[channel];
+    if (!ch->src)
+        return;
+
+    // The bytes went out while the transfer ran, not from now on
+    uint64_t end_ns = ch->start_ns + (uint64_t)ch->count * stub_spi_ns_per_byte;
+    if (end_ns < stub_time_ns)
+        end_ns = stub_time_ns;
+
+    const uint8_t *src = ch->src;
+    ch->src = NULL;
+    stub_spi_put(src, ch->count);
+    stub_time_ns = end_ns;
+    if (ch->irq0_enabled)
+    {
+        ch->irq0_status = true;
+        stub_irq_raise(DMA_IRQ_0);
+    }
+}
+
+// ---------------------------------------------------------------- pico_stdlib
+
+void gpio_init(uint gpio)
+{
+    stub_gpio[gpio] = false;
+    stub_gpio_out[gpio] = false;
+    if (stub_gpio_hook)
+        stub_gpio_hook(gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    stub_gpio_out[gpio] = out;
+    if (stub_gpio_hook)
+        stub_gpio_hook(gpio);
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    stub_gpio[gpio] = value;
+    if (stub_gpio_hook)
+        stub_gpio_hook(gpio);
+}
+
+bool gpio_get(uint gpio)
+{
+    return stub_gpio[gpio];
+}
+
+void gpio_set_function(uint gpio, int fn)
+{
+    (void)fn;
+    if (stub_gpio_hook)
+        stub_gpio_hook(gpio);
+}
+
+void gpio_pull_up(uint gpio)
+{
+    stub_gpio[gpio] = true;
+}
+
+uint64_t time_us_64(void)
+{
+    return stub_time_ns / 1000;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)time_us_64();
+}
+
+void sleep_us(uint64_t us)
+{
+    stub_advance_us(us);
+    stub_alarm_deliver();
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void busy_wait_us_32(uint32_t us)
+{
+    stub_advance_us(us);
+}
+
+void tight_loop_contents(void)
+{
+    stub_advance_us(1);
+    if (stub_irqs_disabled)
+        return;
+    if (stub_dma_auto_complete)
+        for (uint i = 0; i < NUM_DMA_CHANNELS; ++i)
+            if (stub_time_ns >= stub_dma[i].start_ns + (uint64_t)stub_dma[i].count * stub_spi_ns_per_byte)
+                stub_dma_complete(i);
+    if (stub_idle_hook)
+        stub_idle_hook();
+    stub_i2c_poll();
+    stub_irq_deliver();
+    stub_alarm_deliver();
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    (void)fire_if_past;
+    for (int i = 0; i < STUB_ALARM_COUNT; ++i)
+    {
+        if (!stub_alarms[i].id)
+        {
+            stub_alarm_t *a = &stub_alarms[i];
+            a->id = stub_alarm_next_id++;
+            a->at_us = time_us_64() + us;
+            a->callback = callback;
+            a->user_data = user_data;
+            return a->id;
+        }
+    }
+    return PICO_ERROR_GENERIC;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+    for (int i = 0; i < STUB_ALARM_COUNT; ++i)
+    {
+        if (alarm_id > 0 && stub_alarms[i].id == alarm_id)
+        {
+            stub_alarms[i].id = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint get_core_num(void)
+{
+    return stub_core_num;
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    uint32_t status = stub_irqs_disabled;
+    stub_irqs_disabled = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    stub_irqs_disabled = status;
+    stub_irq_deliver();
+}
+
+// ---------------------------------------------------------------- hardware_spi
+
+uint spi_init(spi_inst_t *spi, uint baudrate)
+{
+    (void)spi;
+    return baudrate;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+    (void)spi;
+    stub_spi_put(src, len);
+    return (int)len;
+}
+
+bool spi_is_busy(const spi_inst_t *spi)
+{
+    (void)spi;
+    return false;
+}
+
+spi_hw_t *spi_get_hw(spi_inst_t *spi)
+{
+    return &spi->hw;
+}
+
+uint spi_get_dreq(spi_inst_t *spi, bool is_tx)
+{
+    (void)is_tx;
+    return spi == spi0 ? 16 : 18;
+}
+
+// ---------------------------------------------------------------- hardware_dma
+
+int dma_claim_unused_channel(bool required)
+{
+    for (int i = 0; i < NUM_DMA_CHANNELS; ++i)
+    {
+        if (!stub_dma[i].claimed)
+        {
+            stub_dma[i].claimed = true;
+            return i;
+        }
+    }
+    if (required)
+        abort();
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    memset(&stub_dma[channel], 0, sizeof(stub_dma[channel]));
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    dma_channel_config c = {channel};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    (void)c;
+    (void)size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+    (void)c;
+    (void)dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger)
+{
+    (void)config;
+    (void)write_addr;
+    if (trigger)
+        dma_channel_transfer_from_buffer_now(channel, read_addr, transfer_count);
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count)
+{
+    stub_dma[channel].src = (const uint8_t *)read_addr;
+    stub_dma[channel].count = transfer_count;
+    stub_dma[channel].start_ns = stub_time_ns;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+    stub_dma[channel].irq0_enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(uint channel)
+{
+    return stub_dma[channel].irq0_status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    stub_dma[channel].irq0_status = false;
+}
+
+// ---------------------------------------------------------------- hardware_irq
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    memset(stub_irq_handlers[num], 0, sizeof(stub_irq_handlers[num]));
+    stub_irq_handlers[num][0] = handler;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    (void)order_priority;
+    for (int i = 0; i < STUB_IRQ_HANDLERS; ++i)
+    {
+        if (!stub_irq_handlers[num][i])
+        {
+            stub_irq_handlers[num][i] = handler;
+            return;
+        }
+    }
+    abort();
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    stub_irq_enabled[num] = enabled;
+}
+
+// ---------------------------------------------------------------- pico_util queue
+
+void queue_init(queue_t *q, uint element_size, uint element_count)
+{
+    q->data = calloc(element_count + 1, element_size);
+    q->element_size = element_size;
+    q->element_count = element_count;
+    q->rptr = q->wptr = 0;
+}
+
+void queue_free(queue_t *q)
+{
+    free(q->data);
+    q->data = NULL;
+}
+
+uint queue_get_level(queue_t *q)
+{
+    return (q->wptr + q->element_count + 1 - q->rptr) % (q->element_count + 1);
+}
+
+bool queue_is_empty(queue_t *q)
+{
+    return queue_get_level(q) == 0;
+}
+
+bool queue_is_full(queue_t *q)
+{
+    return queue_get_level(q) == q->element_count;
+}
+
+bool queue_try_add(queue_t *q, const void *data)
+{
+    if (queue_is_full(q))
+        return false;
+    memcpy(q->data + q->wptr * q->element_size, data, q->element_size);
+    q->wptr = (q->wptr + 1) % (q->element_count + 1);
+    return true;
+}
+
+bool queue_try_remove(queue_t *q, void *data)
+{
+    if (queue_is_empty(q))
+        return false;
+    memcpy(data, q->data + q->rptr * q->element_size, q->element_size);
+    q->rptr = (q->rptr + 1) % (q->element_count + 1);
+    return true;
+}
+
+void queue_add_blocking(queue_t *q, const void *data)
+{
+    if (queue_is_full(q) && stub_queue_full_hook)
+        stub_queue_full_hook(q);
+    if (!queue_try_add(q, data))
+    {
+        fprintf(stderr, "stub: queue_add_blocking() on a full queue that nothing drains\n");
+        exit(1);
+    }
+}
+
+void queue_remove_blocking(queue_t *q, void *data)
+{
+    if (!queue_try_remove(q, data))
+    {
+        fprintf(stderr, "stub: queue_remove_blocking() on an empty queue that nothing fills\n");
+        exit(1);
+    }
+}
+
+// ---------------------------------------------------------------- pico_sync mutex
+
+void mutex_init(mutex_t *mtx)
+{
+    mtx->owner = -1;
+}
+
+bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out)
+{
+    if (mtx->owner >= 0)
+    {
+        if (owner_out)
+            *owner_out = (uint32_t)mtx->owner;
+        return false;
+    }
+    mtx->owner = (int8_t)stub_core_num;
+    return true;
+}
+
+void mutex_enter_blocking(mutex_t *mtx)
+{
+    uint32_t owner;
+    if (!mutex_try_enter(mtx, &owner))
+    {
+        // Only the owner can release it, and the owner is not running
+        fprintf(stderr, "stub: deadlock, core %u waits for a mutex held by core %u\n",
+                stub_core_num, (unsigned)owner);
+        exit(1);
+    }
+}
+
+void mutex_exit(mutex_t *mtx)
+{
+    mtx->owner = -1;
+}
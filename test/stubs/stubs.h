@@ -0,0 +1,184 @@
+/**
+ * @file stubs.h
+ *
+ * hooks into the host stand-in of the Pico SDK
+ *
+ * The SPI stub records what reaches the panel, the DMA stub holds transfers
+ * until they are completed, either explicitly or the next time the code
+ * spins in tight_loop_contents(), and interrupts run synchronously when
+ * raised. Alarms fire from tight_loop_contents() and sleeps once due. The
+ * I2C controller talks to a target model attached with stub_i2c_attach().
+ *
+ * There is only one thread. Tests play the part of core 1 by setting
+ * stub_core_num while they run its code; a mutex wait that could only end
+ * by the other core running fails the test instead of hanging.
+ */
+
+#ifndef _inc_stubs
+#define _inc_stubs
+#include <pico/stdlib.h>
+#include <pico/util/queue.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STUB_GPIO_COUNT 48
+#define STUB_IRQ_COUNT 64
+#define STUB_ALARM_COUNT 16 ///< alarm slots, like the SDK's default pool
+
+/**
+ *	@brief bytes seen on the SPI bus since the last stub_spi_attach()
+ */
+typedef struct
+{
+	uint8_t *bytes;	   /**< captured bytes, NULL if only counting */
+	uint8_t *dc;	   /**< level of the DC pin for each captured byte */
+	size_t len;		   /**< bytes captured */
+	size_t capacity;   /**< size of bytes and dc */
+	size_t total;	   /**< bytes written, captured or not */
+	size_t unselected; /**< bytes written while CS was high */
+} stub_spi_bus_t;
+
+/**
+ *	@brief a target on the simulated I2C bus
+ */
+typedef struct
+{
+	bool (*start)(uint8_t addr, bool read); /**< addressed after a (repeated) START, false to NAK */
+	bool (*write)(uint8_t byte);			 /**< byte written by the controller, false to NAK */
+	uint8_t (*read)(void);					 /**< byte read by the controller */
+	void (*stop)(void);						 /**< STOP condition */
+} stub_i2c_target_t;
+
+extern stub_spi_bus_t stub_spi;
+extern bool stub_gpio[STUB_GPIO_COUNT];	   /**< pin levels, set by gpio_put() or a bus model */
+extern bool stub_gpio_out[STUB_GPIO_COUNT]; /**< pin directions, true for outputs */
+
+/**
+ *	@brief called after a pin changes direction, level or function
+ */
+extern void (*stub_gpio_hook)(uint gpio);
+
+/**
+ *	@brief wire time of one SPI byte added to the simulated clock, 0 by default
+ *
+ *	A DMA transfer takes the same time, counted from when it started: it
+ *	completes from tight_loop_contents() only once that much has passed.
+ */
+extern uint32_t stub_spi_ns_per_byte;
+
+/**
+ *	@brief complete DMA transfers from tight_loop_contents(), true by default
+ */
+extern bool stub_dma_auto_complete;
+
+/**
+ *	@brief called from tight_loop_contents() to let simulated peripherals progress
+ */
+extern void (*stub_idle_hook)(void);
+
+/**
+ *	@brief core the code is running on as far as get_core_num() and mutexes are concerned, 0 by default
+ */
+extern uint stub_core_num;
+
+/**
+ *	@brief called by queue_add_blocking() on a full queue, e.g. to run the consumer on the other core
+ *
+ *	Without a hook, or if it frees no space, the add fails the test.
+ */
+extern void (*stub_queue_full_hook)(queue_t *q);
+
+/**
+ *	@brief handler runs of each interrupt since stub_reset()
+ */
+extern uint32_t stub_irq_entries[STUB_IRQ_COUNT];
+
+/**
+ * @brief Reset the simulated clock, pins, bus log, DMA channels and core number
+ */
+void stub_reset(void);
+
+/**
+ * @brief Start recording the SPI bus, using the given pins to tag the bytes
+ *
+ * @param cs_pin chip select, active low
+ * @param dc_pin data/command select
+ * @param capacity bytes to capture, 0 to only count
+ */
+void stub_spi_attach(uint cs_pin, uint dc_pin, size_t capacity);
+
+/**
+ * @brief Forget the recorded bytes and counters
+ */
+void stub_spi_clear(void);
+
+/**
+ * @brief Advance the simulated clock
+ */
+void stub_advance_us(uint64_t us);
+void stub_advance_ns(uint64_t ns);
+
+/**
+ * @brief Check whether a DMA channel still has a transfer in flight
+ */
+bool stub_dma_busy(uint channel);
+
+/**
+ * @brief Finish the transfer of a DMA channel and raise its interrupt
+ *
+ * The source buffer is read at this point, like the real DMA which reads
+ * it while the transfer runs, so writes to it before completion show up
+ * on the bus.
+ */
+void stub_dma_complete(uint channel);
+
+/**
+ * @brief Run the handlers of an interrupt if it is enabled and interrupts are not disabled
+ *
+ * Raised again from its own handler, the interrupt runs once more after the
+ * handler returns rather than nesting.
+ */
+void stub_irq_raise(uint num);
+
+/**
+ *	@brief bus rate last set with i2c_init() or i2c_set_baudrate(), each byte on the bus advances the clock by 9 bit times
+ */
+extern uint32_t stub_i2c_baudrate;
+
+/**
+ *	@brief SCL pulses a stuck target needs before it releases SDA, 0 while the bus is free
+ *
+ *	While stuck, the controller makes no progress and SDA reads low.
+ */
+extern uint32_t stub_i2c_stuck_pulses;
+
+/**
+ *	@brief deepest the RX FIFO got since stub_i2c_attach(), one more than its depth if a byte was dropped
+ */
+extern size_t stub_i2c_rx_max;
+
+/**
+ * @brief Connect a target to the I2C bus, or NULL for an empty bus where every address NAKs
+ *
+ * @param target target model
+ * @param sda_pin pin that reads low while the bus is stuck
+ * @param scl_pin pin whose pulses free a stuck bus
+ */
+void stub_i2c_attach(const stub_i2c_target_t *target, uint sda_pin, uint scl_pin);
+
+/**
+ * @brief Raise the I2C interrupts again while a source is still asserted and unmasked
+ *
+ * The controller's interrupt is level triggered; called from
+ * tight_loop_contents(), so a source left unmasked with nothing to do
+ * keeps entering the handler as it would on the chip.
+ */
+void stub_i2c_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
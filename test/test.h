@@ -0,0 +1,36 @@
+/**
+ * @file test.h
+ *
+ * minimal checks for the host tests: a failed check prints its location
+ * and the test exits non-zero
+ */
+
+#ifndef _inc_test
+#define _inc_test
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(cond)                                                            \
+    do                                                                         \
+    {                                                                          \
+        if (!(cond))                                                           \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,  \
+                    #cond);                                                    \
+            exit(1);                                                           \
+        }                                                                      \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+    do                                                                         \
+    {                                                                          \
+        long long _a = (long long)(a), _b = (long long)(b);                    \
+        if (_a != _b)                                                          \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n",  \
+                    __FILE__, __LINE__, #a, #b, _a, _b);                       \
+            exit(1);                                                           \
+        }                                                                      \
+    } while (0)
+
+#endif
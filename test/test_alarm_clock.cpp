@@ -0,0 +1,419 @@
+/**
+ * @file test_alarm_clock.cpp
+ *
+ * alarm clock state machine on a fake platform, driven with synthetic
+ * events the way the main loop drives it: pending events survive a flood
+ * of button presses, repeated presses coalesce and debounce, and the menu,
+ * set alarm, set time and ringing flows reach the hardware they should,
+ * the display dims through the DIM_STAGES table while idle, and the clock
+ * face follows the burn-in schedule it is given.
+ */
+
+#include "fake_platform.h"
+#include "test.h"
+
+static FakePlatform *platform;
+static AlarmClock *app;
+static EventFlags events;
+
+static void setup()
+{
+    delete app;
+    delete platform;
+    platform = new FakePlatform();
+    app = new AlarmClock(*platform);
+    app->begin();
+    events.take();
+}
+
+/**
+ * @brief One main loop iteration
+ */
+static void loop()
+{
+    app->dispatch(events.take());
+    app->poll();
+}
+
+/**
+ * @brief Press a button after the debounce interval and run the loop
+ */
+static void press(Event button)
+{
+    platform->us += (BUTTON_DEBOUNCE_MS + 1) * US_PER_MS;
+    events.post(button);
+    loop();
+}
+
+static void test_flood()
+{
+    setup();
+
+    // Interrupts keep firing between two loop iterations
+    for (int i = 0; i < 100; i++)
+        events.post((Event)(EVENT_BUTTON_UP + i % 3));
+    events.post(EVENT_ALARM);
+    for (int i = 0; i < 100; i++)
+        events.post((Event)(EVENT_BUTTON_UP + i % 3));
+    events.post(EVENT_PLAYER_RX);
+    events.post(EVENT_TICK);
+
+    uint32_t pending = events.take();
+    CHECK_EQ(pending, (1u << EVENT_COUNT) - 1);
+    CHECK(events.empty());
+
+    // Every source is handled once, and the alarm after the presses
+    platform->finished = true;
+    app->dispatch(pending);
+    CHECK_EQ(app->state(), STATE_ALARM_RINGING);
+    CHECK_EQ(platform->ups, 1);
+    CHECK_EQ(platform->downs, 1);
+    CHECK_EQ(platform->updates, 1);
+    CHECK_EQ(platform->clears, 1);
+    CHECK_EQ(platform->plays, 2);
+    CHECK_EQ(platform->stops, 0);
+}
+
+static void test_dedupe()
+{
+    setup();
+
+    // Presses coalesce until the loop takes them
+    for (int i = 0; i < 5; i++)
+        events.post(EVENT_BUTTON_UP);
+    platform->us += (BUTTON_DEBOUNCE_MS + 1) * US_PER_MS;
+    loop();
+    CHECK_EQ(app->volume(), 16);
+    CHECK_EQ(platform->ups, 1);
+
+    // Bounces after a handled press are dropped
+    platform->us += (BUTTON_DEBOUNCE_MS - 1) * US_PER_MS;
+    events.post(EVENT_BUTTON_UP);
+    loop();
+    CHECK_EQ(platform->ups, 1);
+
+    // Each button debounces on its own
+    events.post(EVENT_BUTTON_DOWN);
+    loop();
+    CHECK_EQ(platform->downs, 1);
+
+    platform->us += 2 * US_PER_MS;
+    events.post(EVENT_BUTTON_UP);
+    loop();
+    CHECK_EQ(platform->ups, 2);
+    CHECK_EQ(app->volume(), 16);
+
+    // Volume stops at the ends of its range
+    for (int i = 0; i < MAX_VOLUME; i++)
+        press(EVENT_BUTTON_UP);
+    CHECK_EQ(app->volume(), MAX_VOLUME);
+    CHECK_EQ(platform->ups, 2 + MAX_VOLUME - 16);
+}
+
+static void test_set_alarm()
+{
+    setup();
+
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_MENU);
+    CHECK(app->screen() == app->menuScreen());
+    CHECK_EQ(platform->commands[DISPLAY_START_LINE], 1);
+
+    // The menu wraps both ways
+    press(EVENT_BUTTON_UP);
+    CHECK_EQ(app->menuOption(), MENU_EXIT);
+    press(EVENT_BUTTON_DOWN);
+    CHECK_EQ(app->menuOption(), MENU_SET_ALARM);
+
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_SET_ALARM);
+    CHECK_EQ(app->editField(), TIME_HOUR);
+    press(EVENT_BUTTON_UP);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->editField(), TIME_MINUTE);
+    press(EVENT_BUTTON_DOWN);
+    CHECK_EQ(platform->programmed, 0);
+
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+    CHECK(app->screen() == app->clockScreen());
+    CHECK_EQ(platform->programmed, 1);
+    CHECK_EQ(platform->alarm.hour(), 8);
+    CHECK_EQ(platform->alarm.minute(), 59);
+    CHECK(app->alarmEnabled());
+}
+
+static void test_set_time()
+{
+    setup();
+
+    press(EVENT_BUTTON_SELECT);
+    press(EVENT_BUTTON_DOWN);
+    CHECK_EQ(app->menuOption(), MENU_SET_TIME);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_SET_TIME);
+
+    // Starts from the current time, 07:05
+    press(EVENT_BUTTON_DOWN);
+    press(EVENT_BUTTON_SELECT);
+    press(EVENT_BUTTON_UP);
+    press(EVENT_BUTTON_UP);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+    CHECK_EQ(platform->adjusted, 1);
+    CHECK(platform->adjusted_to == DateTime(2024, 2, 3, 6, 7, 0));
+    CHECK_EQ(platform->programmed, 0);
+
+    // Exit leaves everything alone
+    press(EVENT_BUTTON_SELECT);
+    press(EVENT_BUTTON_UP);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+    CHECK_EQ(platform->adjusted, 1);
+}
+
+static void test_ringing()
+{
+    setup();
+
+    // Fires from the menu too, returning to the clock
+    press(EVENT_BUTTON_SELECT);
+    events.post(EVENT_ALARM);
+    loop();
+    CHECK_EQ(app->state(), STATE_ALARM_RINGING);
+    CHECK(app->screen() == app->clockScreen());
+    CHECK_EQ(platform->plays, 1);
+    CHECK_EQ(platform->clears, 1);
+
+    // The indicator flashes, and the loop asks to wake for it
+    uint64_t wake_us = app->poll();
+    CHECK(wake_us > platform->us && wake_us <= platform->us + ALARM_FLASH_MS * US_PER_MS);
+
+    // The sound loops while ringing, other player messages are ignored
+    events.post(EVENT_PLAYER_RX);
+    loop();
+    CHECK_EQ(platform->plays, 1);
+    platform->finished = true;
+    events.post(EVENT_PLAYER_RX);
+    loop();
+    CHECK_EQ(platform->plays, 2);
+
+    // Keeps ringing past the display timeout
+    platform->us += (DISPLAY_TIMEOUT_S + 1) * US_PER_S;
+    loop();
+    CHECK(app->displayOn());
+
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+    CHECK_EQ(platform->stops, 1);
+    CHECK_EQ(platform->clears, 2);
+    events.post(EVENT_PLAYER_RX);
+    loop();
+    CHECK_EQ(platform->plays, 2);
+}
+
+static void test_display_timeout()
+{
+    setup();
+
+    press(EVENT_BUTTON_SELECT);
+    platform->us += (DISPLAY_TIMEOUT_S + 1) * US_PER_S;
+    loop();
+    CHECK(!app->displayOn());
+    CHECK_EQ(app->state(), STATE_CLOCK);
+    CHECK(app->screen() == app->clockScreen());
+    CHECK_EQ(platform->commands[DISPLAY_POWER], 1);
+    CHECK_EQ(platform->last_a[DISPLAY_POWER], 0);
+
+    // The first press only wakes the display
+    int inputs = platform->inputs;
+    press(EVENT_BUTTON_UP);
+    CHECK(app->displayOn());
+    CHECK_EQ(platform->last_a[DISPLAY_POWER], 1);
+    CHECK_EQ(platform->ups, 0);
+    CHECK_EQ(platform->inputs, inputs + 1);
+    press(EVENT_BUTTON_UP);
+    CHECK_EQ(platform->ups, 1);
+}
+
+static void test_tick()
+{
+    setup();
+    app->restoreAlarm(6, 45);
+
+    // The tick resyncs the clock every time and redraws on a new minute
+    events.post(EVENT_TICK);
+    loop();
+    CHECK_EQ(platform->updates, 1);
+    platform->us += 60 * US_PER_S;
+    events.post(EVENT_TICK);
+    loop();
+    CHECK_EQ(platform->updates, 2);
+    CHECK(app->alarmEnabled());
+    CHECK_EQ(app->alarmHour(), 6);
+    CHECK_EQ(app->alarmMinute(), 45);
+}
+
+static void test_dim_table()
+{
+    // Full panel at first, each later stage waits longer and ends before power off
+    CHECK_EQ(DIM_STAGES[0].idle_s, 0);
+    CHECK_EQ(DIM_STAGES[0].row0, 0);
+    CHECK_EQ(DIM_STAGES[0].rows, SCREEN_HEIGHT);
+    for (size_t i = 1; i < DIM_STAGE_COUNT; i++)
+    {
+        CHECK(DIM_STAGES[i].idle_s > DIM_STAGES[i - 1].idle_s);
+        CHECK(DIM_STAGES[i].idle_s < DISPLAY_TIMEOUT_S);
+        CHECK(DIM_STAGES[i].row0 + DIM_STAGES[i].rows <= SCREEN_HEIGHT);
+    }
+
+    // Each stage starts exactly at its idle time
+    for (size_t i = 0; i < DIM_STAGE_COUNT; i++)
+    {
+        uint64_t start_us = DIM_STAGES[i].idle_s * US_PER_S;
+        CHECK_EQ(dimStageFor(start_us), i);
+        if (i > 0)
+            CHECK_EQ(dimStageFor(start_us - 1), i - 1);
+    }
+    CHECK_EQ(dimStageFor(UINT64_MAX), DIM_STAGE_COUNT - 1);
+}
+
+/**
+ * @brief Run the loop with the clock idle until the given time since the last press
+ */
+static void idle_until(uint64_t press_us, uint64_t idle_us)
+{
+    platform->us = press_us + idle_us;
+    loop();
+}
+
+static void test_dim_stages()
+{
+    setup();
+    press(EVENT_BUTTON_UP);
+    uint64_t press_us = platform->us;
+
+    // Stepped through in order while idle on the clock
+    for (size_t i = 1; i < DIM_STAGE_COUNT; i++)
+    {
+        idle_until(press_us, DIM_STAGES[i].idle_s * US_PER_S - 1);
+        CHECK_EQ(platform->commands[DISPLAY_CONTRAST], i - 1);
+
+        idle_until(press_us, DIM_STAGES[i].idle_s * US_PER_S);
+        CHECK_EQ(platform->commands[DISPLAY_CONTRAST], i);
+        CHECK_EQ(platform->last_a[DISPLAY_CONTRAST], DIM_STAGES[i].contrast);
+        CHECK_EQ(platform->last_a[DISPLAY_ACTIVE_ROWS], DIM_STAGES[i].row0);
+        CHECK_EQ(platform->last_b[DISPLAY_ACTIVE_ROWS], DIM_STAGES[i].rows);
+    }
+    CHECK(app->displayOn());
+
+    // Any press restores full brightness
+    press(EVENT_BUTTON_DOWN);
+    CHECK_EQ(platform->last_a[DISPLAY_CONTRAST], DIM_STAGES[0].contrast);
+    CHECK_EQ(platform->last_a[DISPLAY_ACTIVE_ROWS], 0);
+    CHECK_EQ(platform->last_b[DISPLAY_ACTIVE_ROWS], SCREEN_HEIGHT);
+    int contrast = platform->commands[DISPLAY_CONTRAST];
+
+    // Never on the other screens
+    press(EVENT_BUTTON_SELECT);
+    press_us = platform->us;
+    idle_until(press_us, (DISPLAY_TIMEOUT_S - 1) * US_PER_S);
+    CHECK_EQ(app->state(), STATE_MENU);
+    CHECK_EQ(platform->commands[DISPLAY_CONTRAST], contrast);
+
+    // Nor while ringing, however long it rings
+    events.post(EVENT_ALARM);
+    loop();
+    idle_until(press_us, 10 * DISPLAY_TIMEOUT_S * US_PER_S);
+    CHECK_EQ(platform->commands[DISPLAY_CONTRAST], contrast);
+
+    // Not sent again while the stage stays the same
+    press(EVENT_BUTTON_SELECT);
+    loop();
+    loop();
+    CHECK_EQ(platform->commands[DISPLAY_CONTRAST], contrast);
+}
+
+static void test_burn_in_schedule()
+{
+    static const uint8_t rows[] = {2, 0, 6};
+    const BurnInSchedule schedule = {rows, 3, 5};
+
+    // Each entry for a whole interval, repeating
+    for (uint64_t s = 0; s < 40; s++)
+    {
+        CHECK_EQ(burnInShiftAt(schedule, s * US_PER_S), rows[s / 5 % 3]);
+        CHECK_EQ(burnInShiftAt(schedule, s * US_PER_S + 999999), rows[s / 5 % 3]);
+    }
+    CHECK_EQ(burnInShiftAt(DEFAULT_BURN_IN_SCHEDULE, 0), BURN_IN_SHIFT_ROWS[0]);
+    CHECK_EQ(burnInShiftAt(DEFAULT_BURN_IN_SCHEDULE, BURN_IN_SHIFT_INTERVAL_S * US_PER_S), BURN_IN_SHIFT_ROWS[1]);
+
+    // An empty schedule never shifts
+    const BurnInSchedule still = {nullptr, 0, 0};
+    CHECK_EQ(burnInShiftAt(still, 12345 * US_PER_S), 0);
+
+    // The default stays within the blank rows of the clock face
+    for (size_t i = 0; i < DEFAULT_BURN_IN_SCHEDULE.count; i++)
+        CHECK(DEFAULT_BURN_IN_SCHEDULE.rows[i] <= BURN_IN_MAX_SHIFT);
+}
+
+static void test_burn_in()
+{
+    static const uint8_t rows[] = {3, 1};
+    static const uint8_t too_far[] = {1, BURN_IN_MAX_SHIFT + 1};
+    setup();
+
+    // Invalid schedules are refused
+    CHECK(!app->setBurnInSchedule({too_far, 2, 10}));
+    CHECK(!app->setBurnInSchedule({rows, 2, 0}));
+    CHECK(!app->setBurnInSchedule({nullptr, 2, 10}));
+    CHECK(app->setBurnInSchedule({rows, 2, 10}));
+
+    // Follows the schedule on the clock, one command per change
+    loop();
+    CHECK_EQ(platform->commands[DISPLAY_OFFSET], 1);
+    CHECK_EQ(platform->last_a[DISPLAY_OFFSET], 3);
+    platform->us = 9 * US_PER_S;
+    loop();
+    CHECK_EQ(platform->commands[DISPLAY_OFFSET], 1);
+    platform->us = 10 * US_PER_S;
+    loop();
+    CHECK_EQ(platform->commands[DISPLAY_OFFSET], 2);
+    CHECK_EQ(platform->last_a[DISPLAY_OFFSET], 1);
+
+    // Other screens are not shifted
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(platform->last_a[DISPLAY_OFFSET], 0);
+    press(EVENT_BUTTON_UP);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+    CHECK_EQ(platform->last_a[DISPLAY_OFFSET], burnInShiftAt({rows, 2, 10}, platform->us));
+
+    // An empty schedule puts the face back and keeps it there
+    CHECK(app->setBurnInSchedule({nullptr, 0, 0}));
+    loop();
+    CHECK_EQ(platform->last_a[DISPLAY_OFFSET], 0);
+    int commands = platform->commands[DISPLAY_OFFSET];
+    for (int i = 0; i < 10; i++)
+    {
+        platform->us += 10 * US_PER_S;
+        loop();
+    }
+    CHECK_EQ(platform->commands[DISPLAY_OFFSET], commands);
+}
+
+int main()
+{
+    test_flood();
+    test_dedupe();
+    test_set_alarm();
+    test_set_time();
+    test_ringing();
+    test_display_timeout();
+    test_tick();
+    test_dim_table();
+    test_dim_stages();
+    test_burn_in_schedule();
+    test_burn_in();
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file test_clock_service.cpp
+ *
+ * software clock against a fake RTC and a fake monotonic timer: phase lock
+ * at begin() without polling the RTC back to back, resync corrections, and failed RTC reads, which must never
+ * move the clock. Also checks that the real driver reports a read from an
+ * unresponsive bus as a failure instead of a decoded time.
+ */
+
+#include <ClockService.h>
+
+#include "stubs.h"
+#include "test.h"
+
+#define US_PER_S 1000000ULL
+
+static uint64_t fake_us;
+
+/**
+ * @brief Monotonic time that moves on a little with every call, like a real timer polled in a loop
+ */
+static uint64_t fakeMonotonic()
+{
+    fake_us += 50;
+    return fake_us;
+}
+
+/**
+ * @brief Sleep that moves the fake timer on
+ */
+static void fakeSleep(uint64_t us)
+{
+    fake_us += us;
+}
+
+/**
+ * @brief RTC whose seconds roll over at a given phase of the fake timer, optionally running fast
+ */
+class FakeRTC : public RTC_DS3231
+{
+public:
+    uint32_t base = DateTime(2024, 2, 3, 7, 5, 0).unixtime(); ///< Time at fake_us == 0, minus the phase
+    uint64_t phase_us = 0;                                      ///< RTC microseconds into base at fake_us == 0
+    int64_t ppm = 0;                                            ///< Rate error against the fake timer
+    int failures = 0;                                           ///< Reads left to fail, -1 for all
+    int reads = 0;
+
+    uint32_t seconds() const
+    {
+        uint64_t us = fake_us + (int64_t)fake_us * ppm / 1000000 + phase_us;
+        return base + (uint32_t)(us / US_PER_S);
+    }
+
+    bool read(DateTime &dt) override
+    {
+        reads++;
+        if (failures)
+        {
+            if (failures > 0)
+                failures--;
+            return false;
+        }
+        dt = DateTime(seconds());
+        return true;
+    }
+
+    void adjust(const DateTime &dt) override
+    {
+        base = dt.unixtime();
+        phase_us = 0;
+        ppm = 0;
+        fake_us = 0;
+    }
+};
+
+/**
+ * @brief Check the clock against the RTC just after each of the next seconds rolls over, and just before
+ */
+static void check_in_step(ClockService &clock, FakeRTC &rtc, int seconds)
+{
+    uint64_t boundary = US_PER_S - rtc.phase_us;
+    while (boundary < fake_us)
+        boundary += US_PER_S;
+
+    for (int i = 0; i < seconds; i++, boundary += US_PER_S)
+    {
+        fake_us = boundary + CLOCK_ROLLOVER_POLL_US;
+        CHECK_EQ(clock.now().unixtime(), rtc.seconds());
+        fake_us = boundary - CLOCK_ROLLOVER_POLL_US;
+        CHECK_EQ(clock.now().unixtime(), rtc.seconds());
+    }
+}
+
+static void test_begin_in_phase()
+{
+    fake_us = 0;
+    FakeRTC rtc;
+    rtc.phase_us = 700000;
+    ClockService clock(fakeMonotonic, fakeSleep);
+
+    CHECK(clock.begin(&rtc, 3600));
+    // Started on the rollover, not on the first reading, reading once per poll interval
+    CHECK(fake_us >= 300000 && fake_us < 300000 + CLOCK_ROLLOVER_POLL_US + 200);
+    CHECK(rtc.reads <= 300000 / CLOCK_ROLLOVER_POLL_US + 2);
+    check_in_step(clock, rtc, 10);
+}
+
+static void test_begin_retries_failed_reads()
+{
+    fake_us = 0;
+    FakeRTC rtc;
+    rtc.phase_us = 900000;
+    rtc.failures = 20;
+    ClockService clock(fakeMonotonic, fakeSleep);
+
+    CHECK(clock.begin(&rtc, 3600));
+    CHECK(rtc.reads > 20);
+    CHECK(rtc.reads <= (int)(2 * US_PER_S / CLOCK_ROLLOVER_POLL_US) + 1);
+    check_in_step(clock, rtc, 5);
+}
+
+static void test_begin_without_rtc()
+{
+    fake_us = 0;
+    FakeRTC rtc;
+    rtc.failures = -1;
+    ClockService clock(fakeMonotonic, fakeSleep);
+
+    CHECK(!clock.begin(&rtc, 3600));
+    CHECK(rtc.reads <= (int)(2 * US_PER_S / CLOCK_ROLLOVER_POLL_US) + 1);
+    // Counting from the default time, not from a decoded zero buffer
+    fake_us = 10 * US_PER_S;
+    CHECK(clock.now() == DateTime(2000, 1, 1, 0, 0, 10));
+
+    // Every update() tries again until a reading succeeds
+    int reads = rtc.reads;
+    clock.update();
+    clock.update();
+    CHECK_EQ(rtc.reads, reads + 2);
+    CHECK(clock.now().year() == 2000);
+
+    rtc.failures = 0;
+    clock.update();
+    CHECK(clock.now().unixtime() == rtc.seconds());
+    reads = rtc.reads;
+    clock.update();
+    CHECK_EQ(rtc.reads, reads);
+}
+
+static void test_resync()
+{
+    fake_us = 0;
+    FakeRTC rtc;
+    rtc.phase_us = 500000;
+    rtc.ppm = 20000; // 2% fast, 1.2 s ahead of the local clock after a minute
+    ClockService clock(fakeMonotonic, fakeSleep);
+    CHECK(clock.begin(&rtc, 60));
+
+    // No read before the interval
+    int reads = rtc.reads;
+    fake_us += 59 * US_PER_S;
+    clock.update();
+    CHECK_EQ(rtc.reads, reads);
+
+    fake_us += 2 * US_PER_S;
+    clock.update();
+    CHECK_EQ(rtc.reads, reads + 1);
+    CHECK_EQ(clock.now().unixtime(), rtc.seconds());
+    CHECK(clock.lastDrift() > 0);
+}
+
+static void test_failed_resync_keeps_time()
+{
+    fake_us = 0;
+    FakeRTC rtc;
+    rtc.phase_us = 500000;
+    ClockService clock(fakeMonotonic, fakeSleep);
+    CHECK(clock.begin(&rtc, 60));
+
+    // The RTC jumps ahead, but the read at the resync fails
+    fake_us += 61 * US_PER_S;
+    uint32_t local = clock.now().unixtime();
+    rtc.base += 100;
+    rtc.failures = 1;
+    int reads = rtc.reads;
+    clock.update();
+    CHECK_EQ(rtc.reads, reads + 1);
+    CHECK_EQ(clock.now().unixtime(), local);
+    CHECK_EQ(clock.lastDrift(), 0);
+
+    // Retried on the next update
+    clock.update();
+    CHECK_EQ(rtc.reads, reads + 2);
+    CHECK_EQ(clock.now().unixtime(), rtc.seconds());
+    CHECK(clock.lastDrift() > 0);
+}
+
+static void test_adjust()
+{
+    fake_us = 0;
+    FakeRTC rtc;
+    ClockService clock(fakeMonotonic, fakeSleep);
+    CHECK(clock.begin(&rtc, 60));
+
+    DateTime t(2031, 12, 31, 23, 59, 58);
+    clock.adjust(t);
+    CHECK(clock.now() == t);
+    fake_us += 3 * US_PER_S;
+    CHECK(clock.now() == DateTime(2032, 1, 1, 0, 0, 1));
+}
+
+static void test_unresponsive_bus()
+{
+    stub_reset();
+    stub_i2c_attach(nullptr, 26, 27);
+
+    RTC_DS3231 rtc;
+    CHECK(!rtc.begin(i2c1, 0x68, 26, 27));
+    CHECK(rtc.busStats().naks > 0);
+
+    DateTime dt(2024, 2, 3, 7, 5, 0);
+    CHECK(!rtc.read(dt));
+    CHECK(dt == DateTime(2024, 2, 3, 7, 5, 0));
+    CHECK(rtc.now() == DateTime());
+
+    // Gives up after its two seconds of retries
+    ClockService clock;
+    CHECK(!clock.begin(&rtc, 3600));
+    CHECK(time_us_64() >= 2 * US_PER_S && time_us_64() < 3 * US_PER_S);
+    CHECK(clock.now().year() == 2000);
+}
+
+int main()
+{
+    test_begin_in_phase();
+    test_begin_retries_failed_reads();
+    test_begin_without_rtc();
+    test_resync();
+    test_failed_resync_keeps_time();
+    test_adjust();
+    test_unresponsive_bus();
+    return 0;
+}
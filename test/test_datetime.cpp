@@ -0,0 +1,135 @@
+/**
+ * @file test_datetime.cpp
+ *
+ * closed-form date conversions against the loops they replaced, for every
+ * day from 2000-01-01 to 2099-12-31 and every second of the day
+ *
+ * Seconds since midnight and the day are split apart before the date is
+ * worked out, so checking every day at the ends of the day, plus every
+ * second of a few days, covers every second of the century without
+ * running all 3.2 billion of them.
+ */
+
+#include <RTClib.h>
+
+#include "test.h"
+
+#define DAYS_2000_TO_2100 36525
+
+/**
+ * @brief Date of a day since 2000-01-01 the way DateTime used to find it
+ */
+struct ReferenceDate
+{
+    uint8_t yOff, m, d;
+};
+
+static const uint8_t days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
+
+static ReferenceDate reference_date(uint16_t days)
+{
+    ReferenceDate date;
+    uint8_t leap;
+    for (date.yOff = 0;; ++date.yOff)
+    {
+        leap = date.yOff % 4 == 0;
+        if (days < 365U + leap)
+            break;
+        days -= 365 + leap;
+    }
+    for (date.m = 1; date.m < 12; ++date.m)
+    {
+        uint8_t days_per_month = days_in_month[date.m - 1];
+        if (leap && date.m == 2)
+            ++days_per_month;
+        if (days < days_per_month)
+            break;
+        days -= days_per_month;
+    }
+    date.d = days + 1;
+    return date;
+}
+
+static uint16_t reference_date2days(uint16_t y, uint8_t m, uint8_t d)
+{
+    if (y >= 2000U)
+        y -= 2000U;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i)
+        days += days_in_month[i - 1];
+    if (m > 2 && y % 4 == 0)
+        ++days;
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+static void check_time(const DateTime &dt, const ReferenceDate &date, uint32_t second_of_day)
+{
+    CHECK_EQ(dt.year(), 2000 + date.yOff);
+    CHECK_EQ(dt.month(), date.m);
+    CHECK_EQ(dt.day(), date.d);
+    CHECK_EQ(dt.hour(), second_of_day / 3600);
+    CHECK_EQ(dt.minute(), second_of_day / 60 % 60);
+    CHECK_EQ(dt.second(), second_of_day % 60);
+}
+
+static void test_every_day()
+{
+    ReferenceDate previous = {};
+
+    for (uint16_t days = 0; days < DAYS_2000_TO_2100; days++)
+    {
+        ReferenceDate date = reference_date(days);
+        uint32_t midnight = SECONDS_FROM_1970_TO_2000 + days * 86400U;
+        CHECK_EQ(reference_date2days(2000 + date.yOff, date.m, date.d), days);
+
+        // From epoch seconds, at both ends of the day
+        DateTime start(midnight);
+        DateTime end(midnight + 86399);
+        check_time(start, date, 0);
+        check_time(end, date, 86399);
+
+        // Back to epoch seconds, and the other conversions built on the day count
+        CHECK_EQ(start.unixtime(), midnight);
+        CHECK_EQ(end.unixtime(), midnight + 86399);
+        CHECK_EQ(start.secondstime(), days * 86400U);
+        CHECK_EQ(start.dayOfTheWeek(), (days + 6) % 7);
+
+        // From the date, with the full year and with the offset
+        CHECK_EQ(DateTime(2000 + date.yOff, date.m, date.d).unixtime(), midnight);
+        CHECK_EQ(DateTime(date.yOff, date.m, date.d, 23, 59, 59).unixtime(), midnight + 86399);
+
+        // Across midnight
+        if (days > 0)
+        {
+            CHECK(start - TimeSpan(1) == DateTime(2000 + previous.yOff, previous.m, previous.d, 23, 59, 59));
+            CHECK_EQ((start - DateTime(2000 + previous.yOff, previous.m, previous.d)).totalseconds(), 86400);
+        }
+        CHECK(end + TimeSpan(1) == DateTime(midnight + 86400));
+        previous = date;
+    }
+}
+
+static void test_every_second()
+{
+    // The first and last day, leap days, and a day in a common year
+    static const uint16_t days[] = {0, 59, 60, 424, 1520, 36218, DAYS_2000_TO_2100 - 1};
+
+    for (uint16_t day : days)
+    {
+        ReferenceDate date = reference_date(day);
+        uint32_t midnight = SECONDS_FROM_1970_TO_2000 + day * 86400U;
+        for (uint32_t second = 0; second < 86400; second++)
+        {
+            DateTime dt(midnight + second);
+            check_time(dt, date, second);
+            CHECK_EQ(dt.unixtime(), midnight + second);
+        }
+    }
+}
+
+int main()
+{
+    test_every_day();
+    test_every_second();
+    return 0;
+}
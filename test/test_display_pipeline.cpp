@@ -0,0 +1,185 @@
+/**
+ * @file test_display_pipeline.cpp
+ *
+ * display pipeline on one core and on two, with the test playing core 1:
+ * commands sent before core 1 serves the queue are kept in order, a full
+ * queue does not deadlock core 0 against a render waiting for the widgets,
+ * renders are dropped rather than waited for, and an input is counted as
+ * served once, when the frame showing it starts flushing, in counters
+ * either core can read.
+ */
+
+#include "fake_platform.h"
+#include "stubs.h"
+#include "test.h"
+
+#define WIDTH 128
+#define HEIGHT SCREEN_HEIGHT
+
+static ssd1309_t display;
+static FakePlatform *platform;
+static AlarmClock *app;
+static DisplayPipeline *pipeline;
+static int queue_full;
+
+static void setup(bool multicore)
+{
+    delete pipeline;
+    delete app;
+    delete platform;
+    stub_reset();
+    stub_spi_attach(5, 6, 1 << 16);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    // Like main(): the pipeline exists before the clock can send it anything
+    platform = new FakePlatform();
+    app = new AlarmClock(*platform);
+    pipeline = new DisplayPipeline();
+    pipeline->begin(&display, app, multicore);
+    platform->pipeline = pipeline;
+    app->begin();
+    queue_full = 0;
+    stub_queue_full_hook = NULL;
+    stub_spi_clear();
+}
+
+/**
+ * @brief Let core 1 run what core 0 has queued so far
+ */
+static void run_core1()
+{
+    stub_core_num = 1;
+    pipeline->runQueued();
+    stub_core_num = 0;
+}
+
+/**
+ * @brief One main loop iteration on core 0, then core 1 while it sleeps
+ */
+static void loop(uint32_t events)
+{
+    app->dispatch(events);
+    app->poll();
+    pipeline->release();
+    run_core1();
+    pipeline->acquire();
+}
+
+static void core1_drains(queue_t *q)
+{
+    (void)q;
+    queue_full++;
+    run_core1();
+}
+
+/**
+ * @brief Check that the panel got these start lines, in this order
+ */
+static void check_start_lines(uint8_t first, uint8_t count)
+{
+    uint8_t next = first;
+    for (size_t i = 0; i < stub_spi.len && next < first + count; i++)
+        if (!stub_spi.dc[i] && stub_spi.bytes[i] == (0x40 | next))
+            next++;
+    CHECK_EQ(next, first + count);
+}
+
+static void test_before_core1()
+{
+    setup(true);
+
+    // Everything begin() sent is still queued, nothing reached the panel
+    CHECK(!display.busy);
+    CHECK_EQ(stub_spi.total, 0);
+    for (uint8_t line = 1; line <= 8; line++)
+        pipeline->command(DISPLAY_START_LINE, line);
+
+    loop(0);
+    check_start_lines(1, 8);
+    CHECK(app->screen() == app->clockScreen());
+    CHECK(stub_spi.total > WIDTH * HEIGHT / 8);
+}
+
+static void test_full_queue()
+{
+    setup(true);
+    loop(0);
+
+    // Core 1 gets to the render first and needs the widgets core 0 holds
+    stub_queue_full_hook = core1_drains;
+    pipeline->command(DISPLAY_RENDER);
+    for (uint8_t line = 1; line <= DISPLAY_QUEUE_LENGTH + 4; line++)
+        pipeline->command(DISPLAY_START_LINE, line);
+    CHECK_EQ(queue_full, 1);
+
+    loop(0);
+    check_start_lines(1, DISPLAY_QUEUE_LENGTH + 4);
+}
+
+static void test_dropped_render()
+{
+    setup(true);
+    loop(0);
+
+    stub_queue_full_hook = core1_drains;
+    for (uint8_t line = 1; line <= DISPLAY_QUEUE_LENGTH; line++)
+        pipeline->command(DISPLAY_START_LINE, line);
+    pipeline->command(DISPLAY_RENDER);
+    CHECK_EQ(queue_full, 0);
+    loop(0);
+    check_start_lines(1, DISPLAY_QUEUE_LENGTH);
+}
+
+static void test_latency(bool multicore)
+{
+    setup(multicore);
+    loop(0);
+    CHECK_EQ(pipeline->latency().count, 0);
+
+    // On one core, a press waits for the frame before it, still on the wire
+    stub_dma_auto_complete = multicore;
+    stub_advance_us(1000);
+    platform->us += (BUTTON_DEBOUNCE_MS + 1) * US_PER_MS;
+    uint32_t press_us = time_us_32();
+    loop(eventBit(EVENT_BUTTON_UP));
+    CHECK_EQ(platform->inputs, 1);
+    if (!multicore)
+    {
+        CHECK(display.busy);
+        CHECK_EQ(pipeline->latency().count, 0);
+        CHECK(!pipeline->flushPending());
+        stub_advance_us(1000);
+        stub_dma_complete(display.dma_chan);
+        CHECK(pipeline->flushPending());
+        loop(0);
+    }
+
+    InputLatency latency = pipeline->latency();
+    CHECK_EQ(latency.count, 1);
+    CHECK_EQ(latency.last_us, time_us_32() - press_us);
+    CHECK_EQ(latency.worst_us, latency.last_us);
+    CHECK_EQ(latency.total_us, latency.last_us);
+    if (!multicore)
+        CHECK(latency.last_us >= 1000);
+
+    // Served once, not again on later frames
+    loop(0);
+    loop(0);
+    CHECK_EQ(pipeline->latency().count, 1);
+
+    // Readable from core 1, and from core 0 while it holds the widgets
+    stub_core_num = 1;
+    CHECK_EQ(pipeline->latency().count, 1);
+    stub_core_num = 0;
+    CHECK_EQ(pipeline->latency().total_us, latency.total_us);
+}
+
+int main()
+{
+    test_before_core1();
+    test_full_queue();
+    test_dropped_render();
+    test_latency(false);
+    test_latency(true);
+    return 0;
+}
@@ -0,0 +1,277 @@
+/**
+ * @file test_i2c_engine.cpp
+ *
+ * interrupt driven I2C engine against the simulated DS3231: queued requests
+ * complete in order while the caller carries on, a long read takes one
+ * interrupt per FIFO's worth, failures are reported and counted, a hung
+ * bus times out and is clocked free, and a request that cannot get a
+ * timeout alarm fails instead of waiting forever.
+ */
+
+#include <I2CEngine.h>
+#include <hardware/irq.h>
+
+#include "ds3231_sim.h"
+#include "test.h"
+
+#define SDA_PIN 26
+#define SCL_PIN 27
+
+static I2CEngine engine;
+static int completed;
+static int results[4];
+
+static void on_done(I2CRequest *req)
+{
+    results[completed++] = req->result;
+}
+
+static void setup()
+{
+    stub_reset();
+    ds3231_sim_attach(SDA_PIN, SCL_PIN);
+    for (int i = 0; i < DS3231_SIM_REGISTERS; i++)
+        ds3231_sim.regs[i] = i + 1;
+    i2c_init(i2c1, 100000);
+    CHECK(engine.begin(i2c1, SDA_PIN, SCL_PIN));
+    completed = 0;
+}
+
+static void read_request(I2CRequest &req, uint8_t reg, uint8_t *buffer, uint8_t len)
+{
+    req = {};
+    req.addr = DS3231_SIM_ADDRESS;
+    req.tx[0] = reg;
+    req.tx_len = 1;
+    req.rx = buffer;
+    req.rx_len = len;
+    req.timeout_us = I2C_DEFAULT_TIMEOUT_US;
+    req.callback = on_done;
+}
+
+/**
+ * @brief Alarms that can still be added, freeing them again
+ */
+static int free_alarms()
+{
+    alarm_id_t ids[STUB_ALARM_COUNT];
+    int n = 0;
+    while (n < STUB_ALARM_COUNT && (ids[n] = add_alarm_in_us(1000000000, nullptr, nullptr, true)) > 0)
+        n++;
+    for (int i = 0; i < n; i++)
+        cancel_alarm(ids[i]);
+    return n;
+}
+
+static void test_transfer()
+{
+    setup();
+
+    uint8_t write[3] = {0x07, 0x30, 0x45};
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, write, 3, nullptr, 0), 3);
+    CHECK_EQ(ds3231_sim.regs[7], 0x30);
+    CHECK_EQ(ds3231_sim.regs[8], 0x45);
+
+    // Longer than the RX FIFO
+    uint8_t reg = 0;
+    uint8_t all[DS3231_SIM_REGISTERS];
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, all, sizeof(all)), (int)sizeof(all));
+    for (int i = 0; i < DS3231_SIM_REGISTERS; i++)
+        CHECK_EQ(all[i], ds3231_sim.regs[i]);
+    CHECK(stub_i2c_rx_max <= 16);
+    CHECK_EQ(ds3231_sim.transactions, 2);
+
+    // 10 bytes at 100 kHz take 900 us on the bus
+    uint64_t start = time_us_64();
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, all, 7), 7);
+    CHECK(time_us_64() - start >= 900 && time_us_64() - start < 1000);
+
+    I2CStats stats = engine.stats();
+    CHECK_EQ(stats.transactions, 3);
+    CHECK_EQ(stats.naks + stats.timeouts + stats.errors + stats.retries, 0);
+    CHECK_EQ(free_alarms(), STUB_ALARM_COUNT);
+}
+
+static void test_async_queue()
+{
+    setup();
+
+    uint8_t time[7], temp[2], all[DS3231_SIM_REGISTERS];
+    I2CRequest r1, r2, r3;
+    read_request(r1, 0x00, time, sizeof(time));
+    read_request(r2, 0x11, temp, sizeof(temp));
+    read_request(r3, 0x00, all, sizeof(all));
+
+    // Queued behind the active one, which only completes from the interrupt
+    uint32_t save = save_and_disable_interrupts();
+    CHECK(engine.submit(&r1));
+    CHECK(engine.submit(&r2));
+    CHECK(engine.submit(&r3));
+    CHECK(!r1.done && !r2.done && !r3.done);
+    CHECK(engine.busy());
+    CHECK_EQ(completed, 0);
+    restore_interrupts(save);
+
+    while (!r3.done)
+        tight_loop_contents();
+    CHECK(!engine.busy());
+    CHECK_EQ(completed, 3);
+    CHECK_EQ(results[0], 7);
+    CHECK_EQ(results[1], 2);
+    CHECK_EQ(results[2], DS3231_SIM_REGISTERS);
+    CHECK_EQ(time[6], 7);
+    CHECK_EQ(temp[0], 0x12);
+    CHECK_EQ(all[0x0e], 0x0f);
+    CHECK_EQ(free_alarms(), STUB_ALARM_COUNT);
+}
+
+static void test_irq_entries()
+{
+    setup();
+
+    // Several RX FIFOs' worth, the pointer wraps around the registers
+    static uint8_t buffer[200];
+    I2CRequest req;
+    read_request(req, 0x00, buffer, sizeof(buffer));
+    CHECK(engine.submit(&req));
+    while (!req.done)
+        tight_loop_contents();
+    CHECK_EQ(req.result, (int)sizeof(buffer));
+    for (size_t i = 0; i < sizeof(buffer); i++)
+        CHECK_EQ(buffer[i], ds3231_sim.regs[i % DS3231_SIM_REGISTERS]);
+    CHECK(stub_i2c_rx_max <= 16);
+
+    // Every entry moves a FIFO's worth; TX_EMPTY stays masked while the
+    // reads wait for the RX FIFO instead of firing for nothing
+    CHECK(stub_irq_entries[I2C1_IRQ] <= (sizeof(buffer) + 15) / 16 + 2);
+}
+
+static void test_queue_full()
+{
+    setup();
+
+    I2CRequest req[I2C_QUEUE_LENGTH + 2];
+    uint8_t buffer[I2C_QUEUE_LENGTH + 2];
+    int queued = 0;
+    uint32_t save = save_and_disable_interrupts();
+    for (int i = 0; i < I2C_QUEUE_LENGTH + 2; i++)
+    {
+        read_request(req[i], 4, &buffer[i], 1);
+        req[i].callback = nullptr;
+        queued += engine.submit(&req[i]);
+    }
+    restore_interrupts(save);
+
+    // The active request plus a full queue
+    CHECK_EQ(queued, 1 + I2C_QUEUE_LENGTH);
+    while (!req[I2C_QUEUE_LENGTH].done)
+        tight_loop_contents();
+    for (int i = 0; i <= I2C_QUEUE_LENGTH; i++)
+    {
+        CHECK_EQ(req[i].result, 1);
+        CHECK_EQ(buffer[i], 5);
+    }
+    CHECK(!req[I2C_QUEUE_LENGTH + 1].done);
+}
+
+static void test_nak()
+{
+    setup();
+    uint8_t reg = 0, byte;
+
+    // Empty address
+    CHECK_EQ(engine.transfer(0x50, &reg, 1, &byte, 1), PICO_ERROR_GENERIC);
+    CHECK_EQ(engine.stats().naks, 1);
+
+    // A transient NAK is absorbed by a retry
+    ds3231_sim.naks = 1;
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1, I2C_DEFAULT_TIMEOUT_US, 2), 1);
+    CHECK_EQ(engine.stats().naks, 2);
+    CHECK_EQ(engine.stats().retries, 1);
+
+    // A persistent one fails after the first attempt and both retries
+    ds3231_sim.naks = 10;
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1, I2C_DEFAULT_TIMEOUT_US, 2), PICO_ERROR_GENERIC);
+    CHECK_EQ(engine.stats().naks, 5);
+    CHECK_EQ(engine.stats().retries, 3);
+    CHECK_EQ(engine.stats().transactions, 6);
+
+    // The bus still works afterwards
+    ds3231_sim.naks = 0;
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1), 1);
+    CHECK_EQ(byte, 1);
+    CHECK_EQ(free_alarms(), STUB_ALARM_COUNT);
+
+    engine.resetStats();
+    CHECK_EQ(engine.stats().transactions, 0);
+}
+
+static void test_hung_bus()
+{
+    setup();
+    uint8_t reg = 0, byte;
+
+    // The target holds SDA low until clocked 3 times
+    stub_i2c_stuck_pulses = 3;
+    uint64_t start = time_us_64();
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1), PICO_ERROR_TIMEOUT);
+    uint64_t elapsed = time_us_64() - start;
+    CHECK(elapsed >= I2C_DEFAULT_TIMEOUT_US && elapsed < I2C_DEFAULT_TIMEOUT_US + 200);
+    CHECK_EQ(stub_i2c_stuck_pulses, 0);
+    CHECK_EQ(engine.stats().timeouts, 1);
+
+    // Recovered: the pins are back with the controller and the next request works
+    CHECK(stub_gpio[SDA_PIN]);
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1), 1);
+    CHECK_EQ(byte, 1);
+    CHECK_EQ(free_alarms(), STUB_ALARM_COUNT);
+}
+
+static void test_no_alarm()
+{
+    setup();
+    uint8_t reg = 0, byte = 0;
+
+    alarm_id_t ids[STUB_ALARM_COUNT];
+    for (int i = 0; i < STUB_ALARM_COUNT; i++)
+        CHECK((ids[i] = add_alarm_in_us(1000000000, nullptr, nullptr, true)) > 0);
+
+    // Fails at once without touching the bus, even while it is hung
+    stub_i2c_stuck_pulses = 3;
+    uint64_t start = time_us_64();
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1, I2C_DEFAULT_TIMEOUT_US, 2), PICO_ERROR_GENERIC);
+    CHECK(time_us_64() - start < 10);
+    CHECK_EQ(ds3231_sim.transactions, 0);
+    CHECK_EQ(engine.stats().errors, 3);
+    CHECK(!engine.busy());
+
+    // Asynchronous requests fail the same way, through their callbacks
+    I2CRequest r1, r2;
+    read_request(r1, 0, &byte, 1);
+    read_request(r2, 0, &byte, 1);
+    CHECK(engine.submit(&r1));
+    CHECK(engine.submit(&r2));
+    CHECK(r1.done && r2.done);
+    CHECK_EQ(completed, 2);
+    CHECK_EQ(results[0], PICO_ERROR_GENERIC);
+    CHECK_EQ(results[1], PICO_ERROR_GENERIC);
+
+    // Runs again once an alarm is free
+    stub_i2c_stuck_pulses = 0;
+    cancel_alarm(ids[0]);
+    CHECK_EQ(engine.transfer(DS3231_SIM_ADDRESS, &reg, 1, &byte, 1), 1);
+    CHECK_EQ(byte, 1);
+    CHECK_EQ(free_alarms(), 1);
+}
+
+int main()
+{
+    test_transfer();
+    test_async_queue();
+    test_irq_entries();
+    test_queue_full();
+    test_nak();
+    test_hung_bus();
+    test_no_alarm();
+    return 0;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file test_rtc_ds3231.cpp
+ *
+ * DS3231 driver against the simulated register file: the CONTROL/STATUS
+ * shadow must leave the chip exactly as the read-modify-write code it
+ * replaced, without the reads, and must never clear a flag the chip raised
+ * behind its back, nor trust a write or read the chip did not acknowledge.
+ * Also the single-burst snapshot, and the bus rate chosen by begin() on
+ * clean and faulty wiring.
+ */
+
+#include <string.h>
+
+#include <RTClib.h>
+
+#include "ds3231_sim.h"
+#include "test.h"
+
+#define SDA_PIN 26
+#define SCL_PIN 27
+
+/**
+ * @brief The control and status updates as done before the shadow, each reading the register first
+ */
+class ReferenceDS3231
+{
+public:
+    ds3231_sim_t sim;
+
+    uint8_t read(uint8_t reg) { return sim.regs[reg]; }
+    void write(uint8_t reg, uint8_t val) { ds3231_sim_write(&sim, reg, val); }
+
+    bool setAlarm(uint8_t alarm_num)
+    {
+        uint8_t ctrl = read(DS3231_SIM_CONTROL);
+        if (!(ctrl & 0x04))
+            return false;
+        write(DS3231_SIM_CONTROL, ctrl | alarm_num);
+        return true;
+    }
+    void disableAlarm(uint8_t alarm_num) { write(DS3231_SIM_CONTROL, read(DS3231_SIM_CONTROL) & ~(1 << (alarm_num - 1))); }
+    void clearAlarm(uint8_t alarm_num) { write(DS3231_SIM_STATUS, read(DS3231_SIM_STATUS) & ~(1 << (alarm_num - 1))); }
+    void writeSqwPinMode(Ds3231SqwPinMode mode) { write(DS3231_SIM_CONTROL, (read(DS3231_SIM_CONTROL) & ~0x1C) | mode); }
+    void adjust() { write(DS3231_SIM_STATUS, read(DS3231_SIM_STATUS) & ~0x80); }
+    void enable32K() { write(DS3231_SIM_STATUS, read(DS3231_SIM_STATUS) | 0x08); }
+    void disable32K() { write(DS3231_SIM_STATUS, read(DS3231_SIM_STATUS) & ~0x08); }
+};
+
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg()
+{
+    lcg_state = lcg_state * 1103515245 + 12345;
+    return lcg_state >> 16;
+}
+
+static DateTime random_time()
+{
+    return DateTime(2000 + lcg() % 100, 1 + lcg() % 12, 1 + lcg() % 28, lcg() % 24, lcg() % 60, lcg() % 60);
+}
+
+static void begin(RTC_DS3231 &rtc)
+{
+    stub_reset();
+    ds3231_sim_attach(SDA_PIN, SCL_PIN);
+    CHECK(rtc.begin(i2c1, DS3231_SIM_ADDRESS, SDA_PIN, SCL_PIN));
+    ds3231_sim_clear_counts(&ds3231_sim);
+}
+
+static void test_equivalence()
+{
+    static const Ds3231SqwPinMode sqw_modes[] = {DS3231_OFF, DS3231_SquareWave1Hz, DS3231_SquareWave1kHz,
+                                                 DS3231_SquareWave4kHz, DS3231_SquareWave8kHz};
+    RTC_DS3231 rtc;
+    ReferenceDS3231 ref;
+    begin(rtc);
+    ref.sim = ds3231_sim;
+
+    for (int i = 0; i < 5000; i++)
+    {
+        uint8_t alarm_num = 1 + lcg() % 2;
+        int op = lcg() % 10;
+
+        switch (op)
+        {
+        case 0:
+            rtc.disableAlarm(alarm_num);
+            ref.disableAlarm(alarm_num);
+            break;
+        case 1:
+            rtc.clearAlarm(alarm_num);
+            ref.clearAlarm(alarm_num);
+            break;
+        case 2:
+            CHECK_EQ(rtc.setAlarm1(random_time(), DS3231_A1_Hour), ref.setAlarm(1));
+            break;
+        case 3:
+            CHECK_EQ(rtc.setAlarm2(random_time(), DS3231_A2_Minute), ref.setAlarm(2));
+            break;
+        case 4:
+        {
+            Ds3231SqwPinMode mode = sqw_modes[lcg() % 5];
+            rtc.writeSqwPinMode(mode);
+            ref.writeSqwPinMode(mode);
+            break;
+        }
+        case 5:
+            rtc.enable32K();
+            ref.enable32K();
+            break;
+        case 6:
+            rtc.disable32K();
+            ref.disable32K();
+            break;
+        case 7:
+            rtc.adjust(random_time());
+            ref.adjust();
+            break;
+        default:
+        {
+            // The chip raises alarm or oscillator flags on its own, leaving the shadow stale
+            static const uint8_t flags[] = {0x01, 0x02, 0x03, 0x80};
+            uint8_t flag = flags[lcg() % 4];
+            ds3231_sim.regs[DS3231_SIM_STATUS] |= flag;
+            ref.sim.regs[DS3231_SIM_STATUS] |= flag;
+            break;
+        }
+        }
+
+        // Time and alarm registers are encoded as before, the shadow only changes CONTROL/STATUS
+        memcpy(ref.sim.regs, ds3231_sim.regs, DS3231_SIM_CONTROL);
+        if (memcmp(ref.sim.regs, ds3231_sim.regs, DS3231_SIM_REGISTERS) != 0)
+        {
+            fprintf(stderr, "step %d, op %d: CONTROL %02x STATUS %02x, expected %02x %02x\n", i, op,
+                    ds3231_sim.regs[DS3231_SIM_CONTROL], ds3231_sim.regs[DS3231_SIM_STATUS],
+                    ref.sim.regs[DS3231_SIM_CONTROL], ref.sim.regs[DS3231_SIM_STATUS]);
+            exit(1);
+        }
+
+        CHECK_EQ(rtc.getAlarmEnabled(alarm_num), (ref.read(DS3231_SIM_CONTROL) >> (alarm_num - 1)) & 1);
+        CHECK_EQ(rtc.isEnabled32K(), (ref.read(DS3231_SIM_STATUS) >> 3) & 1);
+        uint8_t ctrl = ref.read(DS3231_SIM_CONTROL);
+        CHECK_EQ(rtc.readSqwPinMode(), (ctrl & 0x04) ? DS3231_OFF : (ctrl & 0x18));
+    }
+
+    // Freshly read flags agree too
+    CHECK_EQ(rtc.alarmFired(1), ref.read(DS3231_SIM_STATUS) & 1);
+    CHECK_EQ(rtc.alarmFired(2), (ref.read(DS3231_SIM_STATUS) >> 1) & 1);
+    CHECK_EQ(rtc.lostPower(), ref.read(DS3231_SIM_STATUS) >> 7);
+}
+
+static void test_no_reads()
+{
+    RTC_DS3231 rtc;
+    begin(rtc);
+
+    // programAlarm() in main.cpp: 7 transactions with a read before every update, now 4 writes
+    rtc.disableAlarm(1);
+    rtc.clearAlarm(1);
+    CHECK(rtc.setAlarm1(DateTime(2000, 1, 1, 6, 30, 0), DS3231_A1_Hour));
+    CHECK_EQ(ds3231_sim.transactions, 4);
+    for (int reg = 0; reg < DS3231_SIM_REGISTERS; reg++)
+        CHECK_EQ(ds3231_sim.reads[reg], 0);
+
+    // Queries answer from the shadow
+    CHECK(rtc.getAlarmEnabled(1));
+    CHECK(!rtc.getAlarmEnabled(2));
+    CHECK_EQ(rtc.readSqwPinMode(), DS3231_OFF);
+    CHECK(rtc.isEnabled32K());
+    CHECK_EQ(ds3231_sim.transactions, 4);
+}
+
+static void test_flags_survive_updates()
+{
+    RTC_DS3231 rtc;
+    begin(rtc);
+
+    // Raised after the shadow was loaded, then STATUS is written for other reasons
+    ds3231_sim.regs[DS3231_SIM_STATUS] |= 0x01;
+    rtc.clearAlarm(2);
+    rtc.disable32K();
+    CHECK(rtc.alarmFired(1));
+    CHECK(rtc.lostPower());
+
+    rtc.clearAlarm(1);
+    CHECK(!rtc.alarmFired(1));
+    CHECK_EQ(ds3231_sim.regs[DS3231_SIM_STATUS], 0x80);
+
+    rtc.adjust(DateTime(2024, 2, 3, 7, 5, 0));
+    CHECK(!rtc.lostPower());
+    CHECK_EQ(ds3231_sim.regs[DS3231_SIM_STATUS], 0x00);
+}
+
+static void test_invalidate()
+{
+    RTC_DS3231 rtc;
+    begin(rtc);
+
+    // Changed by someone else, e.g. the chip lost power and reset CONTROL
+    ds3231_sim.regs[DS3231_SIM_CONTROL] = 0x05;
+    CHECK(!rtc.getAlarmEnabled(1));
+    CHECK_EQ(ds3231_sim.transactions, 0);
+
+    rtc.invalidateShadow();
+    CHECK(rtc.getAlarmEnabled(1));
+    CHECK_EQ(ds3231_sim.transactions, 1);
+    CHECK(rtc.getAlarmEnabled(1));
+    CHECK_EQ(ds3231_sim.transactions, 1);
+
+    rtc.disableAlarm(1);
+    CHECK_EQ(ds3231_sim.regs[DS3231_SIM_CONTROL], 0x04);
+}
+
+static void test_failed_access()
+{
+    RTC_DS3231 rtc;
+    begin(rtc);
+
+    // Writes the chip never got leave the shadow to be read back
+    ds3231_sim.naks = 100;
+    rtc.writeSqwPinMode(DS3231_SquareWave1Hz);
+    rtc.disable32K();
+    ds3231_sim.naks = 0;
+    CHECK_EQ(rtc.readSqwPinMode(), DS3231_OFF);
+    CHECK(rtc.isEnabled32K());
+    CHECK_EQ(ds3231_sim.transactions, 1);
+
+    // A read-modify-write after a failed one starts from the chip
+    ds3231_sim.naks = 100;
+    rtc.disableAlarm(2);
+    ds3231_sim.naks = 0;
+    ds3231_sim.regs[DS3231_SIM_CONTROL] |= 0x01;
+    rtc.disableAlarm(2);
+    CHECK_EQ(ds3231_sim.regs[DS3231_SIM_CONTROL], 0x1D);
+
+    // Flags are not answered from an old read
+    ds3231_sim.regs[DS3231_SIM_STATUS] |= 0x81;
+    CHECK(rtc.lostPower());
+    CHECK(rtc.alarmFired(1));
+    ds3231_sim.naks = 100;
+    CHECK(!rtc.lostPower());
+    CHECK(!rtc.alarmFired(1));
+    ds3231_sim.naks = 0;
+}
+
+static void test_read()
+{
+    RTC_DS3231 rtc;
+    begin(rtc);
+
+    DateTime t(2031, 12, 31, 23, 59, 58);
+    rtc.adjust(t);
+    DateTime dt;
+    CHECK(rtc.read(dt));
+    CHECK(dt == t);
+
+    // Registers that are not a valid date are not decoded into one
+    ds3231_sim.regs[5] = 0x13;
+    CHECK(!rtc.read(dt));
+    CHECK(dt == t);
+}
+
+static void test_snapshot()
+{
+    RTC_DS3231 rtc;
+    begin(rtc);
+
+    rtc.adjust(DateTime(2024, 2, 29, 23, 59, 58));
+    CHECK(rtc.setAlarm1(DateTime(2000, 5, 3, 6, 30, 15), DS3231_A1_Day));
+    CHECK(rtc.setAlarm2(DateTime(2000, 1, 17, 21, 45, 0), DS3231_A2_Date));
+    ds3231_sim.regs[DS3231_SIM_STATUS] |= 0x02;
+    ds3231_sim.regs[DS3231_SIM_AGING] = 0xF9;
+    ds3231_sim.regs[0x11] = 0xF6; // -10.25 degrees
+    ds3231_sim.regs[0x12] = 0xC0;
+
+    // What initRTC() used to read one register at a time
+    DateTime time = rtc.now();
+    DateTime alarm1 = rtc.getAlarm1();
+    Ds3231Alarm1Mode alarm1_mode = rtc.getAlarm1Mode();
+    DateTime alarm2 = rtc.getAlarm2();
+    Ds3231Alarm2Mode alarm2_mode = rtc.getAlarm2Mode();
+    bool lost_power = rtc.lostPower();
+    bool fired[2] = {rtc.alarmFired(1), rtc.alarmFired(2)};
+    float temperature = rtc.getTemperature();
+
+    ds3231_sim_clear_counts(&ds3231_sim);
+    stub_i2c_rx_max = 0;
+    DS3231Snapshot snap;
+    CHECK(rtc.snapshot(snap));
+
+    // One transaction, every register read once, without overrunning the RX FIFO
+    CHECK_EQ(ds3231_sim.transactions, 1);
+    for (int reg = 0; reg < DS3231_SIM_REGISTERS; reg++)
+        CHECK_EQ(ds3231_sim.reads[reg], 1);
+    CHECK(stub_i2c_rx_max <= 16);
+    CHECK(memcmp(snap.registers, ds3231_sim.regs, DS3231_SIM_REGISTERS) == 0);
+
+    CHECK(snap.time == time);
+    CHECK(snap.alarm1 == alarm1);
+    CHECK_EQ(snap.alarm1_mode, alarm1_mode);
+    CHECK_EQ(snap.alarm1_mode, DS3231_A1_Day);
+    CHECK(snap.alarm2 == alarm2);
+    CHECK_EQ(snap.alarm2_mode, alarm2_mode);
+    CHECK_EQ(snap.alarm2_mode, DS3231_A2_Date);
+    CHECK_EQ(snap.lostPower(), lost_power);
+    CHECK_EQ(snap.alarmFired(1), fired[0]);
+    CHECK_EQ(snap.alarmFired(2), fired[1]);
+    CHECK(snap.alarmEnabled(1) && snap.alarmEnabled(2));
+    CHECK_EQ(snap.aging, -7);
+    CHECK(snap.temperature == temperature);
+    CHECK(snap.temperature == -9.25f);
+
+    // The shadow was refreshed from it
+    ds3231_sim_clear_counts(&ds3231_sim);
+    rtc.invalidateShadow();
+    CHECK(rtc.snapshot(snap));
+    CHECK(rtc.getAlarmEnabled(2));
+    CHECK(rtc.isEnabled32K());
+    CHECK_EQ(ds3231_sim.transactions, 1);
+
+    // Nothing is decoded from a failed read
+    stub_i2c_attach(nullptr, SDA_PIN, SCL_PIN);
+    CHECK(!rtc.snapshot(snap));
+}
+
+static void test_baudrate()
+{
+    ds3231_sim_t powered_on;
+    ds3231_sim_reset(&powered_on);
+    powered_on.regs[DS3231_SIM_AGING] = 0xF9;
+
+    // Clean wiring: fast mode, found without writing anything
+    {
+        RTC_DS3231 rtc;
+        stub_reset();
+        ds3231_sim_attach(SDA_PIN, SCL_PIN);
+        ds3231_sim.regs[DS3231_SIM_AGING] = 0xF9;
+        CHECK(rtc.begin(i2c1, DS3231_SIM_ADDRESS, SDA_PIN, SCL_PIN));
+        CHECK_EQ(rtc.baudrate(), DS3231_FAST_BAUDRATE);
+        CHECK_EQ(stub_i2c_baudrate, DS3231_FAST_BAUDRATE);
+        for (int reg = 0; reg < DS3231_SIM_REGISTERS; reg++)
+            CHECK_EQ(ds3231_sim.writes[reg], 0);
+        CHECK(memcmp(ds3231_sim.regs, powered_on.regs, DS3231_SIM_REGISTERS) == 0);
+        I2CStats stats = rtc.busStats();
+        CHECK_EQ(stats.naks + stats.timeouts + stats.errors + stats.retries, 0);
+
+        // The chip raising a flag while the rate is checked does not fail it
+        ds3231_sim.regs[DS3231_SIM_STATUS] |= 0x03;
+        CHECK(rtc.begin(i2c1, DS3231_SIM_ADDRESS, SDA_PIN, SCL_PIN));
+        CHECK_EQ(rtc.baudrate(), DS3231_FAST_BAUDRATE);
+    }
+
+    // NAKs in fast mode: back to standard mode, counted, not retried
+    {
+        RTC_DS3231 rtc;
+        stub_reset();
+        ds3231_sim_attach(SDA_PIN, SCL_PIN);
+        ds3231_sim.nak_above = DS3231_STANDARD_BAUDRATE;
+        CHECK(rtc.begin(i2c1, DS3231_SIM_ADDRESS, SDA_PIN, SCL_PIN));
+        CHECK_EQ(rtc.baudrate(), DS3231_STANDARD_BAUDRATE);
+        CHECK_EQ(stub_i2c_baudrate, DS3231_STANDARD_BAUDRATE);
+        CHECK_EQ(rtc.busStats().naks, 1);
+        CHECK_EQ(rtc.busStats().retries, 0);
+        CHECK(rtc.now() == DateTime(2000, 1, 1));
+    }
+
+    // Bits flipped in fast mode: back to standard mode, still nothing written
+    {
+        RTC_DS3231 rtc;
+        stub_reset();
+        ds3231_sim_attach(SDA_PIN, SCL_PIN);
+        ds3231_sim.corrupt_above = DS3231_STANDARD_BAUDRATE;
+        CHECK(rtc.begin(i2c1, DS3231_SIM_ADDRESS, SDA_PIN, SCL_PIN));
+        CHECK_EQ(rtc.baudrate(), DS3231_STANDARD_BAUDRATE);
+        CHECK_EQ(stub_i2c_baudrate, DS3231_STANDARD_BAUDRATE);
+        for (int reg = 0; reg < DS3231_SIM_REGISTERS; reg++)
+            CHECK_EQ(ds3231_sim.writes[reg], 0);
+        CHECK(rtc.now() == DateTime(2000, 1, 1));
+    }
+
+    // Capped at standard mode: fast mode is never tried
+    {
+        RTC_DS3231 rtc;
+        stub_reset();
+        ds3231_sim_attach(SDA_PIN, SCL_PIN);
+        ds3231_sim.nak_above = DS3231_STANDARD_BAUDRATE;
+        CHECK(rtc.begin(i2c1, DS3231_SIM_ADDRESS, SDA_PIN, SCL_PIN, DS3231_STANDARD_BAUDRATE));
+        CHECK_EQ(rtc.baudrate(), DS3231_STANDARD_BAUDRATE);
+        CHECK_EQ(rtc.busStats().naks, 0);
+        CHECK_EQ(ds3231_sim.transactions, 1);
+    }
+}
+
+int main()
+{
+    test_equivalence();
+    test_no_reads();
+    test_flags_survive_updates();
+    test_invalidate();
+    test_failed_access();
+    test_read();
+    test_snapshot();
+    test_baudrate();
+    return 0;
+}
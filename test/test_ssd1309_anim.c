@@ -0,0 +1,125 @@
+/**
+ * @file test_ssd1309_anim.c
+ *
+ * animation decoder against decoding the source BMPs: every frame, after
+ * wrapping around, and clipped at the panel edges
+ */
+
+#include <string.h>
+
+#include "splash_anim.h"
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+#include "test_anim.h"
+#include "test_image.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+#define BMP_MAX 2048
+
+static ssd1309_t display;
+static ssd1309_t expected;
+
+static void load_frame(int frame, ssd1309_t *p)
+{
+    static uint8_t bmp[BMP_MAX];
+    char path[256];
+    snprintf(path, sizeof(path), "%s/frame%d.bmp", ANIM_FRAMES_DIR, frame);
+    FILE *f = fopen(path, "rb");
+    CHECK(f != NULL);
+    long size = (long)fread(bmp, 1, sizeof(bmp), f);
+    fclose(f);
+
+    ssd1309_clear(p);
+    ssd1309_bmp_show_image(p, bmp, size);
+}
+
+static void test_frames_match_bmps(void)
+{
+    ssd1309_anim_t anim;
+    ssd1309_anim_init(&anim, test_anim);
+    CHECK_EQ(anim.frames, ANIM_FRAME_COUNT);
+    CHECK_EQ(anim.width, WIDTH);
+    CHECK_EQ(anim.pages, HEIGHT / 8);
+
+    ssd1309_clear(&display);
+    for (int loop = 0; loop < 2; loop++)
+        for (int frame = 0; frame < ANIM_FRAME_COUNT; frame++)
+        {
+            ssd1309_show_partial(&display);
+            ssd1309_anim_draw_frame(&display, &anim, 0, 0);
+            load_frame(frame, &expected);
+            if (memcmp(display.buffer, expected.buffer, display.bufsize) != 0)
+            {
+                fprintf(stderr, "loop %d frame %d differs\n", loop, frame);
+                exit(1);
+            }
+            for (int page = 0; page < HEIGHT / 8; page++)
+            {
+                CHECK_EQ(display.dirty_x0[page], 0);
+                CHECK_EQ(display.dirty_x1[page], WIDTH - 1);
+            }
+        }
+}
+
+static void test_single_keyframe(void)
+{
+    ssd1309_anim_t anim;
+    ssd1309_anim_init(&anim, splash_anim);
+    CHECK_EQ(anim.frames, 1);
+
+    ssd1309_clear(&display);
+    ssd1309_anim_draw_frame(&display, &anim, 0, 0);
+    ssd1309_clear(&expected);
+    ssd1309_bmp_show_image(&expected, image_data, image_size);
+    CHECK(memcmp(display.buffer, expected.buffer, display.bufsize) == 0);
+}
+
+static void test_clipped(void)
+{
+    const uint32_t x = 100, page = 3;
+    ssd1309_anim_t anim;
+    ssd1309_anim_init(&anim, test_anim);
+
+    ssd1309_clear(&display);
+    for (int frame = 0; frame < ANIM_FRAME_COUNT; frame++)
+    {
+        ssd1309_show_partial(&display);
+        ssd1309_anim_draw_frame(&display, &anim, x, page);
+        load_frame(frame, &expected);
+
+        // The visible corner of the frame, nothing else
+        for (uint32_t pg = 0; pg < HEIGHT / 8; pg++)
+            for (uint32_t col = 0; col < WIDTH; col++)
+            {
+                uint8_t want = 0;
+                if (pg >= page && col >= x)
+                    want = expected.buffer[(pg - page) * WIDTH + col - x];
+                CHECK_EQ(display.buffer[pg * WIDTH + col], want);
+            }
+        for (uint32_t pg = 0; pg < HEIGHT / 8; pg++)
+        {
+            if (pg < page)
+                continue;
+            CHECK_EQ(display.dirty_x0[pg], x);
+            CHECK_EQ(display.dirty_x1[pg], WIDTH - 1);
+        }
+    }
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+    CHECK(ssd1309_init(&expected, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    test_frames_match_bmps();
+    test_single_keyframe();
+    test_clipped();
+
+    ssd1309_deinit(&display);
+    ssd1309_deinit(&expected);
+    return 0;
+}
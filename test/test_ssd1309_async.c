@@ -0,0 +1,202 @@
+/**
+ * @file test_ssd1309_async.c
+ *
+ * asynchronous flush: busy while the DMA runs, the dirty windows chained
+ * from the DMA interrupt, completion after the last one, refusal of a
+ * second flush, and the fallbacks
+ */
+
+#include <string.h>
+
+#include <hardware/dma.h>
+
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+
+#define CS_PIN 5
+#define DC_PIN 6
+#define RST_PIN 7
+#define WINDOW_BYTES 6
+
+static ssd1309_t display;
+static int callbacks;
+static void *callback_data;
+
+static void on_flushed(void *user_data)
+{
+    callbacks++;
+    callback_data = user_data;
+}
+
+static void setup(void)
+{
+    stub_reset();
+    stub_spi_attach(CS_PIN, DC_PIN, 4096);
+    CHECK(ssd1309_init(&display, 128, 64, spi0, CS_PIN, DC_PIN, RST_PIN));
+    CHECK(display.dma_chan >= 0);
+    ssd1309_show(&display);
+    stub_spi_clear();
+    callbacks = 0;
+    callback_data = NULL;
+}
+
+static void test_busy_until_dma_completes(void)
+{
+    setup();
+    stub_dma_auto_complete = false;
+
+    ssd1309_draw_square(&display, 0, 8, 10, 16); // pages 1 and 2
+    int token;
+    CHECK(ssd1309_show_async(&display, on_flushed, &token));
+
+    // Window sent, first row in flight, bus held
+    CHECK(ssd1309_is_busy(&display));
+    CHECK(stub_dma_busy(display.dma_chan));
+    CHECK_EQ(stub_gpio[CS_PIN], 0);
+    CHECK_EQ(callbacks, 0);
+    CHECK_EQ(stub_spi.len, WINDOW_BYTES);
+    for (size_t i = 0; i < WINDOW_BYTES; i++)
+        CHECK_EQ(stub_spi.dc[i], 0);
+
+    // The second row follows in the same window
+    stub_dma_complete(display.dma_chan);
+    CHECK(ssd1309_is_busy(&display));
+    CHECK(stub_dma_busy(display.dma_chan));
+    CHECK_EQ(callbacks, 0);
+    CHECK_EQ(stub_spi.len, WINDOW_BYTES + 10);
+
+    stub_dma_complete(display.dma_chan);
+    CHECK(!ssd1309_is_busy(&display));
+    CHECK_EQ(stub_gpio[CS_PIN], 1);
+    CHECK_EQ(callbacks, 1);
+    CHECK(callback_data == &token);
+    CHECK_EQ(stub_spi.unselected, 0);
+
+    // Only the dirty columns go out
+    CHECK_EQ(stub_spi.len, WINDOW_BYTES + 2 * 10);
+    CHECK_EQ(display.stats.bytes, stub_spi.len);
+    CHECK_EQ(display.stats.transactions, 3);
+    for (size_t i = WINDOW_BYTES; i < stub_spi.len; i++)
+        CHECK_EQ(stub_spi.dc[i], 1);
+    CHECK(memcmp(stub_spi.bytes + WINDOW_BYTES, display.buffer + 128, 10) == 0);
+    CHECK(memcmp(stub_spi.bytes + WINDOW_BYTES + 10, display.buffer + 256, 10) == 0);
+}
+
+static void test_windows(void)
+{
+    setup();
+
+    // A full width band in one transfer, then two narrow windows
+    ssd1309_draw_square(&display, 0, 16, 128, 16); // pages 2 and 3
+    ssd1309_draw_square(&display, 20, 40, 4, 4);   // page 5
+    ssd1309_draw_square(&display, 100, 56, 8, 4);  // page 7
+    CHECK(ssd1309_show_async(&display, on_flushed, NULL));
+    ssd1309_wait(&display);
+    CHECK_EQ(callbacks, 1);
+
+    size_t band = WINDOW_BYTES + 2 * 128;
+    CHECK_EQ(stub_spi.len, band + WINDOW_BYTES + 4 + WINDOW_BYTES + 8);
+    CHECK_EQ(display.stats.transactions, 6);
+    CHECK(memcmp(stub_spi.bytes + WINDOW_BYTES, display.buffer + 2 * 128, 2 * 128) == 0);
+    const uint8_t window5[] = {SET_COL_ADDR, 20, 23, SET_PAGE_ADDR, 5, 5};
+    CHECK(memcmp(stub_spi.bytes + band, window5, WINDOW_BYTES) == 0);
+    CHECK(memcmp(stub_spi.bytes + band + WINDOW_BYTES, display.buffer + 5 * 128 + 20, 4) == 0);
+    const uint8_t window7[] = {SET_COL_ADDR, 100, 107, SET_PAGE_ADDR, 7, 7};
+    CHECK(memcmp(stub_spi.bytes + band + WINDOW_BYTES + 4, window7, WINDOW_BYTES) == 0);
+    for (size_t i = 0; i < stub_spi.len; i++)
+        CHECK_EQ(stub_spi.dc[i], !(i < WINDOW_BYTES || (i >= band && i < band + WINDOW_BYTES) ||
+                                   (i >= band + WINDOW_BYTES + 4 && i < band + 2 * WINDOW_BYTES + 4)));
+
+    // Same bytes as a blocking partial flush
+    size_t async_len = stub_spi.len;
+    uint8_t async_bytes[4096];
+    memcpy(async_bytes, stub_spi.bytes, async_len);
+    ssd1309_draw_square(&display, 0, 16, 128, 16);
+    ssd1309_draw_square(&display, 20, 40, 4, 4);
+    ssd1309_draw_square(&display, 100, 56, 8, 4);
+    stub_spi_clear();
+    ssd1309_show_partial(&display);
+    CHECK_EQ(stub_spi.len, async_len);
+    CHECK(memcmp(stub_spi.bytes, async_bytes, async_len) == 0);
+}
+
+static void test_second_flush_refused_while_busy(void)
+{
+    setup();
+    stub_dma_auto_complete = false;
+
+    ssd1309_draw_square(&display, 0, 0, 4, 4);
+    CHECK(ssd1309_show_async(&display, on_flushed, NULL));
+    size_t sent = stub_spi.len;
+
+    ssd1309_draw_square(&display, 100, 40, 4, 4);
+    CHECK(!ssd1309_show_async(&display, on_flushed, NULL));
+    CHECK_EQ(stub_spi.len, sent);
+    CHECK_EQ(callbacks, 0);
+
+    stub_dma_complete(display.dma_chan);
+    CHECK_EQ(callbacks, 1);
+
+    // The refused changes are still dirty and go out with the next flush
+    CHECK(ssd1309_show_async(&display, on_flushed, NULL));
+    stub_dma_complete(display.dma_chan);
+    CHECK_EQ(callbacks, 2);
+    CHECK_EQ(display.stats.bytes, WINDOW_BYTES + 4); // the square on page 5 only
+}
+
+static void test_wait_blocks_until_done(void)
+{
+    setup();
+
+    ssd1309_draw_square(&display, 0, 0, 4, 4);
+    CHECK(ssd1309_show_async(&display, on_flushed, NULL));
+    ssd1309_wait(&display); // completes through tight_loop_contents()
+    CHECK(!ssd1309_is_busy(&display));
+    CHECK_EQ(callbacks, 1);
+}
+
+static void test_clean_buffer_completes_at_once(void)
+{
+    setup();
+    stub_dma_auto_complete = false;
+
+    CHECK(ssd1309_show_async(&display, on_flushed, NULL));
+    CHECK(!ssd1309_is_busy(&display));
+    CHECK_EQ(callbacks, 1);
+    CHECK_EQ(stub_spi.len, 0);
+}
+
+static void test_without_dma_channel(void)
+{
+    setup();
+    ssd1309_deinit(&display);
+
+    // Leave no channel for the driver to claim
+    int claimed;
+    while ((claimed = dma_claim_unused_channel(false)) >= 0)
+        ;
+    stub_spi_clear();
+    CHECK(ssd1309_init(&display, 128, 64, spi0, CS_PIN, DC_PIN, RST_PIN));
+    CHECK_EQ(display.dma_chan, -1);
+
+    ssd1309_draw_square(&display, 0, 0, 4, 4);
+    stub_spi_clear();
+    CHECK(ssd1309_show_async(&display, on_flushed, NULL));
+    CHECK(!ssd1309_is_busy(&display));
+    CHECK_EQ(callbacks, 1);
+    CHECK_EQ(stub_gpio[CS_PIN], 1);
+    CHECK(stub_spi.len > 0);
+    ssd1309_deinit(&display);
+}
+
+int main(void)
+{
+    test_busy_until_dma_completes();
+    test_windows();
+    test_second_flush_refused_while_busy();
+    test_wait_blocks_until_done();
+    test_clean_buffer_completes_at_once();
+    test_without_dma_channel();
+    return 0;
+}
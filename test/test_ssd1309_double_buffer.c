@@ -0,0 +1,159 @@
+/**
+ * @file test_ssd1309_double_buffer.c
+ *
+ * double buffering: only changed columns are sent, the first flush after
+ * enabling it sends the whole frame whatever it holds, and a frame in
+ * flight is not torn by drawing or by a blocking flush started meanwhile
+ */
+
+#include <string.h>
+
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+
+#define CS_PIN 5
+#define DC_PIN 6
+#define RST_PIN 7
+#define WINDOW_BYTES 6
+
+static ssd1309_t display;
+
+static void setup(void)
+{
+    stub_reset();
+    stub_spi_attach(CS_PIN, DC_PIN, 4096);
+    CHECK(ssd1309_init(&display, 128, 64, spi0, CS_PIN, DC_PIN, RST_PIN));
+    CHECK(ssd1309_set_double_buffer(&display, true));
+    ssd1309_show(&display);
+    stub_spi_clear();
+}
+
+static void teardown(void)
+{
+    ssd1309_deinit(&display);
+}
+
+static void test_unchanged_columns_not_sent(void)
+{
+    setup();
+
+    ssd1309_draw_square(&display, 10, 0, 4, 4);
+    ssd1309_show_partial(&display);
+    stub_spi_clear();
+
+    // Redrawing the same pixels over a wider area changes nothing
+    ssd1309_clear_square(&display, 0, 0, 40, 8);
+    ssd1309_draw_square(&display, 10, 0, 4, 4);
+    ssd1309_show_partial(&display);
+    CHECK_EQ(stub_spi.total, 0);
+
+    // Only the changed column goes out
+    ssd1309_clear_square(&display, 0, 0, 40, 8);
+    ssd1309_draw_square(&display, 10, 0, 5, 4);
+    ssd1309_show_partial(&display);
+    CHECK_EQ(stub_spi.total, WINDOW_BYTES + 1);
+    CHECK_EQ(stub_spi.bytes[WINDOW_BYTES], 0x0f);
+    teardown();
+}
+
+/**
+ * @brief Count the data bytes on the bus
+ */
+static size_t data_bytes(void)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < stub_spi.len; i++)
+        n += stub_spi.dc[i];
+    return n;
+}
+
+/**
+ * @brief Flip every pixel of the frame right after enabling double buffering
+ *
+ * What the panel shows is unknown, so nothing can be diffed away, not even
+ * bytes that look like the inverse of what was there.
+ */
+static void check_first_flush_sends_all(void (*flush)(ssd1309_t *))
+{
+    stub_reset();
+    stub_spi_attach(CS_PIN, DC_PIN, 4096);
+    CHECK(ssd1309_init(&display, 128, 64, spi0, CS_PIN, DC_PIN, RST_PIN));
+    CHECK(ssd1309_set_double_buffer(&display, true));
+
+    ssd1309_draw_square(&display, 0, 0, 128, 64);
+    flush(&display);
+    ssd1309_wait(&display);
+    CHECK_EQ(data_bytes(), display.bufsize);
+    CHECK(memcmp(display.front, display.buffer, display.bufsize) == 0);
+
+    // Known from here on, an unchanged frame is not sent again
+    stub_spi_clear();
+    ssd1309_draw_square(&display, 0, 0, 128, 64);
+    flush(&display);
+    ssd1309_wait(&display);
+    CHECK_EQ(stub_spi.total, 0);
+    teardown();
+}
+
+static void show_async(ssd1309_t *p)
+{
+    CHECK(ssd1309_show_async(p, NULL, NULL));
+}
+
+static void test_drawing_during_async_flush(void)
+{
+    setup();
+    stub_dma_auto_complete = false;
+
+    ssd1309_draw_square(&display, 0, 0, 4, 4);
+    CHECK(ssd1309_show_async(&display, NULL, NULL));
+    ssd1309_draw_square(&display, 0, 0, 4, 8);
+    stub_dma_complete(display.dma_chan);
+
+    CHECK_EQ(stub_spi.bytes[WINDOW_BYTES], 0x0f);
+    teardown();
+}
+
+/**
+ * @brief Start an async flush of one frame, draw the next and flush it blocking
+ *
+ * The in-flight transfer must go out unchanged, before anything of the
+ * second flush.
+ */
+static void check_blocking_flush_waits(void (*flush)(ssd1309_t *))
+{
+    setup();
+    stub_dma_auto_complete = false;
+
+    ssd1309_draw_square(&display, 0, 0, 4, 4);
+    CHECK(ssd1309_show_async(&display, NULL, NULL));
+    ssd1309_draw_square(&display, 0, 0, 4, 8);
+
+    // The blocking flush completes the DMA while it waits
+    stub_dma_auto_complete = true;
+    flush(&display);
+
+    CHECK(!ssd1309_is_busy(&display));
+    CHECK_EQ(stub_spi.unselected, 0);
+    CHECK_EQ(stub_spi.bytes[WINDOW_BYTES], 0x0f);
+    CHECK_EQ(stub_spi.dc[WINDOW_BYTES + 4], 0); // next window
+
+    // The second flush sent the new frame and counted only itself
+    size_t second = WINDOW_BYTES + 4;
+    CHECK_EQ(display.stats.bytes, stub_spi.total - second);
+    CHECK_EQ(stub_spi.bytes[second + WINDOW_BYTES], 0xff);
+    CHECK(memcmp(display.front, display.buffer, display.bufsize) == 0);
+    teardown();
+}
+
+int main(void)
+{
+    test_unchanged_columns_not_sent();
+    check_first_flush_sends_all(ssd1309_show_partial);
+    check_first_flush_sends_all(show_async);
+    test_drawing_during_async_flush();
+    check_blocking_flush_waits(ssd1309_show);
+    check_blocking_flush_waits(ssd1309_show_partial);
+    return 0;
+}
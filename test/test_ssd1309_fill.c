@@ -0,0 +1,83 @@
+/**
+ * @file test_ssd1309_fill.c
+ *
+ * byte-wise rectangle fill and clear against the per-pixel reference, over
+ * every row offset and sizes around the page boundaries, including clipping
+ */
+
+#include <string.h>
+
+#include "reference.h"
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+
+static const uint32_t xs[] = {0, 1, 5, 7, 8, 63, 120, 127, 128, 130};
+static const uint32_t sizes[] = {0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 33, 63, 64, 65, 200};
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static ssd1309_t display;
+static uint8_t expected[WIDTH * HEIGHT / 8];
+
+static void fill_pattern(uint8_t *buffer, uint32_t seed)
+{
+    for (size_t i = 0; i < WIDTH * HEIGHT / 8; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        buffer[i] = seed >> 16;
+    }
+}
+
+static void check_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, bool on)
+{
+    uint32_t seed = x * 7919u + y * 104729u + w * 31u + h;
+    fill_pattern(display.buffer, seed);
+    fill_pattern(expected, seed);
+    ssd1309_show_partial(&display); // leaves every page clean
+
+    if (on)
+        ssd1309_draw_square(&display, x, y, w, h);
+    else
+        ssd1309_clear_square(&display, x, y, w, h);
+
+    ref_canvas_t ref = {expected, WIDTH, HEIGHT};
+    ref_fill_rect(&ref, x, y, w, h, on);
+    if (memcmp(display.buffer, expected, sizeof(expected)) != 0)
+    {
+        fprintf(stderr, "%s_square(%u, %u, %u, %u) differs\n", on ? "draw" : "clear", x, y, w, h);
+        exit(1);
+    }
+
+    // Every touched page is marked dirty over the clipped columns
+    if (!w || !h || x >= WIDTH || y >= HEIGHT)
+        return;
+    uint32_t x1 = x + w - 1 < WIDTH ? x + w - 1 : WIDTH - 1;
+    uint32_t y1 = y + h - 1 < HEIGHT ? y + h - 1 : HEIGHT - 1;
+    for (uint32_t page = y / 8; page <= y1 / 8; page++)
+    {
+        CHECK(display.dirty_x0[page] <= x);
+        CHECK(display.dirty_x1[page] >= x1);
+    }
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    for (size_t xi = 0; xi < COUNT(xs); xi++)
+        for (uint32_t y = 0; y <= HEIGHT + 2; y++)
+            for (size_t wi = 0; wi < COUNT(sizes); wi++)
+                for (size_t hi = 0; hi < COUNT(sizes); hi++)
+                {
+                    check_rect(xs[xi], y, sizes[wi], sizes[hi], true);
+                    check_rect(xs[xi], y, sizes[wi], sizes[hi], false);
+                }
+
+    ssd1309_deinit(&display);
+    return 0;
+}
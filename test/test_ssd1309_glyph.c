@@ -0,0 +1,91 @@
+/**
+ * @file test_ssd1309_glyph.c
+ *
+ * cached scaled glyphs against drawing every font pixel as a square, for
+ * all fonts, characters and scales, with the cache both cold and warm
+ */
+
+#include <string.h>
+
+#include "reference.h"
+#include "ssd1309.h"
+#include "font.h"
+#include "ssd1309_fonts.h"
+#include "stubs.h"
+#include "test.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+
+static const uint32_t positions[][2] = {{0, 0}, {5, 3}, {40, 8}, {61, 13}, {120, 50}};
+#define POSITION_COUNT (sizeof(positions) / sizeof(positions[0]))
+
+static ssd1309_t display;
+static uint8_t expected[WIDTH * HEIGHT / 8];
+
+static void check_font(const ssd1309_font_t *font)
+{
+    ref_canvas_t ref = {expected, WIDTH, HEIGHT};
+
+    for (int pass = 0; pass < 2; pass++)
+        for (uint32_t scale = 1; scale <= 4; scale++)
+            for (size_t i = 0; i < POSITION_COUNT; i++)
+                for (int c = font->first; c <= font->last; c++)
+                {
+                    uint32_t x = positions[i][0], y = positions[i][1];
+                    ssd1309_clear(&display);
+                    memset(expected, 0, sizeof(expected));
+
+                    uint32_t advance = ssd1309_draw_glyph(&display, x, y, scale, font, (char)c);
+                    CHECK_EQ(advance, ref_draw_glyph(&ref, x, y, scale, font, (char)c));
+                    if (memcmp(display.buffer, expected, sizeof(expected)) != 0)
+                    {
+                        fprintf(stderr, "glyph '%c' scale %u at (%u, %u) differs\n", c, scale, x, y);
+                        exit(1);
+                    }
+                }
+}
+
+static void check_raw_font(const uint8_t *font)
+{
+    ref_canvas_t ref = {expected, WIDTH, HEIGHT};
+
+    for (int pass = 0; pass < 2; pass++)
+        for (uint32_t scale = 1; scale <= 4; scale++)
+            for (size_t i = 0; i < POSITION_COUNT; i++)
+                for (int c = font[3]; c <= font[4]; c++)
+                {
+                    uint32_t x = positions[i][0], y = positions[i][1];
+                    ssd1309_clear(&display);
+                    memset(expected, 0, sizeof(expected));
+
+                    ssd1309_draw_char_with_font(&display, x, y, scale, font, (char)c);
+                    ref_draw_char_with_font(&ref, x, y, scale, font, (char)c);
+                    CHECK(memcmp(display.buffer, expected, sizeof(expected)) == 0);
+                }
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    check_font(&ssd1309_font_8x5);
+    check_font(&ssd1309_BMSPA_font);
+    check_font(&ssd1309_acme_font);
+    check_raw_font(font_8x5);
+
+    // Clock digits: one lookup per glyph once warm
+    ssd1309_clear(&display);
+    memset(expected, 0, sizeof(expected));
+    ref_canvas_t ref = {expected, WIDTH, HEIGHT};
+    ssd1309_draw_text(&display, 20, 24, 3, &ssd1309_font_8x5, "07:05");
+    uint32_t x = 20;
+    for (const char *s = "07:05"; *s; s++)
+        x += ref_draw_glyph(&ref, x, 24, 3, &ssd1309_font_8x5, *s);
+    CHECK(memcmp(display.buffer, expected, sizeof(expected)) == 0);
+
+    ssd1309_deinit(&display);
+    return 0;
+}
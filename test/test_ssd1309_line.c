@@ -0,0 +1,165 @@
+/**
+ * @file test_ssd1309_line.c
+ *
+ * line rasterizer against the ideal raster: one pixel per step along the
+ * major axis, each within half a pixel of the true line
+ *
+ * Exactly halfway, either neighbour is accepted.
+ */
+
+#include <string.h>
+
+#include "reference.h"
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+
+static ssd1309_t display;
+
+static int32_t iabs(int32_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+static bool on_screen(int32_t x, int32_t y)
+{
+    return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT;
+}
+
+/**
+ * @brief Check the buffer holds the ideal raster of a line and nothing else
+ *
+ * @param clipped true if parts of the line may be off screen
+ */
+static void check_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool clipped)
+{
+    int32_t dx = x2 - x1;
+    int32_t dy = y2 - y1;
+    bool steep = iabs(dy) > iabs(dx);
+    int32_t n = steep ? iabs(dy) : iabs(dx);
+    size_t expected = 0;
+
+    for (int32_t i = 0; i <= n; i++)
+    {
+        // Major coordinate steps by one; the minor one is the ideal value times n
+        int32_t major = steep ? y1 + (dy < 0 ? -i : i) : x1 + (dx < 0 ? -i : i);
+        int64_t minor_n = steep ? (int64_t)x1 * n + (int64_t)dx * i : (int64_t)y1 * n + (int64_t)dy * i;
+
+        int hits = 0;
+        for (int32_t minor = -2; minor < (steep ? WIDTH : HEIGHT) + 2; minor++)
+        {
+            int32_t x = steep ? minor : major;
+            int32_t y = steep ? major : minor;
+            bool near = n == 0 ? minor == y1
+                              : 2 * (minor * (int64_t)n - minor_n) <= n && 2 * (minor_n - minor * (int64_t)n) <= n;
+            if (!on_screen(x, y) || !ref_get_pixel(display.buffer, WIDTH, x, y))
+                continue;
+            if (!near)
+            {
+                fprintf(stderr, "line (%d,%d)-(%d,%d): (%d,%d) off the line\n", x1, y1, x2, y2, x, y);
+                exit(1);
+            }
+            hits++;
+        }
+        if (hits > 1 || (!clipped && hits != 1))
+        {
+            fprintf(stderr, "line (%d,%d)-(%d,%d): %d pixels at step %d\n", x1, y1, x2, y2, hits, i);
+            exit(1);
+        }
+        expected += hits;
+    }
+
+    // Nothing outside the line's steps
+    size_t total = 0;
+    for (size_t i = 0; i < display.bufsize; i++)
+        total += __builtin_popcount(display.buffer[i]);
+    CHECK_EQ(total, expected);
+
+    // Endpoints are part of an unclipped line
+    if (!clipped)
+    {
+        CHECK(ref_get_pixel(display.buffer, WIDTH, x1, y1));
+        CHECK(ref_get_pixel(display.buffer, WIDTH, x2, y2));
+    }
+}
+
+static void draw_and_check(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+    bool clipped = !on_screen(x1, y1) || !on_screen(x2, y2);
+    ssd1309_clear(&display);
+    ssd1309_draw_line(&display, x1, y1, x2, y2);
+    check_line(x1, y1, x2, y2, clipped);
+}
+
+static void test_all_octants(void)
+{
+    // Every pair of endpoints in a 20x20 patch spanning a page boundary
+    for (int32_t a = 0; a < 400; a++)
+        for (int32_t b = 0; b < 400; b++)
+            draw_and_check(50 + a % 20, 2 + a / 20, 50 + b % 20, 2 + b / 20);
+}
+
+static void test_long_and_clipped(void)
+{
+    uint32_t seed = 1;
+    for (int i = 0; i < 20000; i++)
+    {
+        int32_t c[4];
+        for (int k = 0; k < 4; k++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            c[k] = (int32_t)((seed >> 8) % (k % 2 ? HEIGHT + 20 : WIDTH + 20)) - 10;
+        }
+        draw_and_check(c[0], c[1], c[2], c[3]);
+    }
+
+    draw_and_check(0, 0, WIDTH - 1, HEIGHT - 1);
+    draw_and_check(WIDTH - 1, 0, 0, HEIGHT - 1);
+    draw_and_check(-5, 10, WIDTH + 5, 10);
+    draw_and_check(10, -5, 10, HEIGHT + 5);
+}
+
+static void test_empty_square(void)
+{
+    static uint8_t expected[WIDTH * HEIGHT / 8];
+    ref_canvas_t ref = {expected, WIDTH, HEIGHT};
+
+    for (uint32_t y = 0; y < 20; y++)
+        for (uint32_t w = 0; w < 20; w++)
+            for (uint32_t h = 0; h < 20; h++)
+            {
+                uint32_t x = 120 - w / 2; // partly clipped at the right edge
+                ssd1309_clear(&display);
+                ssd1309_draw_empty_square(&display, x, y, w, h);
+
+                memset(expected, 0, sizeof(expected));
+                for (uint32_t i = 0; i <= w; i++)
+                {
+                    ref_set_pixel(&ref, x + i, y, true);
+                    ref_set_pixel(&ref, x + i, y + h, true);
+                }
+                for (uint32_t j = 0; j <= h; j++)
+                {
+                    ref_set_pixel(&ref, x, y + j, true);
+                    ref_set_pixel(&ref, x + w, y + j, true);
+                }
+                CHECK(memcmp(display.buffer, expected, sizeof(expected)) == 0);
+            }
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    test_all_octants();
+    test_long_and_clipped();
+    test_empty_square();
+
+    ssd1309_deinit(&display);
+    return 0;
+}
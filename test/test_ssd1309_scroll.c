@@ -0,0 +1,104 @@
+/**
+ * @file test_ssd1309_scroll.c
+ *
+ * hardware scroll: stopping it leaves the panel RAM undefined, so the first
+ * flush afterwards rewrites every page, with or without double buffering
+ */
+
+#include <string.h>
+
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+
+#define CS_PIN 5
+#define DC_PIN 6
+#define RST_PIN 7
+
+static ssd1309_t display;
+
+/**
+ * @brief Count the data bytes sent to each page since the last clear
+ *
+ * Follows the page address windows on the bus, with the column wrapping to
+ * the next page at the end of the window like the controller does.
+ */
+static void page_bytes(size_t counts[8])
+{
+    memset(counts, 0, 8 * sizeof(counts[0]));
+    uint8_t col0 = 0, col1 = 127, page = 0, col = 0;
+    for (size_t i = 0; i < stub_spi.len; i++)
+    {
+        if (stub_spi.dc[i])
+        {
+            counts[page & 7]++;
+            if (col++ == col1)
+            {
+                col = col0;
+                page++;
+            }
+        }
+        else if (stub_spi.bytes[i] == SET_COL_ADDR && i + 2 < stub_spi.len)
+        {
+            col = col0 = stub_spi.bytes[i + 1];
+            col1 = stub_spi.bytes[i + 2];
+            i += 2;
+        }
+        else if (stub_spi.bytes[i] == SET_PAGE_ADDR && i + 2 < stub_spi.len)
+        {
+            page = stub_spi.bytes[i + 1];
+            i += 2;
+        }
+    }
+}
+
+static void check_stop_rewrites_all(bool double_buffer, void (*flush)(ssd1309_t *))
+{
+    stub_reset();
+    stub_spi_attach(CS_PIN, DC_PIN, 4096);
+    CHECK(ssd1309_init(&display, 128, 64, spi0, CS_PIN, DC_PIN, RST_PIN));
+    CHECK(ssd1309_set_double_buffer(&display, double_buffer));
+    ssd1309_draw_string(&display, 0, 0, 1, "marquee");
+    ssd1309_show(&display);
+
+    stub_spi_clear();
+    ssd1309_scroll_horizontal(&display, true, 0, 0, 0);
+    CHECK_EQ(stub_spi.bytes[stub_spi.len - 1], SET_SCROLL_ON);
+    ssd1309_scroll_stop(&display);
+    CHECK_EQ(stub_spi.bytes[stub_spi.len - 1], SET_SCROLL_OFF);
+
+    // Only page 0 changes, every page goes out
+    stub_spi_clear();
+    ssd1309_clear_square(&display, 0, 0, 128, 8);
+    ssd1309_draw_square(&display, 0, 0, 128, 8);
+    flush(&display);
+    ssd1309_wait(&display);
+
+    size_t counts[8];
+    page_bytes(counts);
+    for (int page = 0; page < 8; page++)
+        CHECK_EQ(counts[page], 128);
+    if (display.front)
+        CHECK(memcmp(display.front, display.buffer, display.bufsize) == 0);
+
+    // Back to sending only what changes
+    stub_spi_clear();
+    flush(&display);
+    ssd1309_wait(&display);
+    CHECK_EQ(stub_spi.total, 0);
+    ssd1309_deinit(&display);
+}
+
+static void show_async(ssd1309_t *p)
+{
+    CHECK(ssd1309_show_async(p, NULL, NULL));
+}
+
+int main(void)
+{
+    check_stop_rewrites_all(false, ssd1309_show_partial);
+    check_stop_rewrites_all(true, ssd1309_show_partial);
+    check_stop_rewrites_all(false, show_async);
+    check_stop_rewrites_all(true, show_async);
+    return 0;
+}
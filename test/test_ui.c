@@ -0,0 +1,126 @@
+/**
+ * @file test_ui.c
+ *
+ * widget layer: the volume bar against the original indicator code, and
+ * repainting only the widgets whose value changed
+ */
+
+#include <string.h>
+
+#include "ssd1309.h"
+#include "stubs.h"
+#include "test.h"
+#include "ui.h"
+
+#define WIDTH 128
+#define HEIGHT 64
+
+static ssd1309_t display;
+static ssd1309_t expected;
+
+static bool page_dirty(const ssd1309_t *p, uint32_t page)
+{
+    return p->dirty_x0[page] <= p->dirty_x1[page];
+}
+
+static void test_volume_bar(void)
+{
+    // Same box as the clock screen's volume bar
+    ui_widget_t bar;
+    ui_widget_t *const widgets[] = {&bar};
+    const ui_screen_t screen = {widgets, 1};
+    ui_bar_init(&bar, 0, 0, 41, 6, 30);
+
+    for (uint8_t volume = 0; volume <= 30; volume++)
+    {
+        ssd1309_clear(&display);
+        ui_bar_set(&bar, volume);
+        bar.dirty = true;
+        CHECK(ui_render(&display, &screen));
+
+        // drawVolumeIndicator() before the widget layer
+        int bar_width = 40;
+        int bar_height = 5;
+        ssd1309_clear(&expected);
+        ssd1309_clear_square(&expected, 0, 0, bar_width, bar_height);
+        ssd1309_draw_empty_square(&expected, 0, 0, bar_width, bar_height);
+        double fill_width = (double)bar_width / 30.0 * (double)volume;
+        ssd1309_draw_square(&expected, 1, 1, (int)fill_width, bar_height - 1);
+
+        if (memcmp(display.buffer, expected.buffer, display.bufsize) != 0)
+        {
+            fprintf(stderr, "volume %u differs\n", volume);
+            exit(1);
+        }
+    }
+
+    // Values past the end are clamped
+    ui_bar_set(&bar, 30);
+    bar.dirty = false;
+    ui_bar_set(&bar, 200);
+    CHECK(!bar.dirty);
+    CHECK_EQ(bar.bar.value, 30);
+}
+
+static void test_dirty_only(void)
+{
+    static const char *const items[] = {"Alarm", "Volume", "Back"};
+    ui_widget_t label, digits, bar, menu, blink;
+    ui_widget_t *const widgets[] = {&label, &digits, &bar, &menu, &blink};
+    const ui_screen_t screen = {widgets, sizeof(widgets) / sizeof(widgets[0])};
+
+    ui_label_init(&label, 0, 0, 10, 1);           // page 0
+    ui_digits_init(&digits, 20, 16, 2);           // pages 2-3
+    ui_bar_init(&bar, 0, 40, 41, 6, 30);          // page 5
+    ui_menu_init(&menu, 64, 0, 60, items, 3, 10); // pages 0-3
+    ui_blink_init(&blink, 100, 56, 8, 8);         // page 7
+
+    ui_screen_show(&display, &screen);
+    CHECK(ui_render(&display, &screen));
+    ssd1309_show_partial(&display); // leaves every page clean
+
+    // Nothing changed: nothing repainted
+    ui_label_set(&label, "");
+    ui_digits_set(&digits, 0, 0);
+    ui_bar_set(&bar, 0);
+    ui_menu_select(&menu, 0);
+    ui_menu_select(&menu, 3);
+    ui_blink_set(&blink, false);
+    ui_set_visible(&bar, true);
+    CHECK(!ui_render(&display, &screen));
+    for (uint32_t page = 0; page < HEIGHT / 8; page++)
+        CHECK(!page_dirty(&display, page));
+
+    // Only the pages of the changed widgets are touched
+    ui_digits_set(&digits, 7, 5);
+    ui_blink_toggle(&blink);
+    CHECK(ui_render(&display, &screen));
+    for (uint32_t page = 0; page < HEIGHT / 8; page++)
+        CHECK_EQ(page_dirty(&display, page), page == 2 || page == 3 || page == 7);
+    CHECK_EQ(display.dirty_x0[7], 100);
+    CHECK_EQ(display.dirty_x1[7], 107);
+    CHECK(!digits.dirty && !blink.dirty);
+
+    // A hidden widget leaves a blank box
+    ssd1309_show_partial(&display); // leaves every page clean
+    ui_set_visible(&blink, false);
+    CHECK(ui_render(&display, &screen));
+    CHECK(page_dirty(&display, 7));
+    for (uint32_t col = 100; col < 108; col++)
+        CHECK_EQ(display.buffer[7 * WIDTH + col], 0);
+}
+
+int main(void)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+    CHECK(ssd1309_init(&expected, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    test_volume_bar();
+    test_dirty_only();
+
+    ssd1309_deinit(&display);
+    ssd1309_deinit(&expected);
+    return 0;
+}
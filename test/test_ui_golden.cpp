@@ -0,0 +1,241 @@
+/**
+ * @file test_ui_golden.cpp
+ *
+ * every UI state, reached with synthetic events at a fixed time, rendered
+ * and compared with the PBM images checked in under test/golden. Clock
+ * frames must also leave the rows the burn-in shift wraps around blank.
+ * The walk runs three times: drawn directly by the platform, through the
+ * display pipeline on one core, and through it on two, with core 1 served
+ * while core 0 would sleep.
+ *
+ * A frame that differs is written next to the test binary as
+ * <name>.actual.pbm for inspection. After an intended change to the UI,
+ * regenerate the goldens with
+ *   test_ui_golden --update
+ * and review the images before committing them.
+ */
+
+#include <string.h>
+#include <string>
+
+#include "fake_platform.h"
+#include "stubs.h"
+#include "test.h"
+
+#define WIDTH 128
+#define HEIGHT SCREEN_HEIGHT
+
+static ssd1309_t display;
+static FakePlatform *platform;
+static AlarmClock *app;
+static DisplayPipeline *pipeline;
+static EventFlags events;
+static bool update;
+static int failures;
+
+static std::string pbm()
+{
+    FILE *f = tmpfile();
+    CHECK(f);
+    ssd1309_write_pbm(&display, f);
+    std::string text(ftell(f), '\0');
+    rewind(f);
+    CHECK_EQ(fread(&text[0], 1, text.size(), f), text.size());
+    fclose(f);
+    return text;
+}
+
+static bool read_file(const std::string &path, std::string &text)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    char buffer[4096];
+    size_t n;
+    text.clear();
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text.append(buffer, n);
+    fclose(f);
+    return true;
+}
+
+static void write_file(const std::string &path, const std::string &text)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    CHECK(f);
+    CHECK_EQ(fwrite(text.data(), 1, text.size(), f), text.size());
+    fclose(f);
+}
+
+/**
+ * @brief Compare the frame on the display with its golden, or replace the golden
+ */
+static void snapshot(const char *name)
+{
+    std::string actual = pbm();
+    std::string golden_path = std::string(GOLDEN_DIR "/") + name + ".pbm";
+    if (update)
+    {
+        write_file(golden_path, actual);
+        return;
+    }
+
+    std::string golden;
+    if (!read_file(golden_path, golden))
+    {
+        fprintf(stderr, "%s: missing, run with --update to create it\n", golden_path.c_str());
+        failures++;
+        return;
+    }
+    if (golden != actual)
+    {
+        std::string actual_path = std::string(name) + ".actual.pbm";
+        write_file(actual_path, actual);
+        fprintf(stderr, "%s: frame differs from %s\n", actual_path.c_str(), golden_path.c_str());
+        failures++;
+    }
+}
+
+/**
+ * @brief Check that the rows the burn-in shift wraps around are blank
+ */
+static void check_shift_rows()
+{
+    for (uint32_t y = HEIGHT - BURN_IN_MAX_SHIFT; y < HEIGHT; y++)
+        for (uint32_t x = 0; x < WIDTH; x++)
+            CHECK(!(display.buffer[(y >> 3) * WIDTH + x] & (1 << (y & 7))));
+}
+
+/**
+ * @brief Compare a clock screen frame, which must also leave room to shift
+ */
+static void clock_snapshot(const char *name)
+{
+    CHECK(app->screen() == app->clockScreen());
+    check_shift_rows();
+    snapshot(name);
+}
+
+static void loop()
+{
+    app->dispatch(events.take());
+    app->poll();
+    if (!pipeline)
+        return;
+
+    pipeline->release();
+    stub_core_num = 1;
+    pipeline->runQueued();
+    stub_core_num = 0;
+    pipeline->acquire();
+    ssd1309_wait(&display);
+}
+
+static void press(Event button)
+{
+    platform->us += (BUTTON_DEBOUNCE_MS + 1) * US_PER_MS;
+    events.post(button);
+    loop();
+}
+
+static void press(Event button, int times)
+{
+    for (int i = 0; i < times; i++)
+        press(button);
+}
+
+/**
+ * @brief Walk every state, with the display run by a pipeline if given
+ */
+static void walk(bool use_pipeline, bool multicore)
+{
+    stub_reset();
+    stub_spi_attach(5, 6, 0);
+    CHECK(ssd1309_init(&display, WIDTH, HEIGHT, spi0, 5, 6, 7));
+
+    platform = new FakePlatform();
+    app = new AlarmClock(*platform);
+    pipeline = nullptr;
+    if (use_pipeline)
+    {
+        // Set up before begin() sends the first screen, like main()
+        pipeline = new DisplayPipeline();
+        pipeline->begin(&display, app, multicore);
+        platform->pipeline = pipeline;
+    }
+    else
+    {
+        platform->display = &display;
+        platform->app = app;
+    }
+    app->begin();
+    loop();
+    clock_snapshot("clock");
+
+    app->restoreAlarm(6, 45);
+    events.post(EVENT_TICK);
+    loop();
+    clock_snapshot("clock_alarm");
+
+    events.post(EVENT_ALARM);
+    loop();
+    clock_snapshot("ringing_on");
+    platform->us += ALARM_FLASH_MS * US_PER_MS;
+    loop();
+    clock_snapshot("ringing_off");
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+
+    press(EVENT_BUTTON_DOWN, 15);
+    clock_snapshot("volume_0");
+    press(EVENT_BUTTON_UP, 15);
+    clock_snapshot("volume_15");
+    press(EVENT_BUTTON_UP, 15);
+    clock_snapshot("volume_30");
+    CHECK_EQ(app->volume(), MAX_VOLUME);
+    platform->us += (VOLUME_BAR_TIMEOUT_S + 1) * US_PER_S;
+    loop();
+    clock_snapshot("clock_alarm");
+
+    press(EVENT_BUTTON_SELECT);
+    snapshot("menu_0");
+    press(EVENT_BUTTON_DOWN);
+    snapshot("menu_1");
+    press(EVENT_BUTTON_DOWN);
+    snapshot("menu_2");
+
+    press(EVENT_BUTTON_DOWN);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_SET_ALARM);
+    snapshot("set_alarm_hour");
+    press(EVENT_BUTTON_SELECT);
+    snapshot("set_alarm_minute");
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_CLOCK);
+
+    press(EVENT_BUTTON_SELECT);
+    press(EVENT_BUTTON_DOWN);
+    press(EVENT_BUTTON_SELECT);
+    CHECK_EQ(app->state(), STATE_SET_TIME);
+    snapshot("set_time_hour");
+    press(EVENT_BUTTON_SELECT);
+    snapshot("set_time_minute");
+
+    delete pipeline;
+    delete app;
+    delete platform;
+    ssd1309_deinit(&display);
+}
+
+int main(int argc, char **argv)
+{
+    update = argc > 1 && strcmp(argv[1], "--update") == 0;
+
+    walk(false, false);
+    if (!update)
+    {
+        walk(true, false);
+        walk(true, true);
+    }
+    return failures ? 1 : 0;
+}
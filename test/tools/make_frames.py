@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Write the BMP frames of the test animation.
+
+A block slides across a background image, inverting what it covers, so
+consecutive frames differ in a small band, as in a typical alarm screen.
+
+Usage:
+    make_frames.py -o <dir> -n <frames> <background bmp>
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.dont_write_bytecode = True  # keep the source tree clean
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "lib", "ssd1309", "tools"))
+from sprite_encoder import read_bmp  # noqa: E402
+
+BLOCK_W = 24
+BLOCK_H = 16
+BLOCK_Y = 40
+STEP = 12
+
+
+def write_bmp(path, width, height, rows):
+    """Write a bottom-up 1 bit BMP whose palette entry 0 (black) marks lit pixels."""
+    bytes_per_line = ((width + 31) // 32) * 4
+    pixels = bytearray()
+    for row in reversed(rows):
+        line = bytearray(bytes_per_line)
+        for x in range(width):
+            if not row[x]:
+                line[x >> 3] |= 0x80 >> (x & 7)
+        pixels += line
+    palette = bytes([0, 0, 0, 0, 255, 255, 255, 0])
+    off_bits = 14 + 40 + len(palette)
+    header = struct.pack("<2sIHHI", b"BM", off_bits + len(pixels), 0, 0, off_bits)
+    info = struct.pack("<IiiHHIIiiII", 40, width, height, 1, 1, 0, len(pixels), 2835, 2835, 2, 2)
+    with open(path, "wb") as f:
+        f.write(header + info + palette + pixels)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-o", "--output", required=True, help="output directory")
+    parser.add_argument("-n", "--frames", type=int, required=True, help="number of frames")
+    parser.add_argument("background", help="background BMP")
+    args = parser.parse_args()
+
+    width, height, rows = read_bmp(args.background)
+    os.makedirs(args.output, exist_ok=True)
+    for i in range(args.frames):
+        frame = [list(r) for r in rows]
+        x0 = (i * STEP) % (width - BLOCK_W)
+        for y in range(BLOCK_Y, BLOCK_Y + BLOCK_H):
+            for x in range(x0, x0 + BLOCK_W):
+                frame[y][x] ^= 1
+        write_bmp(os.path.join(args.output, f"frame{i}.bmp"), width, height, frame)
+
+
+if __name__ == "__main__":
+    main()